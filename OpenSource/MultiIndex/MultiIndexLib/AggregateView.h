@@ -0,0 +1,74 @@
+//
+//  AggregateView.h
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "TableObserver.h"
+
+// Materialized group by aggregate - count, sum, min and max of the values per key,
+// maintained incrementally by the table writes, i.e.
+// struct CustomerOf { int operator()(const Order& order) const { return order.customer; } };
+// struct AmountOf { double operator()(const Order& order) const { return order.amount; } };
+// AggregateView<Order, CustomerOf, AmountOf> byCustomer;
+// table.Attach(byCustomer);
+// auto orders = byCustomer.Get(42);
+// Count and sum cost O(1) per modification, min and max O(log m), m - number of distinct values of the key.
+// Reads are O(1) and don't need the table lock.
+template<typename T, typename KeyOf, typename ValueOf, typename Hash = std::hash<std::decay_t<std::invoke_result_t<KeyOf, const T&>>>>
+class AggregateView : public TableObserver<T> {
+public:
+    using Key = std::decay_t<std::invoke_result_t<KeyOf, const T&>>;
+    using Value = std::decay_t<std::invoke_result_t<ValueOf, const T&>>;
+
+    struct Aggregate {
+        size_t count{0};
+        Value sum{};
+        Value min{};
+        Value max{};
+    };
+
+private:
+    struct Group {
+        size_t m_count{0};
+        Value m_sum{};
+        std::map<Value, size_t> m_values; // distinct values with their counters, for min and max
+    };
+
+    const KeyOf m_keyOf;
+    const ValueOf m_valueOf;
+    std::unordered_map<Key, Group, Hash> m_groups;
+    mutable std::shared_mutex m_mutex; // the view is read without the table lock
+
+    AggregateView(const AggregateView&) = delete;
+    AggregateView(AggregateView&&) = delete;
+
+public:
+    explicit AggregateView(KeyOf keyOf = KeyOf(), ValueOf valueOf = ValueOf()) noexcept;
+
+    // aggregate of the objects with the key, empty if there are none
+    std::optional<Aggregate> Get(const Key& key) const noexcept;
+    // number of the keys
+    size_t Groups() const noexcept;
+    // visits all groups, F should have: void operator()(const Key& key, const Aggregate& aggregate)
+    template<typename F>
+    void ForEach(F&& visitor) const noexcept;
+
+    void OnInsert(const T& object) noexcept override;
+    void OnErase(const T& object) noexcept override;
+    void OnClear() noexcept override;
+
+private:
+    static Aggregate MakeAggregate(const Group& group) noexcept;
+};
+
+#include "AggregateView.hpp"
@@ -0,0 +1,87 @@
+//
+//  AggregateView.hpp
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+template<typename T, typename KeyOf, typename ValueOf, typename Hash>
+AggregateView<T, KeyOf, ValueOf, Hash>::AggregateView(KeyOf keyOf, ValueOf valueOf) noexcept :
+    m_keyOf(std::move(keyOf)), m_valueOf(std::move(valueOf)) {
+}
+
+template<typename T, typename KeyOf, typename ValueOf, typename Hash>
+/*static*/
+typename AggregateView<T, KeyOf, ValueOf, Hash>::Aggregate
+AggregateView<T, KeyOf, ValueOf, Hash>::MakeAggregate(const Group& group) noexcept {
+    Aggregate aggregate;
+    aggregate.count = group.m_count;
+    aggregate.sum = group.m_sum;
+    aggregate.min = group.m_values.begin()->first;
+    aggregate.max = group.m_values.rbegin()->first;
+    return aggregate;
+}
+
+template<typename T, typename KeyOf, typename ValueOf, typename Hash>
+std::optional<typename AggregateView<T, KeyOf, ValueOf, Hash>::Aggregate>
+AggregateView<T, KeyOf, ValueOf, Hash>::Get(const Key& key) const noexcept {
+    std::shared_lock<std::shared_mutex> locker(m_mutex);
+    auto it = m_groups.find(key);
+    if (it == m_groups.end()) {
+        return std::nullopt;
+    }
+    return MakeAggregate(it->second);
+}
+
+template<typename T, typename KeyOf, typename ValueOf, typename Hash>
+size_t AggregateView<T, KeyOf, ValueOf, Hash>::Groups() const noexcept {
+    std::shared_lock<std::shared_mutex> locker(m_mutex);
+    return m_groups.size();
+}
+
+template<typename T, typename KeyOf, typename ValueOf, typename Hash>
+template<typename F>
+void AggregateView<T, KeyOf, ValueOf, Hash>::ForEach(F&& visitor) const noexcept {
+    std::shared_lock<std::shared_mutex> locker(m_mutex);
+    for (const auto& group : m_groups) {
+        visitor(group.first, MakeAggregate(group.second));
+    }
+}
+
+template<typename T, typename KeyOf, typename ValueOf, typename Hash>
+void AggregateView<T, KeyOf, ValueOf, Hash>::OnInsert(const T& object) noexcept {
+    Value value = m_valueOf(object);
+    std::lock_guard<std::shared_mutex> locker(m_mutex);
+    auto& group = m_groups[m_keyOf(object)];
+    ++group.m_count;
+    group.m_sum += value;
+    ++group.m_values[value];
+}
+
+template<typename T, typename KeyOf, typename ValueOf, typename Hash>
+void AggregateView<T, KeyOf, ValueOf, Hash>::OnErase(const T& object) noexcept {
+    Value value = m_valueOf(object);
+    std::lock_guard<std::shared_mutex> locker(m_mutex);
+    auto it = m_groups.find(m_keyOf(object));
+    if (it == m_groups.end()) {
+        return;
+    }
+    
+    auto& group = it->second;
+    if (--group.m_count == 0) { // the last one, no rounding leftovers in the sum
+        m_groups.erase(it);
+        return;
+    }
+    
+    group.m_sum -= value;
+    auto vit = group.m_values.find(value);
+    if (vit != group.m_values.end() && --vit->second == 0) {
+        group.m_values.erase(vit);
+    }
+}
+
+template<typename T, typename KeyOf, typename ValueOf, typename Hash>
+void AggregateView<T, KeyOf, ValueOf, Hash>::OnClear() noexcept {
+    std::lock_guard<std::shared_mutex> locker(m_mutex);
+    m_groups.clear();
+}
@@ -0,0 +1,186 @@
+//
+//  BitmapMultiSet.h
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "Instrumentation.h"
+#include "RoaringBitmap.h"
+
+// the stored objects of the tables with bitmap indices keep their handles
+struct BitmapHandle {
+    uint32_t m_handle{0};
+};
+
+struct NoBitmapHandle {};
+
+// Dense 32 bit handles of the table objects shared by the bitmap indices,
+// the released handles are reused, so the bitmaps stay compact.
+template <typename Iter>
+class BitmapHandles {
+    std::vector<Iter> m_iters; // by the handle
+    std::vector<uint32_t> m_free; // released handles
+    RoaringBitmap m_live; // handles in use
+
+public:
+    uint32_t Acquire(const Iter& iter) noexcept {
+        uint32_t handle;
+        if (!m_free.empty()) {
+            handle = m_free.back();
+            m_free.pop_back();
+            m_iters[handle] = iter;
+        } else {
+            handle = uint32_t(m_iters.size());
+            m_iters.push_back(iter);
+        }
+        m_live.Add(handle);
+        return handle;
+    }
+
+    void Release(uint32_t handle) noexcept {
+        m_live.Remove(handle);
+        m_free.push_back(handle);
+    }
+
+    void Clear() noexcept {
+        m_iters.clear();
+        m_free.clear();
+        m_live.Clear();
+    }
+
+    const Iter& operator[](uint32_t handle) const noexcept { return m_iters[handle]; }
+    const RoaringBitmap& Live() const noexcept { return m_live; }
+};
+
+// Index of the low cardinality attributes, every distinct key keeps a compressed bitmap (RoaringBitmap)
+// of the object handles instead of the object iterators:
+// [key] -> [bitmap of handles]
+// [key] -> [bitmap of handles]
+// The keys are compared linearly by the hash and then by the equal operator, a few thousand of them at most.
+// The handles are resolved to the objects through the table BitmapHandles.
+template <typename Iter, typename Pred>
+class BitmapMultiSet {
+public:
+    // the erase removes the handle of the object from its key bitmap
+    static constexpr bool kDirectErase = true;
+
+private:
+    using Value = std::remove_reference_t<decltype(*std::declval<Iter>())>;
+
+    struct Slot {
+        size_t m_hash{0};
+        RoaringBitmap m_handles; // never empty, the smallest handle is the key object
+    };
+
+    // not publicaly exposed, no need to follow std iterator interface
+    class iterator {
+        RoaringBitmap::iterator m_it;
+        const BitmapHandles<Iter>* m_handles{nullptr};
+
+    public:
+        iterator() noexcept = default;
+        iterator(RoaringBitmap::iterator it, const BitmapHandles<Iter>* handles) noexcept : m_it(it), m_handles(handles) {}
+
+        iterator& operator++() noexcept {
+            ++m_it;
+            return *this;
+        }
+
+        inline Iter& operator*() const noexcept {
+            return const_cast<Iter&>((*m_handles)[*m_it]);
+        }
+
+        inline bool operator==(const iterator& right) const noexcept { return m_it == right.m_it; }
+        inline bool operator!=(const iterator& right) const noexcept { return m_it != right.m_it; }
+    };
+
+    // the slot of @key, nullptr if none
+    Slot* Find(const Value& key, size_t hash) const noexcept;
+
+private:
+    const Pred m_hasher; // hash and equal operators
+    const BitmapHandles<Iter>* m_handles{nullptr};
+    std::vector<Slot> m_slots;
+    size_t m_totalItems{0}; // keeps track of total number of items.
+#if defined(MULTIINDEX_INSTRUMENTATION)
+    mutable IndexEvents m_events;
+#endif
+
+    BitmapMultiSet(const BitmapMultiSet& src) noexcept = delete;
+    BitmapMultiSet(BitmapMultiSet&& src) noexcept = delete;
+
+protected:
+    explicit BitmapMultiSet(TupleParams<Pred>&& params) noexcept;
+    ~BitmapMultiSet() noexcept;
+
+    // the table handles, must be attached before the first insert
+    void attach(const BitmapHandles<Iter>* handles) noexcept { m_handles = handles; }
+
+    bool is_equal(const Value& first, const Value& second) const noexcept { return m_hasher(first, second); }
+
+    // insert
+    bool insert(bool, const Iter& key) noexcept;
+
+    // erase
+    size_t erase(Iter key) noexcept;
+
+    // erases the items @doomed returns true for, the emptied keys are dropped
+    template <typename F>
+    size_t erase_if(F&& doomed) noexcept;
+
+    // nothing to preallocate, the containers are allocated on demand
+    void reserve(size_t) noexcept {}
+
+    size_t size() const noexcept { return m_totalItems; }
+#if defined(MULTIINDEX_INSTRUMENTATION)
+    IndexEvents& events() const noexcept { return m_events; }
+#endif
+
+    // releases the unused capacity of the bitmaps at once
+    bool compact(size_t, float) noexcept;
+
+    // the bitmaps pick their containers by the density, there is no bucket capacity
+    void set_capacity(uint32_t) noexcept {}
+
+    // structure statistics, the distinct keys are reported as buckets
+    IndexStats stats(size_t reads, size_t writes) const noexcept;
+
+    // sorts @keys by the handles, the bitmaps get the increasing handles
+    void sort_keys(std::vector<Iter>& keys) const noexcept;
+
+    // the bitmaps have no separate read only layout, builds the empty set of @items
+    void freeze(std::vector<Iter>& items) noexcept;
+
+    // handles of the objects equal to @key, nullptr if none
+    const RoaringBitmap* bitmap(const Value& key) const noexcept;
+
+    std::pair<iterator, iterator> equal_range(const Value& key) const noexcept;
+
+    // find the first item by the key.
+    iterator find(const Value& key) const noexcept;
+
+    iterator end() const noexcept { return iterator(); }
+
+    // clear
+    void clear() noexcept;
+
+    // traverse
+    void traverse() const noexcept;
+};
+
+// detection of the bitmap index, it resolves the table handles
+template <typename S>
+struct IsBitmapMultiSet : std::false_type {};
+
+template <typename Iter, typename Pred>
+struct IsBitmapMultiSet<BitmapMultiSet<Iter, Pred>> : std::true_type {};
+
+#include "BitmapMultiSet.hpp"
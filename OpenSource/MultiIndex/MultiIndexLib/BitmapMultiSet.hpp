@@ -0,0 +1,159 @@
+//
+//  BitmapMultiSet.hpp
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+template <typename Iter, typename Pred>
+BitmapMultiSet<Iter, Pred>::BitmapMultiSet(TupleParams<Pred>&& params) noexcept :
+    m_hasher(std::move(std::get<2>(params))) {
+}
+
+template <typename Iter, typename Pred>
+BitmapMultiSet<Iter, Pred>::~BitmapMultiSet() noexcept {
+}
+
+template <typename Iter, typename Pred>
+typename BitmapMultiSet<Iter, Pred>::Slot* BitmapMultiSet<Iter, Pred>::Find(const Value& key, size_t hash) const noexcept {
+    for (const auto& slot : m_slots) {
+        if (slot.m_hash == hash && m_hasher(key, *(*m_handles)[slot.m_handles.Minimum()])) {
+            return const_cast<Slot*>(&slot);
+        }
+    }
+    return nullptr;
+}
+
+template <typename Iter, typename Pred>
+bool BitmapMultiSet<Iter, Pred>::insert(bool, const Iter& key) noexcept {
+    const size_t hash = m_hasher(*key);
+    Slot* slot = Find(*key, hash);
+    if (slot == nullptr) {
+        slot = &m_slots.emplace_back();
+        slot->m_hash = hash;
+    }
+
+    if (!slot->m_handles.Add(key.Handle())) {
+        return false;
+    }
+    ++m_totalItems;
+    return true;
+}
+
+template <typename Iter, typename Pred>
+size_t BitmapMultiSet<Iter, Pred>::erase(Iter key) noexcept {
+    Slot* slot = Find(*key, m_hasher(*key));
+    if (slot == nullptr || !slot->m_handles.Remove(key.Handle())) {
+        return 0;
+    }
+
+    --m_totalItems;
+    if (slot->m_handles.Empty()) { // the last slot takes the place
+        *slot = std::move(m_slots.back());
+        m_slots.pop_back();
+    }
+    return 1;
+}
+
+template <typename Iter, typename Pred>
+template <typename F>
+size_t BitmapMultiSet<Iter, Pred>::erase_if(F&& doomed) noexcept {
+    size_t erased = 0;
+    RoaringBitmap victims;
+    for (size_t i = 0; i < m_slots.size();) {
+        victims.Clear();
+        for (uint32_t handle : m_slots[i].m_handles) {
+            if (doomed((*m_handles)[handle])) {
+                victims.Add(handle);
+            }
+        }
+
+        erased += victims.Cardinality();
+        m_slots[i].m_handles -= victims;
+        if (m_slots[i].m_handles.Empty()) {
+            m_slots[i] = std::move(m_slots.back());
+            m_slots.pop_back();
+        } else {
+            ++i;
+        }
+    }
+
+    m_totalItems -= erased;
+    return erased;
+}
+
+template <typename Iter, typename Pred>
+bool BitmapMultiSet<Iter, Pred>::compact(size_t, float) noexcept {
+    for (auto& slot : m_slots) {
+        slot.m_handles.Shrink();
+    }
+    m_slots.shrink_to_fit();
+    return true;
+}
+
+template <typename Iter, typename Pred>
+IndexStats BitmapMultiSet<Iter, Pred>::stats(size_t reads, size_t writes) const noexcept {
+    IndexStats stats;
+    stats.items = m_totalItems;
+    stats.buckets = m_slots.size();
+    stats.slots = m_totalItems;
+    stats.reads = reads;
+    stats.writes = writes;
+    return stats;
+}
+
+template <typename Iter, typename Pred>
+void BitmapMultiSet<Iter, Pred>::sort_keys(std::vector<Iter>& keys) const noexcept {
+    std::sort(keys.begin(), keys.end(), [](const Iter& first, const Iter& second) -> bool { return first.Handle() < second.Handle(); });
+}
+
+template <typename Iter, typename Pred>
+void BitmapMultiSet<Iter, Pred>::freeze(std::vector<Iter>& items) noexcept {
+    if (m_totalItems != 0) {
+        return;
+    }
+
+    sort_keys(items);
+    for (const Iter& item : items) {
+        insert(false, item);
+    }
+    compact(0, 1.f);
+}
+
+template <typename Iter, typename Pred>
+const RoaringBitmap* BitmapMultiSet<Iter, Pred>::bitmap(const Value& key) const noexcept {
+    const Slot* slot = Find(key, m_hasher(key));
+    return slot != nullptr ? &slot->m_handles : nullptr;
+}
+
+template <typename Iter, typename Pred>
+std::pair<typename BitmapMultiSet<Iter, Pred>::iterator, typename BitmapMultiSet<Iter, Pred>::iterator>
+BitmapMultiSet<Iter, Pred>::equal_range(const Value& key) const noexcept {
+    const RoaringBitmap* handles = bitmap(key);
+    if (handles == nullptr) {
+        return std::make_pair(end(), end());
+    }
+    return std::make_pair(iterator(handles->begin(), m_handles), iterator(handles->end(), m_handles));
+}
+
+template <typename Iter, typename Pred>
+typename BitmapMultiSet<Iter, Pred>::iterator BitmapMultiSet<Iter, Pred>::find(const Value& key) const noexcept {
+    const RoaringBitmap* handles = bitmap(key);
+    return handles != nullptr ? iterator(handles->begin(), m_handles) : end();
+}
+
+template <typename Iter, typename Pred>
+void BitmapMultiSet<Iter, Pred>::clear() noexcept {
+    m_slots.clear();
+    m_totalItems = 0;
+}
+
+template <typename Iter, typename Pred>
+void BitmapMultiSet<Iter, Pred>::traverse() const noexcept {
+    for (const auto& slot : m_slots) {
+        for (uint32_t handle : slot.m_handles) {
+            printf("Item(bitmap): %d\n", (*(*m_handles)[handle])->i);
+        }
+    }
+    printf("_______________________\n");
+}
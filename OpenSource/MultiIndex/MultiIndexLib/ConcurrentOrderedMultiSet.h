@@ -0,0 +1,180 @@
+//
+//  ConcurrentOrderedMultiSet.h
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#include "EpochReclamation.h"
+#include "Instrumentation.h"
+
+// Ordered index for concurrent readers and writers without the table lock.
+// Lock-free skip list, a node per item, ordered by the key and then by the object address,
+// so the equal keys keep a stable order:
+// [head] -> node -> ... -> node - level k, every node of level k is on the levels below as well
+// [head] -> node -> node -> ... -> node - level 0, all items
+// A writer deletes a node by marking its next pointers, the level 0 mark decides the winner of the concurrent erases,
+// the searches of the writers unlink the marked nodes. Readers walk the levels without locks inside an epoch (EpochGuard)
+// and skip the marked nodes. The node is retired once it is unlinked and its inserter stopped linking it.
+template <typename Iter, typename Pred>
+class ConcurrentOrderedMultiSet {
+    using Value = std::remove_reference_t<decltype(*std::declval<Iter>())>;
+    using Link = std::atomic<uintptr_t>; // next node pointer, the lowest bit marks the deleted owner
+    static constexpr uint32_t kMaxHeight = 20; // 4^20 items with the 1/4 level promotion
+
+    struct Node {
+        Iter m_key;
+        std::atomic<uint32_t> m_refs{2}; // the inserter and the set, the last one to release retires the node
+        uint32_t m_height;
+        Link* Next() noexcept { return reinterpret_cast<Link*>(this + 1); }
+
+        Node(const Iter& key, uint32_t height) noexcept : m_key(key), m_height(height) {}
+    };
+
+    static bool Marked(uintptr_t link) noexcept { return (link & 1) != 0; }
+    static Node* Ptr(uintptr_t link) noexcept { return reinterpret_cast<Node*>(link & ~uintptr_t(1)); }
+
+    static Node* NewNode(const Iter& key, uint32_t height) noexcept;
+    static void DeleteNode(Node* node) noexcept;
+    static uint32_t RandomHeight() noexcept;
+
+    // true if @node is ordered before the position of @key and @object, nullptr - before all equal keys,
+    // @upper - after all equal keys
+    bool Before(Node* node, const Value& key, const Value* object, bool upper) const noexcept;
+
+    // writer search, fills the links and successors of every level and unlinks the marked nodes on the way
+    void Search(const Value& key, const Value* object, Link** links, Node** succs) const noexcept;
+    // reader search, the first live node not before the position, the last node before it goes to @pred
+    Node* Locate(const Value& key, const Value* object, bool upper, Node** pred = nullptr) const noexcept;
+    Node* First() const noexcept;
+    // the first live node after @node
+    static Node* NextLive(Node* node) noexcept;
+
+    // marks the node as deleted, false if another writer did it first
+    bool Remove(Node* node) noexcept;
+    void Release(Node* node) noexcept;
+
+public:
+    // forward walk of the level 0, a step back is a search.
+    // The range ends (upper_bound, equal_range) keep the bound key, a concurrent erase may take their node
+    // out of the walk, so an iterator past the key is equal to the end.
+    class iterator {
+        const ConcurrentOrderedMultiSet* m_set{nullptr};
+        Node* m_node{nullptr};
+        const Value* m_upper{nullptr}; // the key of the range end, the walk stops after its equal keys
+
+        // true if this is a range end and @it went past its key
+        inline bool Past(const iterator& it) const noexcept {
+            return m_upper != nullptr && (it.m_node == nullptr || m_set->m_compare(*m_upper, *it.m_node->m_key));
+        }
+
+    public:
+        iterator() noexcept = default;
+        iterator(const ConcurrentOrderedMultiSet* set, Node* node, const Value* upper = nullptr) noexcept :
+            m_set(set), m_node(node), m_upper(upper) {}
+
+        inline iterator& operator++() noexcept {
+            m_node = NextLive(m_node);
+            m_upper = nullptr;
+            return *this;
+        }
+
+        // O(log n), the end if there is nothing before
+        inline iterator& operator--() noexcept {
+            m_node = m_set->Prev(m_node);
+            m_upper = nullptr;
+            return *this;
+        }
+
+        inline const Iter& operator*() const noexcept { return m_node->m_key; }
+
+        inline bool operator==(const iterator& right) const noexcept { return m_node == right.m_node || Past(right) || right.Past(*this); }
+        inline bool operator!=(const iterator& right) const noexcept { return !(*this == right); }
+    };
+
+private:
+    // the last live node before @node, the last one if @node is nullptr
+    Node* Prev(Node* node) const noexcept;
+
+    const Pred m_compare; // less operator
+    mutable Link m_head[kMaxHeight] = {};
+    std::atomic<uint32_t> m_height{1}; // levels in use
+    std::atomic<size_t> m_totalItems{0};
+#if defined(MULTIINDEX_INSTRUMENTATION)
+    mutable IndexEvents m_events;
+#endif
+
+    ConcurrentOrderedMultiSet(const ConcurrentOrderedMultiSet& src) noexcept = delete;
+    ConcurrentOrderedMultiSet(ConcurrentOrderedMultiSet&&) noexcept = delete;
+
+protected:
+    explicit ConcurrentOrderedMultiSet(TupleParams<Pred>&& params) noexcept;
+    ~ConcurrentOrderedMultiSet() noexcept;
+
+    bool is_equal(const Value& first, const Value& second) const noexcept { return !m_compare(first, second) && !m_compare(second, first); }
+    bool is_less(const Value& first, const Value& second) const noexcept { return m_compare(first, second); }
+
+    bool insert(bool, const Iter& key) noexcept;
+
+    // erase, 0 if the item is not there or a concurrent erase took it
+    size_t erase(Iter key) noexcept;
+
+    // nodes are allocated per item, nothing to preallocate
+    void reserve(size_t) noexcept {}
+
+    size_t size() const noexcept { return m_totalItems.load(std::memory_order_relaxed); }
+#if defined(MULTIINDEX_INSTRUMENTATION)
+    IndexEvents& events() const noexcept { return m_events; }
+#endif
+
+    // a node per item, nothing to compact
+    bool compact(size_t, float) noexcept { return true; }
+
+    // a node per item, there is no bucket capacity to tune
+    void set_capacity(uint32_t) noexcept {}
+    // must be called inside an epoch
+    IndexStats stats(size_t reads, size_t writes) const noexcept;
+
+    // sorts @keys by the index order, batched inserts and erases walk the list in the key order
+    void sort_keys(std::vector<Iter>& keys) const noexcept;
+
+    // the lookups must be called inside an epoch, @key must outlive the range
+    std::pair<iterator, iterator> equal_range(const Value& key) const noexcept;
+
+    // find the first item by the key.
+    iterator find(const Value& key) const noexcept;
+
+    // the first item not less than the key
+    iterator lower_bound(const Value& key) const noexcept { return iterator(this, Locate(key, nullptr, false)); }
+
+    // the first item greater than the key, the range end of @key
+    iterator upper_bound(const Value& key) const noexcept { return iterator(this, Locate(key, nullptr, true), &key); }
+
+    // the first item not before the position of @key at @object in the index order, @object may be gone
+    iterator lower_bound(const Value& key, const Value* object) const noexcept { return iterator(this, Locate(key, object, false)); }
+
+    iterator begin() const noexcept { return iterator(this, First()); }
+
+    iterator end() const noexcept { return iterator(this, nullptr); }
+
+    // erases the items one by one, the concurrent readers see a shrinking list
+    void clear() noexcept;
+
+    // visits every item, must be called inside an epoch.
+    // Type V should have: void operator()(const Iter& key)
+    template <typename V>
+    void for_each(V&& visitor) const noexcept;
+
+    // traverse
+    void traverse() const noexcept;
+};
+
+#include "ConcurrentOrderedMultiSet.hpp"
@@ -0,0 +1,344 @@
+//
+//  ConcurrentOrderedMultiSet.hpp
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+template <typename Iter, typename Pred>
+ConcurrentOrderedMultiSet<Iter, Pred>::ConcurrentOrderedMultiSet(TupleParams<Pred>&& params) noexcept :
+    m_compare(std::move(std::get<2>(params))) {
+}
+
+template <typename Iter, typename Pred>
+ConcurrentOrderedMultiSet<Iter, Pred>::~ConcurrentOrderedMultiSet() noexcept {
+    // nobody can reach the index anymore, release the retired nodes as well
+    EpochManager::Instance().Flush(this);
+    for (Node* node = Ptr(m_head[0].load(std::memory_order_relaxed)); node != nullptr;) {
+        Node* next = Ptr(node->Next()[0].load(std::memory_order_relaxed));
+        DeleteNode(node);
+        node = next;
+    }
+}
+
+template <typename Iter, typename Pred>
+/*static*/
+typename ConcurrentOrderedMultiSet<Iter, Pred>::Node*
+ConcurrentOrderedMultiSet<Iter, Pred>::NewNode(const Iter& key, uint32_t height) noexcept {
+    // the links follow the node
+    void* memory = ::operator new(sizeof(Node) + sizeof(Link) * height, std::align_val_t(alignof(Node)), std::nothrow);
+    if (memory == nullptr) {
+        return nullptr;
+    }
+
+    Node* node = new (memory) Node(key, height);
+    for (uint32_t level = 0; level < height; ++level) {
+        new (node->Next() + level) Link(0);
+    }
+    return node;
+}
+
+template <typename Iter, typename Pred>
+/*static*/
+void ConcurrentOrderedMultiSet<Iter, Pred>::DeleteNode(Node* node) noexcept {
+    node->~Node();
+    ::operator delete(node, std::align_val_t(alignof(Node)));
+}
+
+template <typename Iter, typename Pred>
+/*static*/
+uint32_t ConcurrentOrderedMultiSet<Iter, Pred>::RandomHeight() noexcept {
+    // xorshift per thread, a level is promoted with the probability of 1/4
+    static thread_local uint64_t state = 0x9E3779B97F4A7C15ull ^ uint64_t(reinterpret_cast<uintptr_t>(&state));
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    uint32_t height = 1;
+    for (uint64_t bits = state; height < kMaxHeight && (bits & 3) == 0; bits >>= 2) {
+        ++height;
+    }
+    return height;
+}
+
+template <typename Iter, typename Pred>
+bool ConcurrentOrderedMultiSet<Iter, Pred>::Before(Node* node, const Value& key, const Value* object, bool upper) const noexcept {
+    const Value& value = *node->m_key;
+    if (m_compare(value, key)) {
+        return true;
+    }
+
+    if (m_compare(key, value)) {
+        return false;
+    }
+
+    // equal keys
+    return upper || &value < object;
+}
+
+template <typename Iter, typename Pred>
+void ConcurrentOrderedMultiSet<Iter, Pred>::Search(const Value& key, const Value* object, Link** links, Node** succs) const noexcept {
+retry:
+    const uint32_t top = m_height.load(std::memory_order_acquire);
+    for (uint32_t level = kMaxHeight; level-- > top;) {
+        links[level] = &m_head[level];
+        succs[level] = Ptr(m_head[level].load(std::memory_order_acquire));
+    }
+
+    Node* pred = nullptr; // head
+    for (uint32_t level = top; level-- > 0;) {
+        Link* link = pred != nullptr ? &pred->Next()[level] : &m_head[level];
+        Node* curr = Ptr(link->load(std::memory_order_acquire));
+        while (curr != nullptr) {
+            uintptr_t succ = curr->Next()[level].load(std::memory_order_acquire);
+            if (Marked(succ)) { // help the erase, the marked predecessor fails the exchange
+                uintptr_t expected = reinterpret_cast<uintptr_t>(curr);
+                if (!link->compare_exchange_strong(expected, succ & ~uintptr_t(1), std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    goto retry;
+                }
+                curr = Ptr(succ);
+                continue;
+            }
+
+            if (!Before(curr, key, object, false)) {
+                break;
+            }
+
+            pred = curr;
+            link = &curr->Next()[level];
+            curr = Ptr(succ);
+        }
+
+        links[level] = link;
+        succs[level] = curr;
+    }
+}
+
+template <typename Iter, typename Pred>
+typename ConcurrentOrderedMultiSet<Iter, Pred>::Node*
+ConcurrentOrderedMultiSet<Iter, Pred>::Locate(const Value& key, const Value* object, bool upper, Node** last) const noexcept {
+    Node* pred = nullptr; // head
+    Node* curr = nullptr;
+    for (uint32_t level = m_height.load(std::memory_order_acquire); level-- > 0;) {
+        curr = Ptr((pred != nullptr ? pred->Next()[level] : m_head[level]).load(std::memory_order_acquire));
+        while (curr != nullptr) {
+            uintptr_t succ = curr->Next()[level].load(std::memory_order_acquire);
+            if (Marked(succ)) {
+                curr = Ptr(succ);
+                continue;
+            }
+
+            if (!Before(curr, key, object, upper)) {
+                break;
+            }
+
+            pred = curr;
+            curr = Ptr(succ);
+        }
+    }
+
+    if (last != nullptr) {
+        *last = pred;
+    }
+    return curr;
+}
+
+template <typename Iter, typename Pred>
+typename ConcurrentOrderedMultiSet<Iter, Pred>::Node*
+ConcurrentOrderedMultiSet<Iter, Pred>::First() const noexcept {
+    Node* node = Ptr(m_head[0].load(std::memory_order_acquire));
+    while (node != nullptr && Marked(node->Next()[0].load(std::memory_order_acquire))) {
+        node = Ptr(node->Next()[0].load(std::memory_order_acquire));
+    }
+    return node;
+}
+
+template <typename Iter, typename Pred>
+/*static*/
+typename ConcurrentOrderedMultiSet<Iter, Pred>::Node*
+ConcurrentOrderedMultiSet<Iter, Pred>::NextLive(Node* node) noexcept {
+    do {
+        node = Ptr(node->Next()[0].load(std::memory_order_acquire));
+    } while (node != nullptr && Marked(node->Next()[0].load(std::memory_order_acquire)));
+    return node;
+}
+
+template <typename Iter, typename Pred>
+typename ConcurrentOrderedMultiSet<Iter, Pred>::Node*
+ConcurrentOrderedMultiSet<Iter, Pred>::Prev(Node* node) const noexcept {
+    Node* pred = nullptr;
+    if (node == nullptr) { // the last node, everything is before the end
+        Node* curr = nullptr;
+        for (uint32_t level = m_height.load(std::memory_order_acquire); level-- > 0;) {
+            curr = Ptr((pred != nullptr ? pred->Next()[level] : m_head[level]).load(std::memory_order_acquire));
+            for (; curr != nullptr; curr = Ptr(curr->Next()[level].load(std::memory_order_acquire))) {
+                if (!Marked(curr->Next()[level].load(std::memory_order_acquire))) {
+                    pred = curr;
+                }
+            }
+        }
+    } else {
+        Locate(*node->m_key, &*node->m_key, false, &pred);
+    }
+    return pred;
+}
+
+template <typename Iter, typename Pred>
+bool ConcurrentOrderedMultiSet<Iter, Pred>::insert(bool, const Iter& key) noexcept {
+    const uint32_t height = RandomHeight();
+    Node* node = NewNode(key, height);
+    if (node == nullptr) {
+        return false;
+    }
+
+    uint32_t top = m_height.load(std::memory_order_relaxed);
+    while (top < height && !m_height.compare_exchange_weak(top, height, std::memory_order_acq_rel));
+
+    Link* links[kMaxHeight];
+    Node* succs[kMaxHeight];
+    const Value* object = &*key;
+    for (;;) { // the level 0 link makes the item visible
+        Search(*key, object, links, succs);
+        for (uint32_t level = 0; level < height; ++level) {
+            node->Next()[level].store(reinterpret_cast<uintptr_t>(succs[level]), std::memory_order_relaxed);
+        }
+
+        uintptr_t expected = reinterpret_cast<uintptr_t>(succs[0]);
+        if (links[0]->compare_exchange_strong(expected, reinterpret_cast<uintptr_t>(node), std::memory_order_acq_rel, std::memory_order_relaxed)) {
+            break;
+        }
+    }
+    m_totalItems.fetch_add(1, std::memory_order_relaxed);
+
+    // the upper levels are shortcuts, a concurrent erase stops the linking
+    for (uint32_t level = 1; level < height; ++level) {
+        for (;;) {
+            uintptr_t next = node->Next()[level].load(std::memory_order_acquire);
+            if (Marked(next)) {
+                level = height;
+                break;
+            }
+
+            const uintptr_t succ = reinterpret_cast<uintptr_t>(succs[level]);
+            if (next != succ && !node->Next()[level].compare_exchange_strong(next, succ, std::memory_order_acq_rel)) {
+                continue; // marked meanwhile
+            }
+
+            uintptr_t expected = succ;
+            if (links[level]->compare_exchange_strong(expected, reinterpret_cast<uintptr_t>(node), std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                break;
+            }
+
+            Search(*key, object, links, succs);
+            if (succs[0] != node) { // erased meanwhile
+                level = height;
+                break;
+            }
+        }
+    }
+
+    Release(node);
+    return true;
+}
+
+template <typename Iter, typename Pred>
+bool ConcurrentOrderedMultiSet<Iter, Pred>::Remove(Node* node) noexcept {
+    // the upper levels first, the level 0 mark is the erase
+    for (uint32_t level = node->m_height; level-- > 1;) {
+        uintptr_t next = node->Next()[level].load(std::memory_order_acquire);
+        while (!Marked(next) && !node->Next()[level].compare_exchange_weak(next, next | 1, std::memory_order_acq_rel));
+    }
+
+    uintptr_t next = node->Next()[0].load(std::memory_order_acquire);
+    do {
+        if (Marked(next)) {
+            return false;
+        }
+    } while (!node->Next()[0].compare_exchange_weak(next, next | 1, std::memory_order_acq_rel));
+
+    m_totalItems.fetch_sub(1, std::memory_order_relaxed);
+    Release(node);
+    return true;
+}
+
+template <typename Iter, typename Pred>
+void ConcurrentOrderedMultiSet<Iter, Pred>::Release(Node* node) noexcept {
+    if (node->m_refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+
+    // nobody links the node anymore, unlink it from every level before the readers lose track of it
+    Link* links[kMaxHeight];
+    Node* succs[kMaxHeight];
+    Search(*node->m_key, &*node->m_key, links, succs);
+    EpochManager::Instance().Retire(this, [node]() { DeleteNode(node); });
+}
+
+template <typename Iter, typename Pred>
+size_t ConcurrentOrderedMultiSet<Iter, Pred>::erase(Iter key) noexcept {
+    Node* node = Locate(*key, &*key, false);
+    if (node == nullptr || node->m_key != key) {
+        return 0;
+    }
+
+    return Remove(node) ? 1 : 0;
+}
+
+template <typename Iter, typename Pred>
+IndexStats ConcurrentOrderedMultiSet<Iter, Pred>::stats(size_t reads, size_t writes) const noexcept {
+    IndexStats stats;
+    stats.items = size();
+    stats.buckets = stats.items;
+    stats.slots = stats.items;
+    stats.capacity = 1;
+    stats.recommended = 1;
+    stats.reads = reads;
+    stats.writes = writes;
+    return stats;
+}
+
+template <typename Iter, typename Pred>
+void ConcurrentOrderedMultiSet<Iter, Pred>::sort_keys(std::vector<Iter>& keys) const noexcept {
+    // stable, equal keys keep the batch order
+    std::stable_sort(keys.begin(), keys.end(), [this](const Iter& first, const Iter& second) -> bool { return m_compare(*first, *second); });
+}
+
+template <typename Iter, typename Pred>
+std::pair<typename ConcurrentOrderedMultiSet<Iter, Pred>::iterator, typename ConcurrentOrderedMultiSet<Iter, Pred>::iterator>
+ConcurrentOrderedMultiSet<Iter, Pred>::equal_range(const Value& key) const noexcept {
+    // the end stops the walk after the equal keys, no second search
+    return {iterator(this, Locate(key, nullptr, false)), iterator(this, nullptr, &key)};
+}
+
+template <typename Iter, typename Pred>
+typename ConcurrentOrderedMultiSet<Iter, Pred>::iterator
+ConcurrentOrderedMultiSet<Iter, Pred>::find(const Value& key) const noexcept {
+    Node* node = Locate(key, nullptr, false);
+    return iterator(this, node != nullptr && !m_compare(key, *node->m_key) ? node : nullptr);
+}
+
+template <typename Iter, typename Pred>
+void ConcurrentOrderedMultiSet<Iter, Pred>::clear() noexcept {
+    EpochGuard guard;
+    for (Node* node = First(); node != nullptr;) {
+        Node* next = NextLive(node);
+        Remove(node);
+        node = next;
+    }
+}
+
+template <typename Iter, typename Pred>
+template <typename V>
+void ConcurrentOrderedMultiSet<Iter, Pred>::for_each(V&& visitor) const noexcept {
+    for (auto bDirIt = begin(), eDirIt = end(); bDirIt != eDirIt; ++bDirIt) {
+        visitor(*bDirIt);
+    }
+}
+
+template <typename Iter, typename Pred>
+void ConcurrentOrderedMultiSet<Iter, Pred>::traverse() const noexcept {
+    EpochGuard guard;
+    for (auto bDirIt = begin(), eDirIt = end(); bDirIt != eDirIt; ++bDirIt) {
+        printf("Item(concurrent ordered): %d\n", (*bDirIt)->i);
+    }
+    printf("_______________________\n");
+}
@@ -0,0 +1,153 @@
+//
+//  ConcurrentUnOrderedMultiSet.h
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+
+#include "EpochReclamation.h"
+#include "HashedMultiSet.h"
+#include "Instrumentation.h"
+
+// Hashed index for concurrent readers and writers without the table lock.
+// [0][1][2]...[M] - atomic bucket heads
+// [0] -> node -> node -> ... - singly linked chains of iterators
+// Readers walk the chains without locks inside an epoch (EpochGuard),
+// writers of the same bucket are serialized by a striped lock, unlinked nodes are retired.
+// Rehash builds a new table and retires the old one, readers keep walking the old chains.
+template <uint32_t Capacity, typename Iter, typename Pred>
+class ConcurrentUnOrderedMultiSet {
+    using Value = std::remove_reference_t<decltype(*std::declval<Iter>())>;
+    static constexpr size_t kStripes = 64;
+
+    struct Node {
+        Iter m_key;
+        size_t m_hash;
+        std::atomic<Node*> m_next{nullptr};
+    };
+
+    struct BucketTable {
+        size_t m_size;
+        std::unique_ptr<std::atomic<Node*>[]> m_buckets;
+
+        explicit BucketTable(size_t size) : m_size(size), m_buckets(new std::atomic<Node*>[size]()) {}
+    };
+
+public:
+    // just pointers
+    using const_iterator = const Iter*;
+
+    // walks the chain and stops on the items equal to the key only
+    template <typename K>
+    class iterator {
+        const Node* m_node{nullptr};
+        const K* m_key{nullptr};
+        const Pred* m_compare{nullptr};
+        size_t m_hash{0};
+
+        inline void Skip() noexcept {
+            while (m_node != nullptr && (m_node->m_hash != m_hash || !(*m_compare)(*m_key, *m_node->m_key))) {
+                m_node = m_node->m_next.load(std::memory_order_acquire);
+            }
+        }
+
+    public:
+        iterator() noexcept = default;
+        iterator(const Node* node, const K* key, const Pred* compare, size_t hash) noexcept :
+            m_node(node), m_key(key), m_compare(compare), m_hash(hash) {
+            Skip();
+        }
+
+        inline iterator& operator++() noexcept {
+            m_node = m_node->m_next.load(std::memory_order_acquire);
+            Skip();
+            return *this;
+        }
+
+        inline const Iter& operator*() const noexcept { return m_node->m_key; }
+
+        inline bool operator==(const iterator& right) const noexcept { return m_node == right.m_node; }
+        inline bool operator!=(const iterator& right) const noexcept { return m_node != right.m_node; }
+    };
+
+private:
+    // locks the stripe owning the bucket of @hash in the current table
+    std::unique_lock<std::mutex> LockBucket(size_t hash, BucketTable*& table) noexcept;
+    void LockAll() noexcept;
+    void UnlockAll() noexcept;
+    // grows the table to @count buckets, or shrinks it if @shrink is set
+    void Rehash(size_t count, bool shrink = false) noexcept;
+    void RetireTable(BucketTable* table) noexcept;
+
+    static void DestroyTable(BucketTable* table) noexcept;
+
+    const HashedMultiSetSettings m_settings;
+    const Pred m_compare; // hasher & equal operators
+    std::atomic<BucketTable*> m_table;
+    std::atomic<size_t> m_totalItems{0};
+    std::mutex m_stripes[kStripes];
+#if defined(MULTIINDEX_INSTRUMENTATION)
+    mutable IndexEvents m_events;
+#endif
+
+    ConcurrentUnOrderedMultiSet(const ConcurrentUnOrderedMultiSet& src) noexcept = delete;
+    ConcurrentUnOrderedMultiSet(ConcurrentUnOrderedMultiSet&&) noexcept = delete;
+
+protected:
+    explicit ConcurrentUnOrderedMultiSet(TupleParams<Pred>&& params) noexcept;
+    ~ConcurrentUnOrderedMultiSet() noexcept;
+
+    template <typename K>
+    bool is_equal(const K& first, const K& second) const noexcept;
+
+    bool insert(bool noRehash, const Iter& key) noexcept;
+
+    // erase
+    size_t erase(Iter key) noexcept;
+
+    void reserve(size_t count) noexcept;
+
+    size_t size() const noexcept { return m_totalItems.load(std::memory_order_relaxed); }
+#if defined(MULTIINDEX_INSTRUMENTATION)
+    IndexEvents& events() const noexcept { return m_events; }
+#endif
+
+    // shrinks the oversized table in one step, the chains have no slack to trim
+    bool compact(size_t steps, float fill) noexcept;
+
+    // chains allocate a node per item, there is no bucket capacity to tune
+    void set_capacity(uint32_t) noexcept {}
+    // must be called inside an epoch
+    IndexStats stats(size_t reads, size_t writes) const noexcept;
+
+    // sorts @keys by the bucket of the current table, batched inserts take every stripe once per bucket
+    void sort_keys(std::vector<Iter>& keys) const noexcept;
+
+    // equal_range, must be called inside an epoch
+    template <typename K>
+    std::pair<iterator<K>, iterator<K>> equal_range(const K& key) const noexcept;
+
+    // find the first item by the key, must be called inside an epoch
+    template <typename K>
+    const_iterator find(const K& key) const noexcept;
+
+    static const_iterator end() noexcept { return nullptr; }
+
+    // clear
+    void clear() noexcept;
+
+    // visits every item, must be called inside an epoch.
+    // Type V should have: void operator()(const Iter& key)
+    template <typename V>
+    void for_each(V&& visitor) const noexcept;
+
+    // traverse
+    void traverse() const noexcept;
+};
+
+#include "ConcurrentUnOrderedMultiSet.hpp"
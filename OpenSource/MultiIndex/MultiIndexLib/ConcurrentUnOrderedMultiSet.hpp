@@ -0,0 +1,251 @@
+//
+//  ConcurrentUnOrderedMultiSet.hpp
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::ConcurrentUnOrderedMultiSet(TupleParams<Pred>&& params) noexcept :
+    m_settings(std::get<0>(params), std::get<1>(params)),
+    m_compare(std::move(std::get<2>(params))),
+    m_table(new BucketTable(m_settings.minBucketCount != 0 ? m_settings.minBucketCount : 1)) {
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::~ConcurrentUnOrderedMultiSet() noexcept {
+    // nobody can reach the index anymore, release the retired tables as well
+    EpochManager::Instance().Flush(this);
+    DestroyTable(m_table.load());
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+/*static*/
+void ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::DestroyTable(BucketTable* table) noexcept {
+    for (size_t i = 0; i < table->m_size; ++i) {
+        for (Node* node = table->m_buckets[i].load(std::memory_order_relaxed); node != nullptr;) {
+            Node* next = node->m_next.load(std::memory_order_relaxed);
+            delete node;
+            node = next;
+        }
+    }
+    delete table;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+void ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::RetireTable(BucketTable* table) noexcept {
+    EpochManager::Instance().Retire(this, [table]() { DestroyTable(table); });
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+std::unique_lock<std::mutex>
+ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::LockBucket(size_t hash, BucketTable*& table) noexcept {
+    for (;;) {
+        table = m_table.load(std::memory_order_acquire);
+        std::unique_lock<std::mutex> locker(m_stripes[(hash % table->m_size) % kStripes]);
+        // rehash holds all stripes, the table can't change while one is held
+        if (table == m_table.load(std::memory_order_acquire)) {
+            return locker;
+        }
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+void ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::LockAll() noexcept {
+    for (auto& stripe : m_stripes) {
+        stripe.lock();
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+void ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::UnlockAll() noexcept {
+    for (auto& stripe : m_stripes) {
+        stripe.unlock();
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+void ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::Rehash(size_t count, bool shrink) noexcept {
+    LockAll();
+    BucketTable* old = m_table.load(std::memory_order_relaxed);
+    if (shrink ? old->m_size <= count : old->m_size >= count) { // somebody else did it
+        UnlockAll();
+        return;
+    }
+    
+    MULTIINDEX_COUNT(m_events.rehashes);
+    // readers may walk the old chains, copy the nodes instead of relinking them
+    auto* table = new BucketTable(count);
+    for (size_t i = 0; i < old->m_size; ++i) {
+        for (Node* node = old->m_buckets[i].load(std::memory_order_relaxed); node != nullptr; node = node->m_next.load(std::memory_order_relaxed)) {
+            auto& head = table->m_buckets[node->m_hash % count];
+            Node* copy = new Node{node->m_key, node->m_hash};
+            copy->m_next.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            head.store(copy, std::memory_order_relaxed);
+        }
+    }
+    
+    m_table.store(table, std::memory_order_release);
+    UnlockAll();
+    RetireTable(old);
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+template <typename K>
+bool ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::is_equal(const K& first, const K& second) const noexcept {
+    return m_compare(first, second);
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+bool ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::insert(bool noRehash, const Iter& key) noexcept {
+    if (!noRehash) {
+        size_t tableSize = m_table.load(std::memory_order_acquire)->m_size;
+        if (float(size()) / tableSize > m_settings.maxLoadFactor) {
+            Rehash(tableSize * 2 + 1);
+        }
+    }
+    
+    const size_t hash = m_compare(*key);
+    Node* node = new Node{key, hash};
+    BucketTable* table = nullptr;
+    auto locker = LockBucket(hash, table);
+    auto& head = table->m_buckets[hash % table->m_size];
+    node->m_next.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    head.store(node, std::memory_order_release); // publish
+    m_totalItems.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+size_t ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::erase(Iter key) noexcept {
+    const size_t hash = m_compare(*key);
+    Node* node = nullptr;
+    {
+        BucketTable* table = nullptr;
+        auto locker = LockBucket(hash, table);
+        std::atomic<Node*>* link = &table->m_buckets[hash % table->m_size];
+        for (node = link->load(std::memory_order_relaxed); node != nullptr; node = link->load(std::memory_order_relaxed)) {
+            if (node->m_key == key) {
+                // readers standing on the node still see the rest of the chain
+                link->store(node->m_next.load(std::memory_order_relaxed), std::memory_order_release);
+                break;
+            }
+            link = &node->m_next;
+        }
+    }
+    
+    if (node == nullptr) {
+        return 0;
+    }
+    
+    m_totalItems.fetch_sub(1, std::memory_order_relaxed);
+    EpochManager::Instance().Retire(this, [node]() { delete node; });
+    return 1;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+void ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::reserve(size_t count) noexcept {
+    size_t required = size_t(float(count) / m_settings.maxLoadFactor) + 1;
+    if (required > m_table.load(std::memory_order_acquire)->m_size) {
+        Rehash(required);
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+bool ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::compact(size_t, float) noexcept {
+    size_t required = std::max(m_settings.minBucketCount, size_t(float(size()) / m_settings.maxLoadFactor) + 1);
+    if (m_table.load(std::memory_order_acquire)->m_size > required * 2) {
+        Rehash(required, true);
+    }
+    return true;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+IndexStats ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::stats(size_t reads, size_t writes) const noexcept {
+    IndexStats stats;
+    stats.items = size();
+    const BucketTable* table = m_table.load(std::memory_order_acquire);
+    for (size_t i = 0; i < table->m_size; ++i) {
+        if (table->m_buckets[i].load(std::memory_order_acquire) != nullptr) {
+            ++stats.buckets;
+        }
+    }
+    stats.slots = stats.items;
+    stats.capacity = 1;
+    stats.recommended = 1;
+    stats.reads = reads;
+    stats.writes = writes;
+    return stats;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+void ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::sort_keys(std::vector<Iter>& keys) const noexcept {
+    // hash every key once, a concurrent rehash only costs the locality
+    const size_t size = m_table.load(std::memory_order_acquire)->m_size;
+    std::vector<std::pair<size_t, Iter>> buckets;
+    buckets.reserve(keys.size());
+    for (const auto& key : keys) {
+        buckets.emplace_back(m_compare(*key) % size, key);
+    }
+    
+    std::stable_sort(buckets.begin(), buckets.end(), [](const auto& first, const auto& second) { return first.first < second.first; });
+    for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = buckets[i].second;
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+template <typename K>
+std::pair<typename ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::template iterator<K>,
+          typename ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::template iterator<K>>
+ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::equal_range(const K& key) const noexcept {
+    const size_t hash = m_compare(key);
+    const BucketTable* table = m_table.load(std::memory_order_acquire);
+    const Node* head = table->m_buckets[hash % table->m_size].load(std::memory_order_acquire);
+    return {iterator<K>(head, &key, &m_compare, hash), iterator<K>()};
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+template <typename K>
+typename ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::const_iterator
+ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::find(const K& key) const noexcept {
+    auto p = equal_range(key);
+    return p.first != p.second ? &*p.first : end();
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+void ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::clear() noexcept {
+    auto* table = new BucketTable(m_settings.minBucketCount != 0 ? m_settings.minBucketCount : 1);
+    LockAll();
+    BucketTable* old = m_table.exchange(table, std::memory_order_acq_rel);
+    m_totalItems.store(0, std::memory_order_relaxed);
+    UnlockAll();
+    RetireTable(old);
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+template <typename V>
+void ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::for_each(V&& visitor) const noexcept {
+    // a rehash copies the chains, the table seen first has all items inserted before
+    const BucketTable* table = m_table.load(std::memory_order_acquire);
+    for (size_t i = 0; i < table->m_size; ++i) {
+        for (const Node* node = table->m_buckets[i].load(std::memory_order_acquire); node != nullptr; node = node->m_next.load(std::memory_order_acquire)) {
+            visitor(node->m_key);
+        }
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+void ConcurrentUnOrderedMultiSet<Capacity, Iter, Pred>::traverse() const noexcept {
+    EpochGuard guard;
+    const BucketTable* table = m_table.load(std::memory_order_acquire);
+    for (size_t i = 0; i < table->m_size; ++i) {
+        const Node* node = table->m_buckets[i].load(std::memory_order_acquire);
+        if (node != nullptr) {
+            for (; node != nullptr; node = node->m_next.load(std::memory_order_acquire)) {
+                printf("Item(concurrent): %d\n", node->m_key->i);
+            }
+            printf(" | ");
+        }
+    }
+}
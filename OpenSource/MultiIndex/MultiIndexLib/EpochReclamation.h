@@ -0,0 +1,81 @@
+//
+//  EpochReclamation.h
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+// Epoch based memory reclamation for lock-free readers.
+// Readers enter the current epoch for the duration of a lookup (EpochGuard),
+// writers unlink nodes and retire them instead of deleting.
+// Retired memory is reclaimed once the global epoch moved twice past the retire epoch,
+// i.e. when no reader could still hold a reference to it.
+class EpochManager {
+    static constexpr uint64_t kIdle = ~uint64_t(0);
+    static constexpr size_t kReclaimThreshold = 64;
+
+    struct ThreadRecord {
+        std::atomic<uint64_t> m_epoch{kIdle}; // epoch observed by the active reader
+        std::atomic<bool> m_used{false};
+        uint32_t m_nesting{0}; // touched by the owner thread only
+        ThreadRecord* m_next{nullptr};
+    };
+
+    struct Retired {
+        uint64_t m_epoch;
+        const void* m_owner;
+        std::function<void()> m_reclaim;
+    };
+
+    std::atomic<uint64_t> m_epoch{0};
+    std::atomic<ThreadRecord*> m_records{nullptr}; // records are never deleted, only reused
+    std::mutex m_retiredMutex;
+    std::vector<Retired> m_retired;
+    // the next Reclaim attempt, twice the memory left by the last one, a long epoch doesn't make every retire rescan
+    size_t m_reclaimAt{kReclaimThreshold};
+
+    EpochManager() noexcept = default;
+    EpochManager(const EpochManager&) = delete;
+    EpochManager& operator=(const EpochManager&) = delete;
+
+    ThreadRecord* AcquireRecord() noexcept;
+    ThreadRecord* Record() noexcept;
+    bool TryAdvance() noexcept;
+
+public:
+    // process wide instance
+    static EpochManager& Instance() noexcept;
+
+    void Enter() noexcept;
+    void Leave() noexcept;
+
+    // @reclaim is called once no reader can reach the retired memory anymore,
+    // @owner tags the retired memory for Flush.
+    void Retire(const void* owner, std::function<void()>&& reclaim) noexcept;
+    // reclaims everything that is safe to reclaim
+    void Reclaim() noexcept;
+    // reclaims everything retired by @owner right away,
+    // the caller guarantees that no reader can access the owner anymore (destruction).
+    void Flush(const void* owner) noexcept;
+};
+
+// scoped reader/writer epoch
+class EpochGuard {
+public:
+    EpochGuard() noexcept { EpochManager::Instance().Enter(); }
+    ~EpochGuard() noexcept { EpochManager::Instance().Leave(); }
+
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+#include "EpochReclamation.hpp"
@@ -0,0 +1,124 @@
+//
+//  EpochReclamation.hpp
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+/*static*/
+inline EpochManager& EpochManager::Instance() noexcept {
+    // never destroyed, tables with static storage duration may flush on exit
+    static EpochManager* instance = new EpochManager;
+    return *instance;
+}
+
+inline EpochManager::ThreadRecord* EpochManager::AcquireRecord() noexcept {
+    // reuse a record of the exited thread, if any
+    for (ThreadRecord* record = m_records.load(std::memory_order_acquire); record != nullptr; record = record->m_next) {
+        bool expected = false;
+        if (!record->m_used.load(std::memory_order_relaxed)
+            && record->m_used.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+            return record;
+        }
+    }
+    
+    ThreadRecord* record = new ThreadRecord;
+    record->m_used.store(true, std::memory_order_relaxed);
+    ThreadRecord* head = m_records.load(std::memory_order_relaxed);
+    do {
+        record->m_next = head;
+    } while (!m_records.compare_exchange_weak(head, record, std::memory_order_release, std::memory_order_relaxed));
+    
+    return record;
+}
+
+inline EpochManager::ThreadRecord* EpochManager::Record() noexcept {
+    struct Holder {
+        ThreadRecord* m_record;
+        explicit Holder(ThreadRecord* record) : m_record(record) {}
+        ~Holder() {
+            m_record->m_epoch.store(kIdle, std::memory_order_release);
+            m_record->m_nesting = 0;
+            m_record->m_used.store(false, std::memory_order_release);
+        }
+    };
+    
+    static thread_local Holder holder(AcquireRecord());
+    return holder.m_record;
+}
+
+inline void EpochManager::Enter() noexcept {
+    ThreadRecord* record = Record();
+    if (record->m_nesting++ == 0) {
+        record->m_epoch.store(m_epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+        // publish the epoch before reading any shared pointer
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+inline void EpochManager::Leave() noexcept {
+    ThreadRecord* record = Record();
+    if (--record->m_nesting == 0) {
+        record->m_epoch.store(kIdle, std::memory_order_release);
+    }
+}
+
+inline bool EpochManager::TryAdvance() noexcept {
+    uint64_t epoch = m_epoch.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (ThreadRecord* record = m_records.load(std::memory_order_acquire); record != nullptr; record = record->m_next) {
+        uint64_t observed = record->m_epoch.load(std::memory_order_acquire);
+        if (observed != kIdle && observed != epoch) {
+            return false; // a reader is still in the previous epoch
+        }
+    }
+    
+    return m_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_acq_rel);
+}
+
+inline void EpochManager::Retire(const void* owner, std::function<void()>&& reclaim) noexcept {
+    bool reclaimNow = false;
+    {
+        std::lock_guard<std::mutex> locker(m_retiredMutex);
+        m_retired.push_back({m_epoch.load(std::memory_order_acquire), owner, std::move(reclaim)});
+        reclaimNow = m_retired.size() >= m_reclaimAt;
+    }
+    
+    if (reclaimNow) {
+        Reclaim();
+    }
+}
+
+inline void EpochManager::Reclaim() noexcept {
+    TryAdvance();
+    const uint64_t epoch = m_epoch.load(std::memory_order_acquire);
+    std::vector<Retired> ready;
+    {
+        std::lock_guard<std::mutex> locker(m_retiredMutex);
+        auto it = std::partition(m_retired.begin(), m_retired.end(),
+                                 [epoch](const Retired& item) { return item.m_epoch + 2 > epoch; });
+        std::move(it, m_retired.end(), std::back_inserter(ready));
+        m_retired.erase(it, m_retired.end());
+        m_reclaimAt = std::max(kReclaimThreshold, m_retired.size() * 2);
+    }
+    
+    // outside of the lock, reclaim callbacks may retire more memory
+    for (auto& item : ready) {
+        item.m_reclaim();
+    }
+}
+
+inline void EpochManager::Flush(const void* owner) noexcept {
+    std::vector<Retired> ready;
+    {
+        std::lock_guard<std::mutex> locker(m_retiredMutex);
+        auto it = std::partition(m_retired.begin(), m_retired.end(),
+                                 [owner](const Retired& item) { return item.m_owner != owner; });
+        std::move(it, m_retired.end(), std::back_inserter(ready));
+        m_retired.erase(it, m_retired.end());
+    }
+    
+    for (auto& item : ready) {
+        item.m_reclaim();
+    }
+}
@@ -7,8 +7,52 @@
 
 #pragma once
 
+#include <algorithm>
+#include <functional>
+#include <type_traits>
 #include <vector>
 
+#include "Instrumentation.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+
+// cache line prefetch hint, no-op where the compiler has none
+inline void PrefetchLine(const void* address) noexcept {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#elif defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
+}
+
+struct GroupedUnOrderedTraits;
+struct GroupedHashedOrderedTraits;
+
+// the stored objects of the tables with the grouped indices keep their positions in the posting lists,
+// one per grouped index
+template <size_t N>
+struct IndexPositions {
+    uint32_t m_positions[N];
+};
+
+template <>
+struct IndexPositions<0> {};
+
+// the grouped indices keep every distinct key once with the posting list of its objects
+template <typename Iter>
+struct HashedGroup {
+    Iter* m_items{nullptr}; // unordered, see IndexPositions
+    uint32_t m_size{0};
+    uint32_t m_capacity{0};
+
+    // the first object represents the key
+    inline auto& operator*() const noexcept { return *m_items[0]; }
+};
 
 struct HashedMultiSetSettings {
     HashedMultiSetSettings(size_t hashSize, float loadFactor) :
@@ -22,15 +66,25 @@ struct HashedMultiSetSettings {
 // to reduce the memory usage overhead.
 // [0][1][2]...[M] - buckets
 // [0] -> [0][1][2]...[N] - array of iterators ordered by derived class
+// The grouped indices (GroupedUnOrderedTraits, GroupedHashedOrderedTraits) keep the groups instead of the iterators,
+// the key is compared once per group and the objects of the key are one posting list:
+// [0] -> [0][1][2]...[N] - array of groups ordered by derived class
+//         [0] -> [0][1][2]...[K] - array of iterators, every object keeps its position
 template <typename D, uint32_t Capacity, typename Iter, typename Pred>
 class HashedMultiSet {
 public:
     // just pointers
     using iterator = Iter*;
     using const_iterator = const Iter*;
+    static constexpr bool kGrouped = std::is_base_of<GroupedUnOrderedTraits, Pred>::value || std::is_base_of<GroupedHashedOrderedTraits, Pred>::value;
+    // the grouped erase takes the object position in the posting list, the plain erase looks for the object
+    // among the bucket items, no scan of the equal keys
+    static constexpr bool kDirectErase = true;
+    // bucket item, dereferences into the object
+    using Slot = std::conditional_t<kGrouped, HashedGroup<Iter>, Iter>;
 protected:
     struct Bucket {
-        Iter* m_head{nullptr};
+        Slot* m_head{nullptr};
         uint32_t m_capacity{0};
         uint32_t m_size{0};
     };
@@ -39,16 +93,37 @@ protected:
     // rehash the table
     void Rehash(size_t count) noexcept;
 
-    inline static bool Insert(Bucket& bucket, const Iter& key, const Pred& pred) noexcept;
+    // inserts @slot before the first slot of the same key, @capacity is the initial allocation of the empty bucket
+    inline static bool Insert(Bucket& bucket, const Slot& slot, const Pred& pred, uint32_t capacity) noexcept;
+    // the slot of @key, nullptr if none
+    template <typename K>
+    inline static Slot* FindSlot(const Bucket& bucket, const K& key, const Pred& pred) noexcept;
+    // posting list operations, false on allocation failure or if @key is not there
+    inline bool AddToGroup(HashedGroup<Iter>& group, const Iter& key) const noexcept;
+    inline bool RemoveFromGroup(HashedGroup<Iter>& group, const Iter& key) const noexcept;
+    // bucket slots, the distinct keys of the grouped indices
+    size_t slots() const noexcept;
     
+    // frees the bucket arrays, the slots were moved to another table
+    static void FreeBuckets(BucketTable& table);
     // clear table
     static void ClearTable(BucketTable& table);
+    // frees the frozen items, the buckets must not be used after
+    void ReleaseFrozen() noexcept;
     
 
     const HashedMultiSetSettings m_settings;
     const Pred m_compare; // hasher & equal operators
     BucketTable m_table; // buckets container
     size_t m_totalItems{0}; // keeps track of total number of items.
+    size_t m_totalGroups{0}; // distinct keys of the grouped indices
+    size_t m_compactFrom{0}; // resume bucket of the time sliced compaction
+    uint32_t m_bucketCapacity{Capacity}; // runtime initial bucket allocation, never exceeds Capacity
+    uint32_t m_position{0}; // object position slot of the grouped index, see attach_position
+    Slot* m_frozen{nullptr}; // items of all buckets in the bucket order, see freeze
+#if defined(MULTIINDEX_INSTRUMENTATION)
+    mutable IndexEvents m_events;
+#endif
 
     HashedMultiSet(const HashedMultiSet& src) noexcept = delete;
     HashedMultiSet(HashedMultiSet&&) noexcept = delete;
@@ -57,15 +132,45 @@ protected:
     explicit HashedMultiSet(TupleParams<Pred>&& params) noexcept;
     ~HashedMultiSet() noexcept;
     
+    // the slot of the object positions, the grouped indices of a table get the distinct slots before the first insert
+    void attach_position(uint32_t slot) noexcept { m_position = slot; }
+    
     // equal_range
     template <typename K>
     bool is_equal(const K& first, const K& second) const noexcept;
 
     bool insert(bool noRehash, const Iter& key) noexcept;
     
+    // grows the table upfront to keep @count items within the max load factor,
+    // the grouped indices grow by the distinct keys, which are not known upfront
+    void reserve(size_t count) noexcept;
+    
+    size_t size() const noexcept { return m_totalItems; }
+#if defined(MULTIINDEX_INSTRUMENTATION)
+    IndexEvents& events() const noexcept { return m_events; }
+#endif
+    
+    // shrinks the oversized table on the first step, then trims the capacity of up to @steps buckets,
+    // returns true when the last bucket is reached, otherwise the next call resumes from where it stopped.
+    bool compact(size_t steps, float fill) noexcept;
+    
+    // runtime initial bucket allocation, clamped to Capacity, the existing buckets are trimmed by compact
+    void set_capacity(uint32_t capacity) noexcept;
+    
+    // structure statistics and the recommended capacity, hashed buckets don't depend on the workload mix,
+    // the grouped indices count the posting list slots
+    IndexStats stats(size_t reads, size_t writes) const noexcept;
+    
+    // sorts @keys by the bucket, batched inserts and erases visit every bucket once
+    void sort_keys(std::vector<Iter>& keys) const noexcept;
+    
     // erase
     size_t erase(Iter key) noexcept;
     
+    // erases the items @doomed returns true for in one pass over the table
+    template <typename F>
+    size_t erase_if(F&& doomed) noexcept;
+    
     // equal_range
     template <typename K>
     std::pair<const_iterator, const_iterator> equal_range(const K& key) const noexcept;
@@ -74,8 +179,22 @@ protected:
     template <typename K>
     const_iterator find(const K& key) const noexcept;
     
+    // staged find for the batched lookups, every stage prefetches the memory of the next one:
+    // the bucket of the key, the bucket items, the first object, then find in the bucket.
+    template <typename K>
+    size_t prefetch_bucket(const K& key) const noexcept;
+    void prefetch_items(size_t index) const noexcept;
+    void prefetch_object(size_t index) const noexcept;
+    template <typename K>
+    const_iterator find(size_t index, const K& key) const noexcept;
+    
     static const_iterator end() noexcept { return nullptr; }
     
+    // read only flat layout - inserts @items into the empty set, then moves the items of all buckets into one block,
+    // the buckets point into it, the grouped indices keep the posting lists. The set must not be modified until clear.
+    void freeze(std::vector<Iter>& items) noexcept;
+    bool frozen() const noexcept { return m_frozen != nullptr; }
+    
     // clear
     void clear() noexcept;
     
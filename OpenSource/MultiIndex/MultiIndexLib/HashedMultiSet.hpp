@@ -14,28 +14,71 @@ HashedMultiSet<D, Capacity, Iter, Pred>::HashedMultiSet(TupleParams<Pred>&& para
 
 template <typename D, uint32_t Capacity, typename Iter, typename Pred>
 HashedMultiSet<D, Capacity, Iter, Pred>::~HashedMultiSet() noexcept {
+    ReleaseFrozen();
     ClearTable(m_table);
 }
 
 template <typename D, uint32_t Capacity, typename Iter, typename Pred>
 /*static*/
-void HashedMultiSet<D, Capacity, Iter, Pred>::ClearTable(BucketTable& table) {
+void HashedMultiSet<D, Capacity, Iter, Pred>::FreeBuckets(BucketTable& table) {
     for (auto& entry : table) {
         ::free(entry.m_head);
     }
     table.clear();
 }
 
+template <typename D, uint32_t Capacity, typename Iter, typename Pred>
+/*static*/
+void HashedMultiSet<D, Capacity, Iter, Pred>::ClearTable(BucketTable& table) {
+    if constexpr (kGrouped) {
+        for (auto& entry : table) {
+            for (uint32_t i = 0; i < entry.m_size; ++i) {
+                ::free(entry.m_head[i].m_items);
+            }
+        }
+    }
+    FreeBuckets(table);
+}
+
+template <typename D, uint32_t Capacity, typename Iter, typename Pred>
+size_t HashedMultiSet<D, Capacity, Iter, Pred>::slots() const noexcept {
+    if constexpr (kGrouped) {
+        return m_totalGroups;
+    } else {
+        return m_totalItems;
+    }
+}
+
+template <typename D, uint32_t Capacity, typename Iter, typename Pred>
+void HashedMultiSet<D, Capacity, Iter, Pred>::ReleaseFrozen() noexcept {
+    if (m_frozen == nullptr) {
+        return;
+    }
+    
+    // the buckets don't own their items, the groups still own the posting lists
+    for (auto& bucket : m_table) {
+        if constexpr (kGrouped) {
+            for (uint32_t i = 0; i < bucket.m_size; ++i) {
+                ::free(bucket.m_head[i].m_items);
+            }
+        }
+        bucket = Bucket();
+    }
+    ::free(m_frozen);
+    m_frozen = nullptr;
+}
+
 template <typename D, uint32_t Capacity, typename Iter, typename Pred>
 void HashedMultiSet<D, Capacity, Iter, Pred>::Rehash(size_t count) noexcept {
+    MULTIINDEX_COUNT(m_events.rehashes);
     std::vector<Bucket> table;
     table.resize(count);
 
-    // copy items
+    // copy items, the groups are moved with their posting lists
     for (auto& item : m_table) {
         for (size_t i = 0; i < item.m_size; ++i) {
-            if (!Insert(table[m_compare(*item.m_head[i]) % table.size()], item.m_head[i], m_compare)) { // memory
-                ClearTable(table);
+            if (!Insert(table[m_compare(*item.m_head[i]) % table.size()], item.m_head[i], m_compare, m_bucketCapacity)) { // memory
+                FreeBuckets(table);
                 return;
             }
         }
@@ -43,19 +86,19 @@ void HashedMultiSet<D, Capacity, Iter, Pred>::Rehash(size_t count) noexcept {
     
     // swap
     table.swap(m_table);
-    ClearTable(table);
+    FreeBuckets(table);
 }
 
 template <typename D, uint32_t Capacity, typename Iter, typename Pred>
 bool
-HashedMultiSet<D, Capacity, Iter, Pred>::Insert(Bucket& bucket, const Iter& key, const Pred& pred) noexcept {
+HashedMultiSet<D, Capacity, Iter, Pred>::Insert(Bucket& bucket, const Slot& slot, const Pred& pred, uint32_t capacity) noexcept {
     if (bucket.m_head == nullptr) {
-        bucket.m_capacity = Capacity;
-        bucket.m_head = (Iter*)::malloc(bucket.m_capacity * sizeof(Iter));
+        bucket.m_capacity = capacity;
+        bucket.m_head = (Slot*)::malloc(bucket.m_capacity * sizeof(Slot));
         bucket.m_size = 0;
     } else if (bucket.m_capacity == bucket.m_size) {
         bucket.m_capacity = bucket.m_size * 2;
-        auto* memPrt = (Iter*)::realloc(bucket.m_head, bucket.m_capacity * sizeof(Iter));
+        auto* memPrt = (Slot*)::realloc(bucket.m_head, bucket.m_capacity * sizeof(Slot));
         // allocation failure
         if (memPrt == nullptr) {
             return false;
@@ -65,19 +108,76 @@ HashedMultiSet<D, Capacity, Iter, Pred>::Insert(Bucket& bucket, const Iter& key,
     }
     
     // find the first same key, if any
-    auto ptr = D::template LowerInBucket<iterator>(bucket, *key, pred);
+    auto ptr = D::template LowerInBucket<Slot*>(bucket, *slot, pred);
 
     if (ptr != bucket.m_head + bucket.m_size) {
         // make a room
-        memmove(ptr + 1, ptr, sizeof(Iter) * (bucket.m_size - (ptr - bucket.m_head)));
+        memmove(ptr + 1, ptr, sizeof(Slot) * (bucket.m_size - (ptr - bucket.m_head)));
     }
     
-    memcpy(ptr, &key, sizeof(key));
+    memcpy(ptr, &slot, sizeof(slot));
     ++bucket.m_size;
         
     return true;
 }
 
+template <typename D, uint32_t Capacity, typename Iter, typename Pred>
+template <typename K>
+/*static*/
+typename HashedMultiSet<D, Capacity, Iter, Pred>::Slot*
+HashedMultiSet<D, Capacity, Iter, Pred>::FindSlot(const Bucket& bucket, const K& key, const Pred& pred) noexcept {
+    auto ptr = D::template LowerInBucket<Slot*>(bucket, key, pred);
+    if (ptr != bucket.m_head + bucket.m_size && D::template IsEqual<K>(key, **ptr, pred)) {
+        return ptr;
+    }
+    
+    return nullptr;
+}
+
+template <typename D, uint32_t Capacity, typename Iter, typename Pred>
+bool HashedMultiSet<D, Capacity, Iter, Pred>::AddToGroup(HashedGroup<Iter>& group, const Iter& key) const noexcept {
+    if (group.m_size == group.m_capacity) {
+        uint32_t capacity = group.m_capacity != 0 ? group.m_capacity * 2 : 1;
+        auto* memPrt = (Iter*)::realloc(group.m_items, capacity * sizeof(Iter));
+        // allocation failure
+        if (memPrt == nullptr) {
+            return false;
+        }
+        
+        group.m_items = memPrt;
+        group.m_capacity = capacity;
+    }
+    
+    key.Position(m_position) = group.m_size;
+    memcpy(group.m_items + group.m_size, &key, sizeof(key));
+    ++group.m_size;
+    return true;
+}
+
+template <typename D, uint32_t Capacity, typename Iter, typename Pred>
+bool HashedMultiSet<D, Capacity, Iter, Pred>::RemoveFromGroup(HashedGroup<Iter>& group, const Iter& key) const noexcept {
+    uint32_t position = key.Position(m_position);
+    if (position >= group.m_size || group.m_items[position] != key) {
+        return false;
+    }
+    
+    // the last object takes the place
+    --group.m_size;
+    if (position != group.m_size) {
+        group.m_items[position] = group.m_items[group.m_size];
+        group.m_items[position].Position(m_position) = position;
+    }
+    
+    // a shrunk group gives back half of the posting list, the failure keeps the old one
+    if (group.m_size != 0 && group.m_size * 4 < group.m_capacity) {
+        if (auto* memPrt = (Iter*)::realloc(group.m_items, group.m_size * 2 * sizeof(Iter))) {
+            group.m_items = memPrt;
+            group.m_capacity = group.m_size * 2;
+        }
+    }
+    return true;
+}
+
 //////////////////////////////
 template <typename D, uint32_t Capacity, typename Iter, typename Pred>
 template <typename K>
@@ -88,11 +188,32 @@ bool HashedMultiSet<D, Capacity, Iter, Pred>::is_equal(const K& first, const K&
 template <typename D, uint32_t Capacity, typename Iter, typename Pred>
 bool
 HashedMultiSet<D, Capacity, Iter, Pred>::insert(bool noRehash, const Iter& key) noexcept {
-    if (!noRehash && float(m_totalItems) / m_table.size() > m_settings.maxLoadFactor) {
+    if (!noRehash && float(slots()) / m_table.size() > m_settings.maxLoadFactor) {
         Rehash(m_table.size() * 2 + 1);
     }
 
-    bool res = Insert(m_table[m_compare(*key) % m_table.size()], key, m_compare);
+    auto& bucket = m_table[m_compare(*key) % m_table.size()];
+    bool res;
+    if constexpr (kGrouped) {
+        // one key compare per group, then the posting list
+        if (auto* group = FindSlot(bucket, *key, m_compare)) {
+            res = AddToGroup(*group, key);
+        } else {
+            Slot slot;
+            res = AddToGroup(slot, key);
+            if (res && !Insert(bucket, slot, m_compare, m_bucketCapacity)) {
+                ::free(slot.m_items);
+                res = false;
+            }
+            
+            if (res) {
+                ++m_totalGroups;
+            }
+        }
+    } else {
+        res = Insert(bucket, key, m_compare, m_bucketCapacity);
+    }
+    
     if (res) {
         ++m_totalItems;
     }
@@ -100,14 +221,124 @@ HashedMultiSet<D, Capacity, Iter, Pred>::insert(bool noRehash, const Iter& key)
     return res;
 }
 
+template <typename D, uint32_t Capacity, typename Iter, typename Pred>
+void HashedMultiSet<D, Capacity, Iter, Pred>::reserve(size_t count) noexcept {
+    if constexpr (kGrouped) {
+        return;
+    }
+    
+    size_t required = size_t(float(count) / m_settings.maxLoadFactor) + 1;
+    if (required > m_table.size()) {
+        // repeated small reservations grow the table geometrically, as the inserts do
+        Rehash(m_totalItems != 0 ? std::max(required, m_table.size() * 2 + 1) : required);
+    }
+}
+
+template <typename D, uint32_t Capacity, typename Iter, typename Pred>
+bool HashedMultiSet<D, Capacity, Iter, Pred>::compact(size_t steps, float) noexcept {
+    if (m_compactFrom == 0) {
+        size_t required = std::max(m_settings.minBucketCount, size_t(float(slots()) / m_settings.maxLoadFactor) + 1);
+        if (m_table.size() > required * 2) {
+            Rehash(required);
+        }
+    }
+    
+    for (; m_compactFrom < m_table.size() && steps != 0; ++m_compactFrom, --steps) {
+        auto& bucket = m_table[m_compactFrom];
+        if (bucket.m_head == nullptr) {
+            continue;
+        }
+        
+        if (bucket.m_size == 0) {
+            ::free(bucket.m_head);
+            bucket = Bucket();
+        } else if (bucket.m_capacity > std::max<uint32_t>(m_bucketCapacity, bucket.m_size)) {
+            uint32_t capacity = std::max<uint32_t>(m_bucketCapacity, bucket.m_size);
+            auto* memPrt = (Slot*)::realloc(bucket.m_head, capacity * sizeof(Slot));
+            if (memPrt != nullptr) { // keep the old bucket on allocation failure
+                bucket.m_head = memPrt;
+                bucket.m_capacity = capacity;
+            }
+        }
+        
+        if constexpr (kGrouped) {
+            for (uint32_t i = 0; i < bucket.m_size; ++i) {
+                auto& group = bucket.m_head[i];
+                if (group.m_capacity > group.m_size) {
+                    if (auto* memPrt = (Iter*)::realloc(group.m_items, group.m_size * sizeof(Iter))) {
+                        group.m_items = memPrt;
+                        group.m_capacity = group.m_size;
+                    }
+                }
+            }
+        }
+    }
+    
+    if (m_compactFrom < m_table.size()) {
+        return false;
+    }
+    
+    m_compactFrom = 0;
+    return true;
+}
+
+template <typename D, uint32_t Capacity, typename Iter, typename Pred>
+void HashedMultiSet<D, Capacity, Iter, Pred>::set_capacity(uint32_t capacity) noexcept {
+    m_bucketCapacity = std::clamp<uint32_t>(capacity, 1, Capacity);
+}
+
+template <typename D, uint32_t Capacity, typename Iter, typename Pred>
+void HashedMultiSet<D, Capacity, Iter, Pred>::sort_keys(std::vector<Iter>& keys) const noexcept {
+    // hash every key once
+    std::vector<std::pair<size_t, Iter>> buckets;
+    buckets.reserve(keys.size());
+    for (const auto& key : keys) {
+        buckets.emplace_back(m_compare(*key) % m_table.size(), key);
+    }
+    
+    std::stable_sort(buckets.begin(), buckets.end(), [](const auto& first, const auto& second) { return first.first < second.first; });
+    for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = buckets[i].second;
+    }
+}
+
+template <typename D, uint32_t Capacity, typename Iter, typename Pred>
+IndexStats HashedMultiSet<D, Capacity, Iter, Pred>::stats(size_t reads, size_t writes) const noexcept {
+    IndexStats stats;
+    stats.items = m_totalItems;
+    stats.capacity = m_bucketCapacity;
+    stats.reads = reads;
+    stats.writes = writes;
+    for (const auto& bucket : m_table) {
+        if (bucket.m_size != 0) {
+            ++stats.buckets;
+        }
+        stats.slots += bucket.m_capacity;
+        if constexpr (kGrouped) {
+            for (uint32_t i = 0; i < bucket.m_size; ++i) {
+                stats.slots += bucket.m_head[i].m_capacity;
+            }
+        }
+    }
+    
+    // the first allocation should fit the typical bucket, bigger ones grow by doubling
+    size_t typical = stats.buckets != 0 ? (slots() + stats.buckets - 1) / stats.buckets : 1;
+    stats.recommended = 1;
+    while (stats.recommended < typical && stats.recommended < Capacity) {
+        stats.recommended *= 2;
+    }
+    stats.recommended = std::min<uint32_t>(stats.recommended, Capacity);
+    return stats;
+}
+
 template <typename D, uint32_t Capacity, typename Iter, typename Pred>
 size_t HashedMultiSet<D, Capacity, Iter, Pred>::erase(Iter it) noexcept {
     auto& bucket = m_table[m_compare(*it) % m_table.size()];
 
     if (bucket.m_head != nullptr) {
-        if (bucket.m_capacity > Capacity && bucket.m_size * 2 < Capacity) {
-            bucket.m_capacity = Capacity;
-            auto* memPrt = (Iter*)::realloc(bucket.m_head, bucket.m_capacity * sizeof(Iter));
+        if (bucket.m_capacity > m_bucketCapacity && bucket.m_size * 2 < m_bucketCapacity) {
+            bucket.m_capacity = m_bucketCapacity;
+            auto* memPrt = (Slot*)::realloc(bucket.m_head, bucket.m_capacity * sizeof(Slot));
             if (memPrt == nullptr) { // allocation failure
                 return 0;
             }
@@ -115,15 +346,33 @@ size_t HashedMultiSet<D, Capacity, Iter, Pred>::erase(Iter it) noexcept {
             bucket.m_head = memPrt;
         }
         
-        for (auto p = D::template EqualKeys<iterator>(bucket, *it, m_compare); p.first != p.second; ++p.first) {
-            if (*p.first != it) {
-                continue;
+        if constexpr (kGrouped) {
+            // one key compare for the group, then the object position in the posting list
+            auto* group = FindSlot(bucket, *it, m_compare);
+            if (group == nullptr || !RemoveFromGroup(*group, it)) {
+                return 0;
             }
             
-            size_t offset = p.first - bucket.m_head;
+            if (group->m_size == 0) {
+                ::free(group->m_items);
+                memmove(group, group + 1, sizeof(Slot) * (bucket.m_size - (group - bucket.m_head) - 1));
+                --bucket.m_size;
+                --m_totalGroups;
+            }
+            
+            --m_totalItems;
+            return 1;
+        } else {
+            // the object among the bucket items, the keys are not compared
+            auto* ptr = std::find(bucket.m_head, bucket.m_head + bucket.m_size, it);
+            if (ptr == bucket.m_head + bucket.m_size) {
+                return 0;
+            }
+            
+            size_t offset = ptr - bucket.m_head;
             
             if (offset + 1 != bucket.m_size) { // last item
-                memmove(p.first, p.first + 1, sizeof(Iter) * (bucket.m_size - offset - 1));
+                memmove(ptr, ptr + 1, sizeof(Iter) * (bucket.m_size - offset - 1));
             }
             
             --bucket.m_size;
@@ -135,6 +384,58 @@ size_t HashedMultiSet<D, Capacity, Iter, Pred>::erase(Iter it) noexcept {
     return 0;
 }
 
+template <typename D, uint32_t Capacity, typename Iter, typename Pred>
+template <typename F>
+size_t HashedMultiSet<D, Capacity, Iter, Pred>::erase_if(F&& doomed) noexcept {
+    size_t erased = 0;
+    for (auto& bucket : m_table) {
+        // keeps the order of the survivors
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < bucket.m_size; ++i) {
+            if constexpr (kGrouped) {
+                auto& group = bucket.m_head[i];
+                uint32_t alive = 0;
+                for (uint32_t j = 0; j < group.m_size; ++j) {
+                    if (!doomed(group.m_items[j])) {
+                        group.m_items[j].Position(m_position) = alive;
+                        group.m_items[alive++] = group.m_items[j];
+                    }
+                }
+                
+                erased += group.m_size - alive;
+                group.m_size = alive;
+                if (alive != 0) {
+                    bucket.m_head[kept++] = group;
+                } else {
+                    ::free(group.m_items);
+                    --m_totalGroups;
+                }
+            } else if (!doomed(bucket.m_head[i])) {
+                bucket.m_head[kept++] = bucket.m_head[i];
+            }
+        }
+        
+        if (kept == bucket.m_size) {
+            continue;
+        }
+        
+        if constexpr (!kGrouped) {
+            erased += bucket.m_size - kept;
+        }
+        bucket.m_size = kept;
+        // the emptied buckets keep their memory for the next inserts, as erase does
+        if (bucket.m_capacity > m_bucketCapacity && bucket.m_size * 2 < m_bucketCapacity) {
+            if (auto* memPrt = (Slot*)::realloc(bucket.m_head, m_bucketCapacity * sizeof(Slot))) {
+                bucket.m_capacity = m_bucketCapacity;
+                bucket.m_head = memPrt;
+            }
+        }
+    }
+    
+    m_totalItems -= erased;
+    return erased;
+}
+
 template <typename D, uint32_t Capacity, typename Iter, typename Pred>
 template <typename K>
 std::pair<typename HashedMultiSet<D, Capacity, Iter, Pred>::const_iterator, typename HashedMultiSet<D, Capacity, Iter, Pred>::const_iterator>
@@ -145,29 +446,110 @@ HashedMultiSet<D, Capacity, Iter, Pred>::equal_range(const K& key) const noexcep
         return {end(), end()};
     }
     
-    return D::template EqualKeys<const_iterator>(bucket, key, m_compare);
+    if constexpr (kGrouped) {
+        // the posting list of the key
+        auto* group = FindSlot(bucket, key, m_compare);
+        if (group == nullptr) {
+            return {end(), end()};
+        }
+        
+        return {group->m_items, group->m_items + group->m_size};
+    } else {
+        return D::template EqualKeys<const_iterator>(bucket, key, m_compare);
+    }
 }
 
 template <typename D, uint32_t Capacity, typename Iter, typename Pred>
 template <typename K>
 typename HashedMultiSet<D, Capacity, Iter, Pred>::const_iterator
 HashedMultiSet<D, Capacity, Iter, Pred>::find(const K& key) const noexcept {
-    auto& bucket = m_table[m_compare(key) % m_table.size()];
-    if (bucket.m_head != nullptr) {
-        auto ptr = D::template LowerInBucket<const_iterator>(bucket, key, m_compare);
-        
-        if (ptr != bucket.m_head + bucket.m_size && D::template IsEqual<K>(key, **ptr, m_compare)) {
-            return ptr;
+    return find(m_compare(key) % m_table.size(), key);
+}
+
+template <typename D, uint32_t Capacity, typename Iter, typename Pred>
+template <typename K>
+typename HashedMultiSet<D, Capacity, Iter, Pred>::const_iterator
+HashedMultiSet<D, Capacity, Iter, Pred>::find(size_t index, const K& key) const noexcept {
+    auto& bucket = m_table[index];
+    if constexpr (kGrouped) {
+        auto* group = FindSlot(bucket, key, m_compare);
+        return group != nullptr ? group->m_items : end();
+    } else {
+        if (bucket.m_head != nullptr) {
+            auto ptr = D::template LowerInBucket<const_iterator>(bucket, key, m_compare);
+            
+            if (ptr != bucket.m_head + bucket.m_size && D::template IsEqual<K>(key, **ptr, m_compare)) {
+                return ptr;
+            }
         }
+        
+        return end();
+    }
+}
+
+template <typename D, uint32_t Capacity, typename Iter, typename Pred>
+template <typename K>
+size_t HashedMultiSet<D, Capacity, Iter, Pred>::prefetch_bucket(const K& key) const noexcept {
+    size_t index = m_compare(key) % m_table.size();
+    PrefetchLine(&m_table[index]);
+    return index;
+}
+
+template <typename D, uint32_t Capacity, typename Iter, typename Pred>
+void HashedMultiSet<D, Capacity, Iter, Pred>::prefetch_items(size_t index) const noexcept {
+    auto& bucket = m_table[index];
+    if (bucket.m_head != nullptr) {
+        PrefetchLine(bucket.m_head);
+    }
+}
+
+template <typename D, uint32_t Capacity, typename Iter, typename Pred>
+void HashedMultiSet<D, Capacity, Iter, Pred>::prefetch_object(size_t index) const noexcept {
+    auto& bucket = m_table[index];
+    if (bucket.m_size != 0) {
+        PrefetchLine(&*bucket.m_head[0]);
+    }
+}
+
+template <typename D, uint32_t Capacity, typename Iter, typename Pred>
+void HashedMultiSet<D, Capacity, Iter, Pred>::freeze(std::vector<Iter>& keys) noexcept {
+    if (m_frozen != nullptr || m_totalItems != 0 || keys.empty()) {
+        return;
     }
     
-    return end();
+    reserve(keys.size());
+    for (const auto& key : keys) {
+        insert(true, key);
+    }
+    
+    auto* items = (Slot*)::malloc(slots() * sizeof(Slot));
+    if (items == nullptr) { // allocation failure, stay mutable
+        return;
+    }
+    
+    // the buckets keep their item order
+    size_t offset = 0;
+    for (auto& bucket : m_table) {
+        if (bucket.m_size != 0) {
+            memcpy(items + offset, bucket.m_head, sizeof(Slot) * bucket.m_size);
+        }
+        ::free(bucket.m_head);
+        bucket.m_head = bucket.m_size != 0 ? items + offset : nullptr;
+        bucket.m_capacity = bucket.m_size;
+        offset += bucket.m_size;
+    }
+    m_frozen = items;
 }
 
 template <typename D, uint32_t Capacity, typename Iter, typename Pred>
 void HashedMultiSet<D, Capacity, Iter, Pred>::clear() noexcept {
+    ReleaseFrozen();
     ClearTable(m_table);
+    // keep the table usable for the following inserts
+    m_table.resize(m_settings.minBucketCount != 0 ? m_settings.minBucketCount : 1);
     m_totalItems = 0;
+    m_totalGroups = 0;
+    m_compactFrom = 0;
 }
 
 template <typename D, uint32_t Capacity, typename Iter, typename Pred>
@@ -176,7 +558,7 @@ void HashedMultiSet<D, Capacity, Iter, Pred>::traverse() const noexcept {
     for (auto it = m_table.begin(); it != m_table.end(); ++it) {
         if (it->m_head != nullptr) {
             for (auto idx = 0; idx < it->m_size; ++idx) {
-                printf("Item(unordered): %d\n", it->m_head[idx]->i);
+                printf("Item(unordered): %d\n", (*it->m_head[idx]).i);
             }
             printf(" | ");
         }
@@ -17,7 +17,7 @@ I
 HashedOrderedMultiSet<Capacity, Iter, Pred>::LowerInBucket(const typename BaseType::Bucket& bucket, const K& key, const Pred& pred) noexcept {
     // find the first the same key, if any
     return std::lower_bound(bucket.m_head, bucket.m_head + bucket.m_size, key,
-                                   [&pred](const Iter& first, const K& second) {
+                                   [&pred](const typename BaseType::Slot& first, const K& second) {
            return pred(*first, second);
        });
 }
@@ -29,7 +29,7 @@ std::pair<I, I>
 HashedOrderedMultiSet<Capacity, Iter, Pred>::EqualKeys(const typename BaseType::Bucket& bucket, const K& key, const Pred& pred) noexcept {
     auto lower = LowerInBucket<I>(bucket, key, pred);
     auto upper = std::upper_bound(decltype(bucket.m_head)(lower), bucket.m_head + bucket.m_size, key,
-                               [&pred](const K& first, const Iter& second) -> bool { return pred(first, *second); });
+                               [&pred](const K& first, const typename BaseType::Slot& second) -> bool { return pred(first, *second); });
     return {lower, upper};
 }
 
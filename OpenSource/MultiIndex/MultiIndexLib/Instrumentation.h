@@ -0,0 +1,234 @@
+//
+//  Instrumentation.h
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Compile time optional instrumentation of the tables - operation and index latencies, lock waits
+// and index restructuring events, see MultiIndexTable::GetMetrics.
+// Define MULTIINDEX_INSTRUMENTATION to collect them, otherwise the hooks compile to nothing
+// and the metrics stay zero. Costs two steady clock reads per table operation when enabled.
+
+// Log linear histogram of nanoseconds - four linear sub buckets per power of two,
+// a bucket is within 25% of its values.
+class LatencyHistogram {
+public:
+    static constexpr size_t kBuckets = 252; // 0, 1, 2, 3, then 4 per power of two up to 2^63
+
+    struct Snapshot {
+        std::array<uint64_t, kBuckets> counts{};
+        uint64_t count{0};
+        uint64_t total{0}; // sum of the values
+        uint64_t max{0};
+
+        uint64_t Mean() const noexcept { return count != 0 ? total / count : 0; }
+        // upper bound of the bucket holding the @p percentile, i.e. Percentile(99.9)
+        uint64_t Percentile(double p) const noexcept;
+    };
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> m_counts{};
+    std::atomic<uint64_t> m_total{0};
+    std::atomic<uint64_t> m_max{0};
+
+public:
+    static size_t BucketOf(uint64_t value) noexcept;
+    // smallest value of the bucket
+    static uint64_t LowerBound(size_t bucket) noexcept;
+
+    void Record(uint64_t value) noexcept;
+    Snapshot Get() const noexcept;
+    void Reset() noexcept;
+};
+
+// kinds of the timed table operations
+enum class TableOperation {
+    Insert = 0,
+    Update,
+    Delete,
+    Find, // lookups, conjunctive queries and order statistics
+    Scan, // cursors
+    Bulk // batches, loads, rebuilds, compaction, expiry, clear
+};
+
+constexpr size_t kTableOperations = size_t(TableOperation::Bulk) + 1;
+
+// index restructuring events, the index structures count them under the write lock
+struct IndexEvents {
+    std::atomic<uint64_t> rehashes{0}; // hashed indices
+    std::atomic<uint64_t> splits{0}; // ordered bucket splits
+    std::atomic<uint64_t> merges{0}; // ordered bucket merges
+};
+
+// Snapshot of the table instrumentation
+template<size_t N>
+struct TableMetrics {
+    struct Index {
+        LatencyHistogram::Snapshot latency; // operations through the index
+        uint64_t rehashes{0};
+        uint64_t splits{0};
+        uint64_t merges{0};
+    };
+
+    std::array<LatencyHistogram::Snapshot, kTableOperations> operations; // by TableOperation
+    std::array<Index, N> indices;
+    // contended lock acquisitions only, the uncontended ones cost nothing to record
+    LatencyHistogram::Snapshot readLockWaits;
+    LatencyHistogram::Snapshot writeLockWaits;
+};
+
+struct LockWaits {
+    LatencyHistogram read;
+    LatencyHistogram write;
+};
+
+// Times a table operation and makes its lock waits the current ones of the thread
+class OperationTimer {
+    using Clock = std::chrono::steady_clock;
+
+    LatencyHistogram& m_operation;
+    LatencyHistogram* m_index;
+    LockWaits* m_previous;
+    const Clock::time_point m_start;
+
+    OperationTimer(const OperationTimer&) = delete;
+    OperationTimer& operator=(const OperationTimer&) = delete;
+
+public:
+    OperationTimer(LatencyHistogram& operation, LatencyHistogram* index, LockWaits& waits) noexcept :
+        m_operation(operation), m_index(index), m_previous(Current()), m_start(Clock::now()) {
+        Current() = &waits;
+    }
+
+    ~OperationTimer() noexcept {
+        const uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_start).count();
+        m_operation.Record(elapsed);
+        if (m_index != nullptr) {
+            m_index->Record(elapsed);
+        }
+        Current() = m_previous;
+    }
+
+    // lock waits of the operation running on the thread, nullptr outside of the table operations
+    static LockWaits*& Current() noexcept {
+        static thread_local LockWaits* current = nullptr;
+        return current;
+    }
+};
+
+// Times a contended lock acquisition
+class LockWaitTimer {
+    using Clock = std::chrono::steady_clock;
+
+    const bool m_write;
+    const Clock::time_point m_start;
+
+public:
+    explicit LockWaitTimer(bool write) noexcept : m_write(write), m_start(Clock::now()) {}
+
+    ~LockWaitTimer() noexcept {
+        if (LockWaits* waits = OperationTimer::Current()) {
+            const uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_start).count();
+            (m_write ? waits->write : waits->read).Record(elapsed);
+        }
+    }
+};
+
+// Live instruments of a table with @N indices
+template<size_t N>
+struct TableInstruments {
+    static constexpr size_t kNoIndex = N;
+
+    std::array<LatencyHistogram, kTableOperations> m_operations;
+    std::array<LatencyHistogram, N> m_indices;
+    LockWaits m_lockWaits;
+
+    OperationTimer Time(TableOperation operation, size_t index = kNoIndex) noexcept {
+        return OperationTimer(m_operations[size_t(operation)], index < N ? &m_indices[index] : nullptr, m_lockWaits);
+    }
+};
+
+#if defined(MULTIINDEX_INSTRUMENTATION)
+#define MULTIINDEX_TIME(instruments, ...) auto multiIndexTimer = (instruments).Time(__VA_ARGS__)
+#define MULTIINDEX_COUNT(counter) (counter).fetch_add(1, std::memory_order_relaxed)
+#else
+#define MULTIINDEX_TIME(instruments, ...) ((void)0)
+#define MULTIINDEX_COUNT(counter) ((void)0)
+#endif
+
+//////////////////////////////
+inline size_t LatencyHistogram::BucketOf(uint64_t value) noexcept {
+    if (value < 4) {
+        return size_t(value);
+    }
+
+    size_t exponent = 63;
+#if defined(__GNUC__) || defined(__clang__)
+    exponent -= __builtin_clzll(value);
+#else
+    while ((value >> exponent) == 0) {
+        --exponent;
+    }
+#endif
+    // the two bits after the highest one select the sub bucket
+    return 4 * (exponent - 1) + ((value >> (exponent - 2)) & 3);
+}
+
+inline uint64_t LatencyHistogram::LowerBound(size_t bucket) noexcept {
+    if (bucket < 4) {
+        return bucket;
+    }
+
+    return uint64_t(4 + bucket % 4) << (bucket / 4 - 1);
+}
+
+inline void LatencyHistogram::Record(uint64_t value) noexcept {
+    m_counts[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    m_total.fetch_add(value, std::memory_order_relaxed);
+    uint64_t max = m_max.load(std::memory_order_relaxed);
+    while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed));
+}
+
+inline LatencyHistogram::Snapshot LatencyHistogram::Get() const noexcept {
+    Snapshot snapshot;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        snapshot.counts[i] = m_counts[i].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.counts[i];
+    }
+    snapshot.total = m_total.load(std::memory_order_relaxed);
+    snapshot.max = m_max.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+inline void LatencyHistogram::Reset() noexcept {
+    for (auto& count : m_counts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    m_total.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+inline uint64_t LatencyHistogram::Snapshot::Percentile(double p) const noexcept {
+    if (count == 0) {
+        return 0;
+    }
+
+    const uint64_t rank = uint64_t(p / 100 * (count - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return i + 1 < kBuckets ? (std::min)(LowerBound(i + 1) - 1, max) : max;
+        }
+    }
+    return max;
+}
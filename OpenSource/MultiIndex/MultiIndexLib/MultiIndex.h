@@ -7,30 +7,64 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <bitset>
+#include <chrono>
+#include <functional>
+#include <limits>
 #include <list>
+#include <memory>
 #include <optional>
 #include <set>
 #include <shared_mutex>
+#include <system_error>
+#include <thread>
 #include <tuple>
+#include <unordered_set>
 #include <vector>
 
 #if defined(_WIN32)
 #elif defined(__linux__)
 #include <stddef.h>
+#include <malloc.h>
 #else
 #endif
 
 template<typename Pred>
 using TupleParams = std::tuple<size_t, float, Pred>;
 
+// Index structure and sampled workload statistics, see MultiIndexTable::Tune
+struct IndexStats {
+    size_t items{0};
+    size_t buckets{0}; // non-empty buckets or tree nodes
+    size_t slots{0}; // allocated item slots in all buckets
+    size_t reads{0}; // sampled reads through the index
+    size_t writes{0}; // sampled table writes
+    uint32_t capacity{0}; // runtime bucket capacity
+    uint32_t recommended{0}; // recommended bucket capacity
+    size_t depth{0}; // tree height in nodes, 0 for hashed indices
+};
+
+#include "BitmapMultiSet.h"
+#include "ConcurrentOrderedMultiSet.h"
+#include "ConcurrentUnOrderedMultiSet.h"
+#include "EpochReclamation.h"
 #include "HashedOrderedMultiSet.h"
+#include "Instrumentation.h"
 #include "OrderedMultiSet.h"
+#include "PackedArena.h"
+#include "RadixMultiSet.h"
+#include "ResultCache.h"
+#include "SpatialMultiSet.h"
+#include "TableObserver.h"
 #include "UnOrderedMultiSet.h"
 
 enum class LockPolicy {
     Internal = 0, // API takes care of the proper read/write locking
-    External // caller should properly organize access to the API in multi-threaded environment.
+    External, // caller should properly organize access to the API in multi-threaded environment.
+    FlatCombining, // readers share the lock, writers publish operations and the lock owner applies them in batches
+    Concurrent // no table lock, all indices must be concurrent, readers and writers run inside epochs
 };
 
 template<LockPolicy>
@@ -43,6 +77,11 @@ template<>
 class ReadLock<LockPolicy::External> {
 public:
     ReadLock(std::shared_mutex&) {}
+    
+    template<typename F>
+    void Release(F&& f) {
+        f();
+    }
 };
 
 template<>
@@ -50,12 +89,40 @@ class ReadLock<LockPolicy::Internal> {
     std::shared_mutex& m_mutex;
 public:
     ReadLock<LockPolicy::Internal>(std::shared_mutex& mutex) : m_mutex(mutex) {
+#if defined(MULTIINDEX_INSTRUMENTATION)
+        if (!m_mutex.try_lock_shared()) {
+            LockWaitTimer timer(false);
+            m_mutex.lock_shared();
+        }
+#else
         m_mutex.lock_shared();
+#endif
     }
     
     ~ReadLock() {
         m_mutex.unlock_shared();
     }
+    
+    // runs @f without the lock, a writer may get in before the lock is back
+    template<typename F>
+    void Release(F&& f) {
+        m_mutex.unlock_shared();
+        f();
+        m_mutex.lock_shared();
+    }
+};
+
+template<>
+class ReadLock<LockPolicy::FlatCombining> : public ReadLock<LockPolicy::Internal> {
+public:
+    using ReadLock<LockPolicy::Internal>::ReadLock;
+};
+
+template<>
+class ReadLock<LockPolicy::Concurrent> {
+    EpochGuard m_guard;
+public:
+    ReadLock(std::shared_mutex&) {}
 };
 
 template<LockPolicy>
@@ -75,7 +142,14 @@ class WriteLock<LockPolicy::Internal> {
     std::shared_mutex& m_mutex;
 public:
     WriteLock(std::shared_mutex& mutex) : m_mutex(mutex) {
+#if defined(MULTIINDEX_INSTRUMENTATION)
+        if (!m_mutex.try_lock()) {
+            LockWaitTimer timer(true);
+            m_mutex.lock();
+        }
+#else
         m_mutex.lock();
+#endif
     }
     
     ~WriteLock() {
@@ -83,6 +157,101 @@ public:
     }
 };
 
+template<>
+class WriteLock<LockPolicy::FlatCombining> : public WriteLock<LockPolicy::Internal> {
+public:
+    using WriteLock<LockPolicy::Internal>::WriteLock;
+};
+
+template<>
+class WriteLock<LockPolicy::Concurrent> {
+    EpochGuard m_guard;
+public:
+    WriteLock(std::shared_mutex&) {}
+};
+
+// Executes write operations under the write lock of the policy
+template<LockPolicy L>
+class WriteCombiner {
+    std::shared_mutex& m_mutex;
+public:
+    WriteCombiner(std::shared_mutex& mutex) : m_mutex(mutex) {}
+    
+    template<typename F>
+    void Execute(F&& operation) noexcept {
+        WriteLock<L> locker(m_mutex);
+        operation();
+    }
+};
+
+// Flat combining - a writer publishes its operation into a slot, whoever gets the lock
+// applies all published operations in one pass while the table stays hot in its cache.
+// The caller returns as soon as its own operation is applied.
+template<>
+class WriteCombiner<LockPolicy::FlatCombining> {
+    static constexpr size_t kSlots = 64;
+    
+    struct Request {
+        void (*m_apply)(void*) noexcept;
+        void* m_operation;
+        std::atomic<bool> m_done{false};
+    };
+    
+    struct alignas(64) Slot { // own cache line per slot
+        std::atomic<Request*> m_request{nullptr};
+    };
+    
+    std::shared_mutex& m_mutex;
+    Slot m_slots[kSlots];
+    
+    void Combine() noexcept {
+        for (auto& slot : m_slots) {
+            Request* request = slot.m_request.load(std::memory_order_acquire);
+            if (request != nullptr) {
+                request->m_apply(request->m_operation);
+                slot.m_request.store(nullptr, std::memory_order_relaxed);
+                // request belongs to the waiting thread, don't touch it after that
+                request->m_done.store(true, std::memory_order_release);
+            }
+        }
+    }
+    
+public:
+    WriteCombiner(std::shared_mutex& mutex) : m_mutex(mutex) {}
+    
+    template<typename F>
+    void Execute(F&& operation) noexcept {
+        Request request;
+        request.m_apply = [](void* op) noexcept { (*static_cast<std::remove_reference_t<F>*>(op))(); };
+        request.m_operation = (void*)std::addressof(operation);
+        
+        // publish, starting from the thread's home slot
+        static thread_local const size_t home = std::hash<std::thread::id>{}(std::this_thread::get_id());
+        for (size_t slot = home, tried = 1; ; ++slot, ++tried) {
+            Request* expected = nullptr;
+            if (m_slots[slot % kSlots].m_request.compare_exchange_strong(expected, &request, std::memory_order_release)) {
+                break;
+            }
+            
+            if (tried == kSlots) { // every slot is busy, block on the lock instead of spinning
+                m_mutex.lock();
+                operation();
+                m_mutex.unlock();
+                return;
+            }
+        }
+        
+        while (!request.m_done.load(std::memory_order_acquire)) {
+            if (m_mutex.try_lock()) {
+                Combine();
+                m_mutex.unlock();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+};
+
 struct HashedOrderedTraits {};
 // Unordered (hashed) and ordered index predicate must be derived from HashedOrderedTraits
 // and define two operators, i.e.
@@ -95,25 +264,236 @@ struct UnOrderedTraits {};
 // hash operator: size_t operator()(const T& first) const;
 // equal operator: bool operator()(const T& first, const T& second) const;
 
+struct GroupedHashedOrderedTraits : HashedOrderedTraits {};
+struct GroupedUnOrderedTraits : UnOrderedTraits {};
+// Hashed index predicate derived from GroupedHashedOrderedTraits or GroupedUnOrderedTraits keeps every distinct key once
+// with the posting list of its objects, the key is compared once per group and every object keeps its position
+// in the posting list, so the erase doesn't depend on the number of duplicates.
+
 struct OrderedTraits {};
 // Ordered index predicate must be derived from OrderedTraits
 // and define one operator, i.e.
 // less operator: bool operator(const T& first, const T& second) const;
 
+struct RankedOrderedTraits : OrderedTraits {};
+// Ordered index predicate derived from RankedOrderedTraits keeps subtree item counts
+// and supports rank, nth object and range count queries in O(log n).
+
+struct RadixTraits {};
+// Radix (ART) index predicate must be derived from RadixTraits
+// and define one operator appending the byte comparable key of the object, i.e.
+// key operator: void operator()(const T& first, RadixKey& key) const;
+// see RadixAppend for the integer and string encodings.
+
+struct SpatialTraits {};
+// Spatial (R*-tree) index predicate must be derived from SpatialTraits,
+// declare the number of dimensions and define one operator filling the bounding box of the object, i.e.
+// static constexpr size_t Dimensions = 2;
+// box operator: void operator()(const T& first, SpatialBox<Dimensions>& box) const;
+// the objects with equal boxes are equal for the index.
+
+struct BitmapTraits {};
+// Bitmap index predicate for the low cardinality keys must be derived from BitmapTraits
+// and define two operators, i.e.
+// hash operator: size_t operator()(const T& first) const;
+// equal operator: bool operator()(const T& first, const T& second) const;
+// every distinct key keeps a compressed bitmap of the object handles, see FindByBitmap.
+
+struct ConcurrentTraits {};
+// Base of the indices which are safe for concurrent readers and writers without the table lock.
+// A LockPolicy::Concurrent table of them takes no table lock at all, every stored record is allocated
+// on its own and the erased records are reclaimed by epoch, see EpochManager.
+
+struct ConcurrentUnOrderedTraits : ConcurrentTraits {};
+// Concurrent unordered index predicate must be derived from ConcurrentUnOrderedTraits
+// and define two operators, i.e.
+// hash operator: size_t operator()(const T& first) const;
+// equal operator: bool operator()(const T& first, const T& second) const;
+
+struct ConcurrentOrderedTraits : ConcurrentTraits {};
+// Concurrent ordered index predicate must be derived from ConcurrentOrderedTraits
+// and define one operator, i.e.
+// less operator: bool operator(const T& first, const T& second) const;
+
+enum class IndexKind {
+    Unknown = 0,
+    HashedOrdered,
+    Ordered,
+    UnOrdered,
+    ConcurrentUnOrdered,
+    Radix,
+    ConcurrentOrdered,
+    Spatial,
+    Bitmap
+};
+
+// Per index bucket capacity, a predicate may declare its own, i.e.
+// static constexpr uint32_t Capacity = 8;
+// otherwise the table Capacity is used.
+template<typename Pred, uint32_t Default, typename = void>
+struct IndexCapacity {
+    static constexpr uint32_t value = Default;
+};
+
+template<typename Pred, uint32_t Default>
+struct IndexCapacity<Pred, Default, std::void_t<decltype(Pred::Capacity)>> {
+    static_assert(Pred::Capacity > 0, "Index capacity must be positive");
+    static constexpr uint32_t value = Pred::Capacity;
+};
+
+// Index erasing the given object without the scan of the equal keys, a set may declare it, i.e.
+// static constexpr bool kDirectErase = true;
+template<typename S, typename = void>
+struct DirectErase : std::false_type {};
+
+template<typename S>
+struct DirectErase<S, std::void_t<decltype(S::kDirectErase)>> : std::bool_constant<S::kDirectErase> {};
+
+// grouped hashed index, it keeps the object positions in the posting lists, see IndexPositions
+template<typename Pred>
+constexpr bool IsGroupedIndex() noexcept {
+    return std::is_base_of<GroupedUnOrderedTraits, Pred>::value || std::is_base_of<GroupedHashedOrderedTraits, Pred>::value;
+}
+
+// the stored objects keep their positions in the pending logs of the deferred indices, one per index
+template<size_t N>
+struct PendingPositions {
+    uint32_t m_pendingAt[N]{};
+};
+
+template<>
+struct PendingPositions<0> {};
+
+// detection of the index kind by the predicate traits
+template<typename Pred>
+constexpr IndexKind IndexKindOf() noexcept {
+    if constexpr (std::is_base_of<ConcurrentUnOrderedTraits, Pred>::value) {
+        return IndexKind::ConcurrentUnOrdered;
+    } else if constexpr (std::is_base_of<ConcurrentOrderedTraits, Pred>::value) {
+        return IndexKind::ConcurrentOrdered;
+    } else if constexpr (std::is_base_of<HashedOrderedTraits, Pred>::value) {
+        return IndexKind::HashedOrdered;
+    } else if constexpr (std::is_base_of<OrderedTraits, Pred>::value) {
+        return IndexKind::Ordered;
+    } else if constexpr (std::is_base_of<UnOrderedTraits, Pred>::value) {
+        return IndexKind::UnOrdered;
+    } else if constexpr (std::is_base_of<RadixTraits, Pred>::value) {
+        return IndexKind::Radix;
+    } else if constexpr (std::is_base_of<SpatialTraits, Pred>::value) {
+        return IndexKind::Spatial;
+    } else if constexpr (std::is_base_of<BitmapTraits, Pred>::value) {
+        return IndexKind::Bitmap;
+    } else {
+        return IndexKind::Unknown;
+    }
+}
+
 // class indexing T class objects by multiple predicates as indexes.
-// @Capacity defines the size of buckets for ordered and unordered indexes.
+// @Capacity defines the size of buckets for ordered and unordered indexes,
+// unless the predicate declares its own, see IndexCapacity.
 template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
 class MultiIndexTable
 {
     using ObjectContainer = std::list<T>;
-    using Iter = typename ObjectContainer::iterator;
+    
+    // the bitmap indices keep the object handles instead of the iterators
+    static constexpr bool kHandles = ((IndexKindOf<P>() == IndexKind::Bitmap) || ...);
+    // the grouped indices keep the back references of the objects into their posting lists
+    static constexpr size_t kPositions = (size_t(IsGroupedIndex<P>()) + ...);
+    // the ordered indices keep the back references of the objects to their bucket nodes
+    static constexpr size_t kNodes = (size_t(IndexKindOf<P>() == IndexKind::Ordered) + ...);
+    // the deferred indices keep the back references of the objects into their pending logs
+    static constexpr size_t kPending = L == LockPolicy::Concurrent ? 0 : sizeof...(P);
+
+    // stored object with the cache bookkeeping, see CacheOptions
+    struct Record : std::conditional_t<kHandles, BitmapHandle, NoBitmapHandle>, IndexPositions<kPositions>, IndexNodes<kNodes>, PendingPositions<kPending> {
+        static constexpr uint64_t kReferenced = uint64_t(1) << 63; // CLOCK reference bit
+        static constexpr uint64_t kErased = uint64_t(1) << 62; // bulk delete victim
+        static constexpr uint64_t kIndexed = uint64_t(1) << 61; // LockPolicy::Concurrent, all indices have the object
+        static constexpr uint64_t kUnlinked = uint64_t(1) << 60; // LockPolicy::Concurrent, a writer removed the object from the indices
+        static constexpr uint64_t kExpiry = kUnlinked - 1;
+        
+        template<typename O>
+        explicit Record(O&& obj) : m_object(std::forward<O>(obj)) {}
+        
+        T m_object;
+        // flags and the expiry time in steady clock milliseconds, 0 - never expires
+        mutable std::atomic<uint64_t> m_state{0};
+    };
+    using Storage = std::list<Record, PackedAllocator<Record>>;
+    // LockPolicy::Concurrent allocates every record on its own instead of linking it into the storage,
+    // the writers share no lock and the erased records are freed once no reader can see them
+    using RecordRef = std::conditional_t<L == LockPolicy::Concurrent, Record*, typename Storage::iterator>;
+    
+    // storage iterator dereferencing into the object, the indices keep it
+    class Iter {
+        RecordRef m_it;
+    public:
+        Iter() noexcept = default;
+        Iter(RecordRef it) noexcept : m_it(it) {}
+        
+        inline T& operator*() const noexcept { return m_it->m_object; }
+        inline T* operator->() const noexcept { return &m_it->m_object; }
+        inline Iter& operator++() noexcept { ++m_it; return *this; }
+        inline bool operator==(const Iter& right) const noexcept { return m_it == right.m_it; }
+        inline bool operator!=(const Iter& right) const noexcept { return m_it != right.m_it; }
+        
+        inline const Record& GetRecord() const noexcept { return *m_it; }
+        inline RecordRef Base() const noexcept { return m_it; }
+        // tables with the bitmap indices only
+        inline uint32_t Handle() const noexcept { return m_it->m_handle; }
+        // tables with the grouped indices only, the object position in the posting list of the @slot index
+        inline uint32_t& Position(uint32_t slot) const noexcept { return m_it->m_positions[slot]; }
+        // tables with the ordered indices only, the bucket node of the object in the @slot index
+        inline void*& Node(uint32_t slot) const noexcept { return m_it->m_nodes[slot]; }
+        // tables without LockPolicy::Concurrent only, the object position in the pending log of the @slot index,
+        // stale once the object left the log
+        inline uint32_t& Pending(uint32_t slot) const noexcept { return m_it->m_pendingAt[slot]; }
+    };
+
     using ItersContainer = std::list<Iter>;
     using BitRef = typename std::bitset<sizeof...(P)>::reference;
 
+public:
+    class Cursor;
+
+private:
+    // read access context, in the cache mode it marks the CLOCK reference bits
+    // and hides the expired objects.
+    struct Access {
+        bool m_touch{false};
+        uint64_t m_now{0}; // 0 - no expiry check
+        
+        // returns false if the object is expired
+        inline bool Visit(const Iter& iter) const noexcept;
+    };
+
     template<typename I, typename... ARGS>
     class CommonIndex : public I {
         CommonIndex(const CommonIndex& src) noexcept = delete;
         CommonIndex(CommonIndex&& src) noexcept = delete;
+        
+        ResultCache<T, Iter> m_results; // disabled by default, see SetResultCache
+        // deferred maintenance, see SetDeferred
+        bool m_deferred{false};
+        uint32_t m_slot{0}; // position of the index in the table, see Iter::Pending
+        std::vector<Iter> m_pending; // stored objects not inserted yet
+        std::atomic<bool> m_behind{false}; // m_pending is not empty, read without the lock
+        // appends the object to the pending log
+        void Defer(const Iter& iter) noexcept;
+        bool IsPending(const Iter& iter) const noexcept;
+        // takes the object out of the pending log, returns false if it isn't there
+        bool Undefer(const Iter& iter) noexcept;
+        // visits the matches of @what through the result cache, returns false if the cache is disabled.
+        // Type V should have: void operator()(const Iter& iter)
+        template<typename V>
+        bool VisitCached(V&& visitor, const T& what) const noexcept;
+        // the concurrent writers run in parallel and have no result cache, the epoch is not theirs to bump
+        void InvalidateResults() noexcept {
+            if constexpr (L != LockPolicy::Concurrent) {
+                m_results.Invalidate();
+            }
+        }
     public:
  
         CommonIndex(ARGS&&... args) noexcept;
@@ -122,55 +502,313 @@ class MultiIndexTable
         ItersContainer FindIterators(const T& where) const noexcept;
 
         void Insert(bool noRehash, const Iter& itRef, const BitRef affected) noexcept;
+        // Inserts [@first, @last) objects, @count is the number of objects in the range.
+        void Build(Iter first, Iter last, size_t count) noexcept;
+        // batched inserts and deletes, reorder @iters by the index locality
+        void InsertBatch(std::vector<Iter>& iters) noexcept;
+        void DeleteBatch(std::vector<Iter>& iters) noexcept;
+        // bulk deletes in one pass over the index, non concurrent indices only
+        // ordered indices only, removes the objects from @lo to @hi inclusive, returns the number of them
+        size_t DeleteRange(const T& lo, const T& hi) noexcept;
+        // removes the objects marked by Record::kErased
+        size_t DeleteMarked() noexcept;
+        // concurrent indices only, visits every object of the index.
+        // Type V should have: void operator()(const Iter& iter)
+        template<typename V>
+        void VisitAll(V&& visitor) const noexcept;
         void Update(const Iter& itRef, const T& what, BitRef isAffected) noexcept;
-        void Delete(const Iter& itRef) noexcept;
-        std::optional<T> FindFirst(const T& what) const noexcept;
-        ObjectContainer FindAll(const T& what) const noexcept;
+        // returns true if the index had the object
+        bool Delete(const Iter& itRef) noexcept;
+        std::optional<T> FindFirst(const T& what, const Access& access) const noexcept;
+        // hashed indices only, FindFirst of every key with the lookups of kBatchGroup keys in flight
+        void FindFirstBatch(const std::vector<T>& keys, std::vector<std::optional<T>>& results, const Access& access) const noexcept;
+        ObjectContainer FindAll(const T& what, const Access& access) const noexcept;
         // Type S should have: void operator()(const T& object)
         template<typename S>
-        void FindBySelector(S&& selector, const T& what) const noexcept;
+        void FindBySelector(S&& selector, const T& what, const Access& access) const noexcept;
+        // ordered indices only, visits up to @count objects from the cursor position
+        template<typename S>
+        size_t Scan(S&& selector, Cursor& cursor, size_t count, const Access& access) const noexcept;
+        // number of objects matching @what, the counting stops at @limit
+        size_t Estimate(const T& what, size_t limit) const noexcept;
+        // Type V should have: void operator()(const Iter& iter), objects are not dereferenced
+        template<typename V>
+        void VisitHandles(V&& visitor, const T& what) const noexcept;
+        // ordered indices only, visits the objects from @lo to @hi inclusive
+        template<typename V>
+        void VisitRange(V&& visitor, const T& lo, const T& hi) const noexcept;
+        // radix indices only, visits the objects with the keys starting with @prefix
+        template<typename V>
+        void VisitPrefix(V&& visitor, const RadixKey& prefix) const noexcept;
+        // spatial indices only, visits the objects with the boxes intersecting @box
+        template<typename V, size_t D>
+        void VisitBox(V&& visitor, const SpatialBox<D>& box) const noexcept;
+        // spatial indices only, visits the objects by the distance from @point, the nearest first,
+        // until @visitor returns false. Type V should have: bool operator()(const Iter& iter)
+        template<typename V, size_t D>
+        void VisitNearest(V&& visitor, const SpatialPoint<D>& point) const noexcept;
+        // bitmap indices only, the attachment is ignored by the others
+        void AttachHandles(const BitmapHandles<Iter>* handles) noexcept;
+        // grouped indices take the next @position slot, ordered indices take the next @node slot
+        void AttachPosition(uint32_t& position, uint32_t& node) noexcept;
+        // bitmap indices only, handles of the objects matching @what, nullptr if none
+        const RoaringBitmap* Bitmap(const T& what) const noexcept;
+        // true if the object matches @what by the index predicate
+        bool Matches(const T& object, const T& what) const noexcept;
+        // ranked ordered indices only
+        size_t Count(const T& lo, const T& hi) const noexcept;
+        size_t Rank(const T& key) const noexcept;
+        std::optional<T> Nth(size_t k) const noexcept;
+        // compacts the index until it is done or @deadline passes, returns true when done
+        bool Compact(std::chrono::steady_clock::time_point deadline, float fill) noexcept;
+        IndexStats Stats(size_t reads, size_t writes) const noexcept;
+        void SetCapacity(uint32_t capacity) noexcept;
+        // deferred maintenance, the inserts go to the pending log until Sync, the erases of the pending objects
+        // take them out of the log, @slot is the position of the index in the table
+        void SetDeferred(bool deferred, uint32_t slot) noexcept;
+        // applies the pending inserts in one batch
+        void Sync() noexcept;
+        // true if some inserts are pending, safe without the lock
+        bool Behind() const noexcept { return m_behind.load(std::memory_order_acquire); }
+        // result cache of @entries lookup keys, 0 disables it
+        void SetResultCache(size_t entries) noexcept;
+        ResultCacheStats GetResultCacheStats() const noexcept;
+        size_t Size() const noexcept;
+        // builds the read only flat layout of [@first, @last) objects, the index must be empty, Clear undoes it
+        void Freeze(Iter first, Iter last, size_t count) noexcept;
         void Clear() noexcept;
         void Traverse() const noexcept;
+#if defined(MULTIINDEX_INSTRUMENTATION)
+        IndexEvents& Events() const noexcept { return this->events(); }
+#endif
     };
 
-    // converts predicates types into Hashed/Unordered/Ordered indexes.
-    template<typename Pred, bool ordered, bool hashed>
+    // converts predicates types into Hashed/Unordered/Ordered/Concurrent indexes.
+    template<typename Pred, IndexKind kind>
     struct IdxType {};
 
     template<typename Pred>
-    struct IdxType<Pred, true, true> {
-        using Type = CommonIndex<HashedOrderedMultiSet<Capacity, Iter, Pred>, TupleParams<Pred>>;
+    struct IdxType<Pred, IndexKind::HashedOrdered> {
+        using Type = CommonIndex<HashedOrderedMultiSet<IndexCapacity<Pred, Capacity>::value, Iter, Pred>, TupleParams<Pred>>;
     };
     
     template<typename Pred>
-    struct IdxType<Pred, true, false> {
-        using Type = CommonIndex<OrderedMultiSet<Capacity, Iter, Pred>, TupleParams<Pred>>;
+    struct IdxType<Pred, IndexKind::Ordered> {
+        using Type = CommonIndex<OrderedMultiSet<IndexCapacity<Pred, Capacity>::value, Iter, Pred>, TupleParams<Pred>>;
     };
     
     template<typename Pred>
-    struct IdxType<Pred, false, true> {
-        using Type = CommonIndex<UnOrderedMultiSet<Capacity, Iter, Pred>, TupleParams<Pred>>;
+    struct IdxType<Pred, IndexKind::UnOrdered> {
+        using Type = CommonIndex<UnOrderedMultiSet<IndexCapacity<Pred, Capacity>::value, Iter, Pred>, TupleParams<Pred>>;
+    };
+
+    template<typename Pred>
+    struct IdxType<Pred, IndexKind::ConcurrentUnOrdered> {
+        using Type = CommonIndex<ConcurrentUnOrderedMultiSet<IndexCapacity<Pred, Capacity>::value, Iter, Pred>, TupleParams<Pred>>;
+    };
+
+    template<typename Pred>
+    struct IdxType<Pred, IndexKind::ConcurrentOrdered> {
+        using Type = CommonIndex<ConcurrentOrderedMultiSet<Iter, Pred>, TupleParams<Pred>>;
+    };
+
+    template<typename Pred>
+    struct IdxType<Pred, IndexKind::Radix> {
+        using Type = CommonIndex<RadixMultiSet<Iter, Pred>, TupleParams<Pred>>;
+    };
+
+    template<typename Pred>
+    struct IdxType<Pred, IndexKind::Spatial> {
+        using Type = CommonIndex<SpatialMultiSet<IndexCapacity<Pred, Capacity>::value, Iter, Pred>, TupleParams<Pred>>;
+    };
+
+    template<typename Pred>
+    struct IdxType<Pred, IndexKind::Bitmap> {
+        using Type = CommonIndex<BitmapMultiSet<Iter, Pred>, TupleParams<Pred>>;
     };
 
     // auto detection of the predicate type
     template<typename Pred>
     struct IdxDetector {
     private:
-        static_assert(std::is_base_of<UnOrderedTraits, Pred>::value ||
-                      std::is_base_of<OrderedTraits, Pred>::value ||
-                      std::is_base_of<HashedOrderedTraits, Pred>::value,
-                      "Predicate class must be derived from either OrderedTraits or UnOrderedTraits or HashedOrderedTraits");
+        static_assert(IndexKindOf<Pred>() != IndexKind::Unknown,
+                      "Predicate class must be derived from either OrderedTraits or UnOrderedTraits or HashedOrderedTraits or ConcurrentUnOrderedTraits or ConcurrentOrderedTraits or RadixTraits or SpatialTraits or BitmapTraits");
+        static_assert(L != LockPolicy::Concurrent || std::is_base_of<ConcurrentTraits, Pred>::value,
+                      "LockPolicy::Concurrent requires all predicates to be derived from ConcurrentTraits");
     public:
-        using Type = typename IdxType<Pred,
-            std::is_base_of<OrderedTraits, Pred>::value || std::is_base_of<HashedOrderedTraits, Pred>::value,
-            std::is_base_of<HashedOrderedTraits, Pred>::value || std::is_base_of<UnOrderedTraits, Pred>::value>::Type;
+        using Type = typename IdxType<Pred, IndexKindOf<Pred>()>::Type;
     };
 
-    ObjectContainer m_objects;
+    // storage operations, with LockPolicy::Concurrent the records are allocated one by one
+    // and erased records are retired until no reader can see them.
+    template<typename O>
+    Iter StoreObject(O&& obj, uint64_t expiry = 0) noexcept;
+    void EraseObject(const Iter& iter) noexcept;
+    
+    void InsertObject(T&& obj, uint64_t expiry, bool noRehash) noexcept;
+    
+    // LockPolicy::Concurrent, a writer may find the object through one index before the inserting writer
+    // adds it to the others. The one who comes last of the two erases the object.
+    // called by the inserting writer once all indices have the object
+    void PublishObject(const Iter& iter) noexcept;
+    // called by the erasing writer before it removes the object from the indices, returns false
+    // if another writer claimed it, @indexed is set if the inserting writer has published it
+    bool ClaimObject(const Iter& iter, bool& indexed) noexcept;
+    // called by the erasing writer once the object is removed from all indices
+    void UnlinkObject(const Iter& iter, bool indexed) noexcept;
+
+    // cache mode helpers, must be called under the write lock
+    static constexpr size_t kExpireSteps = 2; // objects examined for the expiry by every write
+    Access ReadAccess() const noexcept;
+    uint64_t Expiry(std::chrono::milliseconds ttl) const noexcept;
+    size_t Footprint(const T& obj) const noexcept;
+    // purges expired objects among up to @expireSteps objects, then evicts the objects over the limits
+    size_t Evict(size_t expireSteps) noexcept;
+    // removes the object from all indices and the storage
+    void EvictObject(typename Storage::iterator it) noexcept;
+    static uint64_t NowMs() noexcept;
+    
+    // observers notifications, under the write lock
+    void NotifyInsert(const T& object) noexcept;
+    void NotifyErase(const T& object) noexcept;
+    
+    // moves the objects into one block of the arena in the storage order, the indices must be rebuilt
+    void PackObjects() noexcept;
+
+    PackedArena m_arena; // objects packed by Freeze, outlives the storage
+    Storage m_objects{PackedAllocator<Record>(&m_arena)};
+    BitmapHandles<Iter> m_handles; // used if kHandles
     std::tuple<typename IdxDetector<P>::Type...> m_IndexObjects;
     mutable std::shared_mutex m_mutex;
+    WriteCombiner<L> m_writer{m_mutex};
+    std::bitset<sizeof...(P)> m_compacted; // indices done by the time sliced Compact
+    bool m_frozen{false}; // read only flat layout, see Freeze
+    std::atomic<bool> m_tuning{false};
+    mutable std::array<std::atomic<size_t>, sizeof...(P)> m_reads{}; // sampled reads per index
+    std::atomic<size_t> m_writes{0}; // sampled writes
+#if defined(MULTIINDEX_INSTRUMENTATION)
+    mutable TableInstruments<sizeof...(P)> m_instruments;
+#endif
+
+    // applies the pending log of the deferred index I, the read lock is held on return
+    template<size_t I>
+    void CatchUp(ReadLock<L>& locker) const noexcept;
+    template<size_t... I>
+    void CatchUp(ReadLock<L>& locker, std::index_sequence<I...>) const noexcept;
+
+    // workload sampling for Tune, no-op unless the tuning is enabled
+    template<size_t I>
+    void SampleRead() const noexcept;
+    void SampleWrite() noexcept;
+
+    static constexpr size_t kBatchGroup = 8; // FindFirstBatch lookups per pipeline stage
+    
+    // ApplyBatch helpers, must be called under the write lock
+    template<size_t I>
+    size_t UpdateObjects(const T& where, T&& what) noexcept;
+    template<size_t... I>
+    size_t UpdateObjects(size_t index, const T& where, T&& what, std::index_sequence<I...>) noexcept;
+    template<size_t... I>
+    void FindIterators(size_t index, const T& where, std::vector<Iter>& iters, std::index_sequence<I...>) const noexcept;
+    
+    // bulk delete helpers, must be called under the write lock
+    static constexpr size_t kSweepRatio = 8; // a bulk delete of size / ratio objects or more sweeps the index
+    // removes the @victims marked by Record::kErased from index I, unless I is @skip
+    template<size_t I>
+    void DeleteMarked(std::vector<Iter>& victims, size_t skip) noexcept;
+    template<size_t... I>
+    void DeleteMarked(std::vector<Iter>& victims, size_t skip, std::index_sequence<I...>) noexcept;
+
+    // conjunctive query planner, see FindAllOf
+    using Handles = std::vector<Iter>;
+    static constexpr size_t kEstimateFrom = 16; // the first estimate limit, doubled until some index is counted
+    static constexpr size_t kResidualRatio = 8; // indices with more matches than ratio * driver check the candidates only
+    static constexpr size_t kMergeRatio = 2; // sorted merge up to this set size ratio, hash probe above
+    // sets @count to the number of objects matching @what by index I, returns true if the count is exact,
+    // otherwise the counting stopped at @limit
+    template<size_t I>
+    bool Estimate(const T& what, size_t limit, size_t& count) const noexcept;
+    // handles of the objects matching @what by all indices I..., must be called under the read lock
+    template<size_t... I>
+    Handles Intersect(const T& what) const noexcept;
+
+    // runs @builder(idx) for every index, each index on its own thread, on the caller's thread if none is left.
+    template<typename B>
+    void BuildIndices(B&& builder) noexcept;
     
 public:
+    // Opaque position of the ordered cursor, it keeps the last visited key and the address of its object,
+    // the ordered indices order equal keys by the address, so the position survives table modifications:
+    // the erased objects are not revisited and none of the remaining ones is skipped.
+    class Cursor {
+        friend class MultiIndexTable;
+        std::optional<T> m_key; // the last visited key or the seek key
+        const T* m_object{nullptr}; // the last visited object, compared only, nullptr after a seek
+        bool m_reverse{false};
+        bool m_end{false};
+    public:
+        // no more objects in the cursor direction
+        bool IsEnd() const noexcept { return m_end; }
+    };
+    
+    // Mixed mutations recorded for ApplyBatch, applied in the recorded order
+    class Batch {
+        friend class MultiIndexTable;
+        enum class Kind {
+            Insert,
+            Update,
+            Delete
+        };
+        
+        struct Operation {
+            Kind m_kind;
+            size_t m_index; // Update and Delete
+            std::optional<T> m_where; // Update and Delete
+            std::optional<T> m_what; // Insert and Update
+        };
+        
+        std::vector<Operation> m_operations;
+    public:
+        void Insert(T&& obj) noexcept {
+            m_operations.push_back({Kind::Insert, 0, std::nullopt, std::move(obj)});
+        }
+        
+        template<size_t I>
+        void Update(const T& where, T&& what) noexcept {
+            static_assert(I < sizeof...(P), "Index is out of range");
+            m_operations.push_back({Kind::Update, I, std::cref(where), std::move(what)}); // copyable
+        }
+        
+        template<size_t I>
+        void Delete(const T& where) noexcept {
+            static_assert(I < sizeof...(P), "Index is out of range");
+            m_operations.push_back({Kind::Delete, I, std::cref(where), std::nullopt}); // copyable
+        }
+        
+        size_t Size() const noexcept { return m_operations.size(); }
+        void Clear() noexcept { m_operations.clear(); }
+    };
+    
+    // Bounded cache mode, see SetCacheOptions
+    struct CacheOptions {
+        size_t maxObjects{0}; // 0 - unbounded
+        size_t maxBytes{0}; // 0 - unbounded
+        std::chrono::milliseconds ttl{0}; // time to live of the inserted objects, 0 - never expire
+        std::function<size_t(const T&)> sizeOf; // object footprint in bytes, the storage record size by default
+        std::function<void(const T&)> onEvict; // called under the write lock for every evicted or expired object
+    };
+
+private:
+    CacheOptions m_cache;
+    bool m_bounded{false}; // object or byte limit is set
+    bool m_expiring{false}; // objects with the expiry time were stored
+    size_t m_bytes{0}; // storage footprint, maintained if the byte limit is set
+    typename Storage::iterator m_hand{m_objects.end()}; // CLOCK hand
+    typename Storage::iterator m_expireFrom{m_objects.end()}; // incremental expiry sweep position
+    std::vector<TableObserver<T>*> m_observers;
+    
+public:
+
     // Constructor
     // @hashSize defines the unordered indices hash table size
     MultiIndexTable(size_t hashSize, float maxFactor, P&& ...predicates) noexcept;
@@ -179,12 +817,34 @@ public:
     // Insert the new object and update all indexes.
     // Insert call may trigger the index rehash for the hashed indices unless noRehash is set to true
     void Insert(T&& obj, bool noRehash = false) noexcept;
+    // Insert the object expiring after @ttl, see SetCacheOptions.
+    void Insert(T&& obj, std::chrono::milliseconds ttl, bool noRehash = false) noexcept;
+    // Applies the batch under one write lock, the readers see either none or all of its mutations.
+    // The result is the same as of the sequential calls, but the index maintenance is deferred:
+    // consecutive inserts are stored first and then added index by index in the index order,
+    // consecutive deletes collect their objects first and remove them the same way.
+    // Returns the number of inserted, updated and deleted objects. Not available with LockPolicy::Concurrent.
+    size_t ApplyBatch(Batch&& batch) noexcept;
+    // Bulk load - moves @objects into the storage and builds all indices concurrently,
+    // one thread per index. The table stays locked until the slowest index is done.
+    void Load(ObjectContainer&& objects) noexcept;
+    // Rebuilds all indices from the storage concurrently, one thread per index.
+    void Rebuild() noexcept;
     // Update affected objects by index and update all indices
     template<size_t I>
     bool Update(const T& where, T&& what) noexcept;
     // Delete affected objects by index and update all indices
     template<size_t I>
     size_t Delete(const T& where) noexcept;
+    // Bulk delete of the objects from @lo to @hi inclusive by the ordered or radix index I,
+    // the index drops whole buckets of the range and the other indices are swept once
+    // when the range is a large part of the table. Not available with LockPolicy::Concurrent.
+    template<size_t I>
+    size_t DeleteRange(const T& lo, const T& hi) noexcept;
+    // Bulk delete of the objects @pred returns true for, one scan of the objects and at most one sweep of every index.
+    // Type F should have: bool operator()(const T& object). Not available with LockPolicy::Concurrent.
+    template<typename F>
+    size_t DeleteWhere(F&& pred) noexcept;
     // Search by index, finds the first object by index or not
     // that matches @what.
     template<size_t I>
@@ -192,11 +852,172 @@ public:
     // Finds the set of objects that matches @what by index.
     template<size_t I>
     ObjectContainer FindAll(const T& what) const noexcept;
+    // FindFirst of every key under one read lock, the result has an entry per key.
+    // Hashed indices pipeline the lookups: while a group of keys is compared the memory
+    // of the following groups (buckets, bucket items, objects) is being prefetched.
+    template<size_t I>
+    std::vector<std::optional<T>> FindFirstBatch(const std::vector<T>& keys) const noexcept;
     // Finds with selector - must have operator()(const T& item);
     template<size_t I, typename S>
     void FindBySelector(S&& selector, const T& what) const noexcept;
     
+    // Conjunctive query, finds the objects matching @what by every index I..., i.e.
+    // FindAllOf<0, 2>(what) for "key0 == what.key0 AND key2 == what.key2".
+    // The planner estimates the matches per index, starts from the most selective index
+    // and intersects its object handles with the other comparable indices (sorted merge or hash probe),
+    // the indices with far more matches only check the remaining candidates.
+    // Costs about O(k * m), m - matches of the most selective index, objects are dereferenced for the result only.
+    template<size_t... I>
+    ObjectContainer FindAllOf(const T& what) const noexcept;
+    template<size_t... I, typename S>
+    void FindBySelectorOf(S&& selector, const T& what) const noexcept;
+    
+    // Ordered cursor, index I must be ordered, concurrent ordered or radix.
+    // Positions the cursor at the first object not less than @key,
+    // or at the last object not greater than @key if @reverse is true.
+    template<size_t I>
+    Cursor Seek(const T& key, bool reverse = false) const noexcept;
+    // Positions the cursor at the first object, or at the last one if @reverse is true.
+    template<size_t I>
+    Cursor SeekFirst(bool reverse = false) const noexcept;
+    // Visits up to @count objects from the cursor position and advances the cursor,
+    // returns the number of visited objects. Costs O(log n + count).
+    template<size_t I, typename S>
+    size_t Next(S&& selector, Cursor& cursor, size_t count) const noexcept;
+    // Returns up to @count objects from the cursor position and advances the cursor.
+    template<size_t I>
+    ObjectContainer Next(Cursor& cursor, size_t count) const noexcept;
+    
+    // Range search, visits the objects from @lo to @hi inclusive in the order of the ordered, concurrent ordered or radix index I.
+    template<size_t I, typename S>
+    void FindRange(S&& selector, const T& lo, const T& hi) const noexcept;
+    // Prefix search, index I predicate must be derived from RadixTraits.
+    // Visits the objects with the keys starting with @prefix in the key order, costs O(prefix length + matches).
+    template<size_t I, typename S>
+    void FindByPrefix(S&& selector, const RadixKey& prefix) const noexcept;
+    template<size_t I>
+    ObjectContainer FindByPrefix(const RadixKey& prefix) const noexcept;
+    
+    // Bounding box search, index I predicate must be derived from SpatialTraits.
+    // Visits the objects with the boxes intersecting @box, costs O(log n + matches) for the selective boxes.
+    template<size_t I, typename S, size_t D>
+    void FindInBox(S&& selector, const SpatialBox<D>& box) const noexcept;
+    template<size_t I, size_t D>
+    ObjectContainer FindInBox(const SpatialBox<D>& box) const noexcept;
+    // Nearest neighbour search, index I predicate must be derived from SpatialTraits.
+    // Visits up to @k objects by the distance from @point to their boxes, the nearest first.
+    template<size_t I, typename S, size_t D>
+    void FindNearest(S&& selector, const SpatialPoint<D>& point, size_t k) const noexcept;
+    template<size_t I, size_t D>
+    ObjectContainer FindNearest(const SpatialPoint<D>& point, size_t k) const noexcept;
+    
+    // Bitmap filter context of FindByBitmap, valid inside the filter only.
+    class Bitmaps {
+        friend class MultiIndexTable;
+        const MultiIndexTable& m_table;
+        explicit Bitmaps(const MultiIndexTable& table) noexcept : m_table(table) {}
+    public:
+        // handles of the objects matching @what by the bitmap index I
+        template<size_t I>
+        const RoaringBitmap& Of(const T& what) const noexcept;
+        // handles of all objects, i.e. All() - Of<0>(what) for "NOT key0 == what.key0"
+        const RoaringBitmap& All() const noexcept;
+    };
+    // Bitmap filter, combines the bitmap indices by AND (&), OR (|) and NOT (-) and visits the resulting objects, i.e.
+    // FindByBitmap([&](const auto& b) { return b.template Of<0>(what) & (b.template Of<1>(what) | b.template Of<2>(what)); })
+    // for "key0 == what.key0 AND (key1 == what.key1 OR key2 == what.key2)".
+    // Type F should have: RoaringBitmap operator()(const Bitmaps& bitmaps), it runs under the read lock.
+    // The dense bitsets are combined a word at a time, the objects are dereferenced for the result only.
+    template<typename S, typename F>
+    void FindByBitmap(S&& selector, F&& filter) const noexcept;
+    template<typename F>
+    ObjectContainer FindByBitmap(F&& filter) const noexcept;
+    
+    // Order statistics, index I predicate must be derived from RankedOrderedTraits.
+    // Number of objects with keys in [@lo, @hi].
+    template<size_t I>
+    size_t Count(const T& lo, const T& hi) const noexcept;
+    // Number of objects with keys less than @key.
+    template<size_t I>
+    size_t Rank(const T& key) const noexcept;
+    // The object at zero based position @k in the index order, i.e. Nth<I>(Size() / 2) is the median.
+    template<size_t I>
+    std::optional<T> Nth(size_t k) const noexcept;
+    // Number of objects in the table, in the cache mode it counts the expired objects
+    // until the writes or Expire purge them.
+    size_t Size() const noexcept;
+    
+    // Result cache of index I for the skewed read mostly workloads, keeps the matches of up to @entries
+    // recent lookup keys of FindFirst, FindAll and FindBySelector, 0 disables it (the default).
+    // Any change of the index invalidates all entries, the hits skip the index lookup.
+    // Lookups with more than ResultCache::kMaxItems matches are not cached. Not available with LockPolicy::Concurrent.
+    template<size_t I>
+    void SetResultCache(size_t entries) noexcept;
+    // Hit and miss counters of the index I result cache, SetResultCache resets them.
+    template<size_t I>
+    ResultCacheStats GetResultCacheStats() const noexcept;
+    
+    // Deferred maintenance of index I for the write heavy phases, i.e. the ingest of the objects
+    // queried later. The inserts only append the objects to the index pending log, the first read
+    // through the index, Sync or a delete or an update looking up the objects through the index
+    // apply the log in one sorted batch. The deletes and updates through the other indices take
+    // the pending objects out of the log or leave them there. Turning it off applies the log.
+    // With LockPolicy::External the read applying the log modifies the index, the reads of
+    // a deferred index need the same exclusive access as the writes. Not available with LockPolicy::Concurrent.
+    template<size_t I>
+    void SetDeferred(bool deferred) noexcept;
+    // Applies the pending log of index I.
+    template<size_t I>
+    void Sync() noexcept;
+    
+    // Repacks ordered buckets to @fill of the Capacity, shrinks the hash tables and bucket arrays
+    // and returns the freed memory to the system.
+    void Compact(float fill = 0.75f) noexcept;
+    // Time sliced Compact, holds the write lock for about @slice per call and
+    // returns true once the whole table is compacted, i.e. call it from a maintenance thread
+    // until it returns true to compact a live table without long stalls.
+    bool Compact(std::chrono::microseconds slice, float fill = 0.75f) noexcept;
+    
+    // Read only flat layout for the tables which are loaded once and then only read.
+    // Packs the objects into one block, rebuilds every ordered index as a complete tree of full buckets
+    // in one breadth first array and moves the items of every hashed index into one block,
+    // no per bucket allocations are left. The reads work as usual with fewer cache misses and a smaller footprint.
+    // The frozen table rejects the mutations - they change nothing and return false or 0 - until Thaw,
+    // Clear empties and thaws it. Costs O(n log n) under the write lock. Not available with the concurrent indices.
+    void Freeze() noexcept;
+    // Rebuilds the mutable indices, the objects stay packed until they are deleted.
+    void Thaw() noexcept;
+    bool IsFrozen() const noexcept;
+    
+    // Capacity tuning, while enabled the table samples the reads per index and the writes.
+    // Enabling it starts a new sampling period.
+    void SetTuning(bool enable) noexcept;
+    // Collects the index statistics and recommends the bucket capacities for the sampled workload,
+    // adopts them if @adopt is set. The runtime capacity never exceeds the index compile time capacity,
+    // Compact splits the ordered buckets over the adopted capacity and trims the hashed bucket allocations.
+    std::array<IndexStats, sizeof...(P)> Tune(bool adopt = false) noexcept;
+    
+    // Bounded cache mode. Objects over the limits are evicted by CLOCK, the lookups through any index
+    // mark the objects as recently used, the cursor scans don't. Expired objects are hidden from the reads, except the order statistics,
+    // and purged incrementally by the writes or by Expire. Not available with LockPolicy::Concurrent.
+    void SetCacheOptions(CacheOptions options) noexcept;
+    // Examines up to @budget objects and purges the expired ones, returns the number of purged objects.
+    size_t Expire(size_t budget = std::numeric_limits<size_t>::max()) noexcept;
+    
+    // Attaches the observer, i.e. AggregateView, it receives all current objects
+    // and then every modification under the write lock. The observer must outlive the attachment.
+    // Not available with LockPolicy::Concurrent, the writers run without the write lock.
+    void Attach(TableObserver<T>& observer) noexcept;
+    void Detach(TableObserver<T>& observer) noexcept;
+    
+    // Instrumentation snapshot - operation and per index latencies, lock waits and index restructuring events.
+    // Collected if MULTIINDEX_INSTRUMENTATION is defined, all zeros otherwise, see Instrumentation.h.
+    TableMetrics<sizeof...(P)> GetMetrics() const noexcept;
+    void ResetMetrics() noexcept;
+    
     // delete all content from storage and indices.
+    // With LockPolicy::Concurrent the objects are deleted one by one like Delete does, the objects
+    // inserted by the concurrent writers during the call may stay.
     void Clear() noexcept;
     
     // DEBUG
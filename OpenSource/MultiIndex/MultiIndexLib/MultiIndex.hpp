@@ -32,9 +32,105 @@ template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
 template<typename I, typename... ARGS>
 void
 MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Insert(bool noRehash, const Iter& itRef, const BitRef affected) noexcept {
-    if (affected) {
-        this->insert(noRehash, itRef);
+    if (!affected) {
+        return;
+    }
+    
+    if (m_deferred) {
+        Defer(itRef);
+        m_behind.store(true, std::memory_order_release);
+        return;
+    }
+    
+    this->insert(noRehash, itRef);
+    InvalidateResults();
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+void
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Build(Iter first, Iter last, size_t count) noexcept {
+    if (m_deferred) {
+        m_pending.reserve(m_pending.size() + count);
+        for (; first != last; ++first) {
+            Defer(first);
+        }
+        m_behind.store(!m_pending.empty(), std::memory_order_release);
+        return;
+    }
+    
+    // size the index once instead of growing it step by step
+    this->reserve(this->size() + count);
+    for (; first != last; ++first) {
+        this->insert(true, first);
+    }
+    InvalidateResults();
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+void
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::InsertBatch(std::vector<Iter>& iters) noexcept {
+    if (m_deferred) {
+        for (const auto& iter : iters) {
+            Defer(iter);
+        }
+        m_behind.store(!m_pending.empty(), std::memory_order_release);
+        return;
+    }
+    
+    this->reserve(this->size() + iters.size());
+    this->sort_keys(iters);
+    for (const auto& iter : iters) {
+        this->insert(true, iter);
+    }
+    InvalidateResults();
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+void
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::DeleteBatch(std::vector<Iter>& iters) noexcept {
+    this->sort_keys(iters);
+    for (const auto& iter : iters) {
+        if (!Undefer(iter)) { // the pending objects only leave the log
+            this->erase(iter);
+        }
     }
+    InvalidateResults();
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+size_t
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::DeleteRange(const T& lo, const T& hi) noexcept {
+    Sync();
+    // empty range if @hi is less than @lo
+    if (this->is_less(hi, lo)) {
+        return 0;
+    }
+    
+    InvalidateResults();
+    return this->erase_if(this->lower_bound(lo), this->upper_bound(hi), [](const Iter&) { return true; });
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+size_t
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::DeleteMarked() noexcept {
+    Sync();
+    InvalidateResults();
+    return this->erase_if([](const Iter& iter) {
+        return (iter.GetRecord().m_state.load(std::memory_order_relaxed) & Record::kErased) != 0;
+    });
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+template<typename V>
+void
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::VisitAll(V&& visitor) const noexcept {
+    this->for_each(std::forward<V>(visitor));
 }
 
 template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
@@ -42,6 +138,18 @@ template<typename I, typename... ARGS>
 void
 MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Update(const Iter& itRef, const T& what, BitRef isAffected) noexcept {
     isAffected = 0;
+    if (IsPending(itRef)) { // the log inserts the updated object
+        return;
+    }
+    
+    if constexpr (DirectErase<I>::value) { // no scan of the key objects
+        if (!this->is_equal(*itRef, what)) {
+            isAffected = this->erase(itRef) != 0;
+            InvalidateResults();
+        }
+        return;
+    }
+    
     for (auto p = this->equal_range(*itRef); p.first != p.second; ++p.first) {
         if (*p.first != itRef) {
             continue;
@@ -50,6 +158,7 @@ MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Update(const Ite
         if (!this->is_equal(*itRef, what)) {
             this->erase(*p.first);
             isAffected = 1;
+            InvalidateResults();
         }
         return;
     }
@@ -57,37 +166,98 @@ MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Update(const Ite
 
 template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
 template<typename I, typename... ARGS>
-void
+bool
 MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Delete(const Iter& itRef) noexcept {
+    if (Undefer(itRef)) { // not in the index yet
+        return true;
+    }
+    
+    InvalidateResults();
+    if constexpr (DirectErase<I>::value) { // no scan of the key objects
+        return this->erase(itRef) != 0;
+    }
+    
     for (auto p = this->equal_range(*itRef); p.first != p.second; ++p.first) {
         if (*p.first != itRef) {
             continue;
         }
         
-        this->erase(*p.first);
-        return;
+        return this->erase(*p.first) != 0;
     }
+    
+    return false;
 }
 
 template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
 template<typename I, typename... ARGS>
 std::optional<T>
-MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::FindFirst(const T& what) const noexcept {
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::FindFirst(const T& what, const Access& access) const noexcept {
     std::optional<T> result;
-    auto it = this->find(what);
-    if (it != this->end()) {
-        result = std::cref(**it); // copyable
+    if (VisitCached([&](const Iter& iter) {
+        if (!result && access.Visit(iter)) {
+            result = std::cref(*iter); // copyable
+        }
+    }, what)) {
+        return result;
+    }
+    
+    if (access.m_now == 0) {
+        auto it = this->find(what);
+        if (it != this->end() && access.Visit(*it)) {
+            result = std::cref(**it); // copyable
+        }
+    } else { // the first one might be expired
+        for (auto p = this->equal_range(what); p.first != p.second; ++p.first) {
+            if (access.Visit(*p.first)) {
+                result = std::cref(**p.first); // copyable
+                break;
+            }
+        }
     }
     
     return result;
 }
 
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+void
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::FindFirstBatch(const std::vector<T>& keys, std::vector<std::optional<T>>& results, const Access& access) const noexcept {
+    const size_t count = keys.size();
+    std::vector<size_t> buckets(count);
+    // runs @stage for the keys of the group @lag groups behind @group
+    auto forGroup = [&keys, count](size_t group, size_t lag, auto&& stage) {
+        if (group >= lag * kBatchGroup) {
+            const size_t first = group - lag * kBatchGroup;
+            for (size_t i = first; i < std::min(first + kBatchGroup, count); ++i) {
+                stage(i, keys[i]);
+            }
+        }
+    };
+    
+    // the group computes the buckets while the three previous groups are at the next stages
+    for (size_t group = 0; group < count + 3 * kBatchGroup; group += kBatchGroup) {
+        forGroup(group, 0, [&](size_t i, const T& key) { buckets[i] = this->prefetch_bucket(key); });
+        forGroup(group, 1, [&](size_t i, const T&) { this->prefetch_items(buckets[i]); });
+        forGroup(group, 2, [&](size_t i, const T&) { this->prefetch_object(buckets[i]); });
+        forGroup(group, 3, [&](size_t i, const T& key) {
+            if (access.m_now != 0) { // the first one might be expired
+                results[i] = FindFirst(key, access);
+            } else {
+                auto it = this->find(buckets[i], key);
+                if (it != this->end() && access.Visit(*it)) {
+                    results[i] = std::cref(**it); // copyable
+                }
+            }
+        });
+    }
+}
+
 template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
 template<typename I, typename... ARGS>
 typename MultiIndexTable<L, Capacity, T, P...>::ObjectContainer
-MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::FindAll(const T& what) const noexcept {
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::FindAll(const T& what, const Access& access) const noexcept {
     ObjectContainer result;
-    FindBySelector([&result](const T& item) { result.push_back(item); }, what);
+    FindBySelector([&result](const T& item) { result.push_back(item); }, what, access);
     return result;
 }
 
@@ -95,155 +265,1970 @@ template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
 template<typename I, typename... ARGS>
 template<typename S>
 void
-MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::FindBySelector(S&& selector, const T& what) const noexcept {
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::FindBySelector(S&& selector, const T& what, const Access& access) const noexcept {
+    if (VisitCached([&](const Iter& iter) {
+        if (access.Visit(iter)) {
+            selector(*iter);
+        }
+    }, what)) {
+        return;
+    }
+    
     for (auto p = this->equal_range(what); p.first != p.second; ++p.first) {
-        selector(**p.first);
+        if (access.Visit(*p.first)) {
+            selector(**p.first);
+        }
+    }
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+template<typename S>
+size_t
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Scan(S&& selector, Cursor& cursor, size_t count, const Access& access) const noexcept {
+    if (cursor.m_end || count == 0) {
+        return 0;
+    }
+    
+    // restore the position, the first object past the last visited one
+    auto it = this->end();
+    if (!cursor.m_key) {
+        it = !cursor.m_reverse ? this->begin() : this->end();
+    } else if (cursor.m_object == nullptr) { // seek
+        it = !cursor.m_reverse ? this->lower_bound(*cursor.m_key) : this->upper_bound(*cursor.m_key);
+    } else {
+        it = this->lower_bound(*cursor.m_key, cursor.m_object);
+        if (!cursor.m_reverse && it != this->end() && &**it == cursor.m_object && this->is_equal(**it, *cursor.m_key)) {
+            ++it;
+        }
+    }
+    
+    if (cursor.m_reverse) {
+        if (it == this->begin()) {
+            it = this->end();
+        } else {
+            --it;
+        }
+    }
+    
+    const T* last = nullptr;
+    size_t visited = 0;
+    while (visited < count && it != this->end()) {
+        // expired objects keep their positions, but are not visited
+        const T& object = **it;
+        last = &object;
+        if (access.Visit(*it)) {
+            selector(object);
+            ++visited;
+        }
+        
+        if (!cursor.m_reverse) {
+            ++it;
+        } else if (it == this->begin()) {
+            it = this->end();
+        } else {
+            --it;
+        }
+    }
+    
+    if (last != nullptr) {
+        cursor.m_key = std::cref(*last); // copyable
+        cursor.m_object = last;
+    }
+    cursor.m_end = it == this->end();
+    return visited;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+size_t
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Estimate(const T& what, size_t limit) const noexcept {
+    size_t count = 0;
+    for (auto p = this->equal_range(what); p.first != p.second && count < limit; ++p.first) {
+        ++count;
     }
+    return count;
 }
 
 template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
 template<typename I, typename... ARGS>
+template<typename V>
 void
-MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Clear() noexcept {
-    this->clear();
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::VisitHandles(V&& visitor, const T& what) const noexcept {
+    for (auto p = this->equal_range(what); p.first != p.second; ++p.first) {
+        visitor(*p.first);
+    }
 }
 
 template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
 template<typename I, typename... ARGS>
+template<typename V>
 void
-MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Traverse() const noexcept {
-    this->traverse();
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::VisitRange(V&& visitor, const T& lo, const T& hi) const noexcept {
+    if (this->is_less(hi, lo)) {
+        return;
+    }
+    
+    for (auto it = this->lower_bound(lo), last = this->upper_bound(hi); it != last; ++it) {
+        visitor(*it);
+    }
 }
 
-/////////////////////////////////////////////////////// MultiIndexTable
 template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
-MultiIndexTable<L, Capacity, T, P...>::MultiIndexTable(size_t hashSize, float maxFactor, P&&... predicates) noexcept :
-    m_IndexObjects(std::make_tuple(hashSize, maxFactor, std::forward<P>(predicates))...) {
-    static_assert(Capacity > 0);
+template<typename I, typename... ARGS>
+template<typename V>
+void
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::VisitPrefix(V&& visitor, const RadixKey& prefix) const noexcept {
+    for (auto p = this->prefix_range(prefix); p.first != p.second; ++p.first) {
+        visitor(*p.first);
+    }
 }
 
 template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
-MultiIndexTable<L, Capacity, T, P...>::~MultiIndexTable() noexcept {
-    std::apply([&](auto&... idx) { // for all indexes
-        (idx.Clear(), ...);
-    }, m_IndexObjects);
-    
-    m_objects.clear();
+template<typename I, typename... ARGS>
+template<typename V, size_t D>
+void
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::VisitBox(V&& visitor, const SpatialBox<D>& box) const noexcept {
+    this->search(box, std::forward<V>(visitor));
 }
 
 template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
-void MultiIndexTable<L, Capacity, T, P...>::Insert(T&& obj, bool noRehash) noexcept {
-    std::bitset<sizeof...(P)> affectedIndices(1);
-    // lock
-    WriteLock<L> locker(m_mutex);
-    auto iter = m_objects.insert(m_objects.end(), std::forward<T>(obj));
-    std::apply([&](auto&... idx) { // for all indexes
-        (idx.Insert(noRehash, iter, affectedIndices[0]), ...);
-    }, m_IndexObjects);
+template<typename I, typename... ARGS>
+template<typename V, size_t D>
+void
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::VisitNearest(V&& visitor, const SpatialPoint<D>& point) const noexcept {
+    this->nearest(point, std::forward<V>(visitor));
 }
 
-// Update by index
 template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
-template<size_t I>
-bool MultiIndexTable<L, Capacity, T, P...>::Update(const T& where, T&& what) noexcept {
-    // check the index existance
-    static_assert(I < sizeof...(P), "Index is out of range");
-    // find the index by a position
-    auto& idx = std::get<I>(m_IndexObjects);
-    // lock
-    WriteLock<L> locker(m_mutex);
-    auto iters = idx.FindIterators(where);
-    for (auto& iter : iters) {
-        size_t indexPos = 0;
-        std::bitset<sizeof...(P)> affectediIndices;
-        std::apply([&](auto&... idx) { // for all indexes
-            (idx.Update(iter, what, affectediIndices[indexPos++]), ...);
-        }, m_IndexObjects);
-        
-        if (iters.size() == 1) {
-            *iter = std::forward<T>(what);
-        } else {
-            *iter = std::cref(what); // must be copyable
-        }
-        
-        indexPos = 0;
-        std::apply([&](auto&... idx) { // for all indexes
-            (idx.Insert(true, iter, affectediIndices[indexPos++]), ...);
-        }, m_IndexObjects);
+template<typename I, typename... ARGS>
+void
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::AttachHandles(const BitmapHandles<Iter>* handles) noexcept {
+    if constexpr (IsBitmapMultiSet<I>::value) {
+        this->attach(handles);
     }
-    
-    return !iters.empty();
 }
 
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+void
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::AttachPosition(uint32_t& position, uint32_t& node) noexcept {
+    using Pred = typename std::tuple_element<2, ARGS...>::type;
+    if constexpr (IsGroupedIndex<Pred>()) {
+        this->attach_position(position++);
+    } else if constexpr (IndexKindOf<Pred>() == IndexKind::Ordered) {
+        this->attach_node(node++);
+    }
+}
 
-// Delete by index
 template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
-template<size_t I>
-size_t MultiIndexTable<L, Capacity, T, P...>::Delete(const T& where) noexcept {
-    // check the index existance
-    static_assert(I < sizeof...(P), "Index is out of range");
-    // find the index by a position
-    auto& idx = std::get<I>(m_IndexObjects);
-    // lock
-    WriteLock<L> locker(m_mutex);
-    // Find all candidates for deletion
-    auto iters = idx.FindIterators(where);
-    
-    for (auto& iter : iters) {
-        std::apply([&iter](auto&... idx) { // for all indexes
-            (idx.Delete(iter), ...);
-        }, m_IndexObjects);
-        
-        m_objects.erase(iter);
+template<typename I, typename... ARGS>
+const RoaringBitmap*
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Bitmap(const T& what) const noexcept {
+    return this->bitmap(what);
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+bool
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Matches(const T& object, const T& what) const noexcept {
+    return this->is_equal(object, what);
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+size_t
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Count(const T& lo, const T& hi) const noexcept {
+    size_t upper = this->rank(this->upper_bound(hi));
+    size_t lower = this->rank(this->lower_bound(lo));
+    // empty range if @hi is less than @lo
+    return upper > lower ? upper - lower : 0;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+size_t
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Rank(const T& key) const noexcept {
+    return this->rank(this->lower_bound(key));
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+std::optional<T>
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Nth(size_t k) const noexcept {
+    auto it = this->nth(k);
+    if (it != this->end()) {
+        return std::make_optional<T>(**it);
     }
- 
-    return iters.size();
+    return std::nullopt;
 }
 
-// Search by index
 template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
-template<size_t I>
-std::optional<T> MultiIndexTable<L, Capacity, T, P...>::FindFirst(const T& what) const noexcept {
-    // check the index existance
-    static_assert(I < sizeof...(P), "Index is out of range");
-    // find the index by a position
-    const auto& idx = std::get<I>(m_IndexObjects);
-    // lock
-    ReadLock<L> locker(m_mutex);
-    return idx.FindFirst(what);
+template<typename I, typename... ARGS>
+bool
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Compact(std::chrono::steady_clock::time_point deadline, float fill) noexcept {
+    constexpr size_t steps = 64; // buckets between the clock checks
+    do {
+        if (this->compact(steps, fill)) {
+            return true;
+        }
+    } while (std::chrono::steady_clock::now() < deadline);
+    
+    return false;
 }
 
 template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
-template<size_t I>
-typename MultiIndexTable<L, Capacity, T, P...>::ObjectContainer MultiIndexTable<L, Capacity, T, P...>::FindAll(const T& what) const noexcept {
-    // check the index existance
-    static_assert(I < sizeof...(P), "Index is out of range");
-    // find the index by a position
-    const auto& idx = std::get<I>(m_IndexObjects);
-    // lock
-    ReadLock<L> locker(m_mutex);
-    return idx.FindAll(what);
+template<typename I, typename... ARGS>
+IndexStats
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Stats(size_t reads, size_t writes) const noexcept {
+    return this->stats(reads, writes);
 }
 
 template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
-template<size_t I, typename S>
-void MultiIndexTable<L, Capacity, T, P...>::FindBySelector(S&& selector, const T& what) const noexcept {
-    // check the index existance
-    static_assert(I < sizeof...(P), "Index is out of range");
-    // find the index by a position
-    const auto& idx = std::get<I>(m_IndexObjects);
-    // lock
-    ReadLock<L> locker(m_mutex);
-    idx.FindBySelector(std::forward<S>(selector), what);
+template<typename I, typename... ARGS>
+void
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::SetCapacity(uint32_t capacity) noexcept {
+    this->set_capacity(capacity);
 }
 
 template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
-void MultiIndexTable<L, Capacity, T, P...>::Clear() noexcept {
-    // lock
-    WriteLock<L> locker(m_mutex);
-    std::apply([&](auto&... idx) { // for all indexes
-        (idx.Clear(), ...);
-    }, m_IndexObjects);
+template<typename I, typename... ARGS>
+void
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::SetResultCache(size_t entries) noexcept {
+    m_results.Resize(entries);
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+void
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::SetDeferred(bool deferred, uint32_t slot) noexcept {
+    m_deferred = deferred;
+    m_slot = slot;
+    if (!deferred) {
+        Sync();
+    }
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+void
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Defer(const Iter& iter) noexcept {
+    if constexpr (kPending != 0) {
+        iter.Pending(m_slot) = uint32_t(m_pending.size());
+    }
+    m_pending.push_back(iter);
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+bool
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::IsPending(const Iter& iter) const noexcept {
+    if constexpr (kPending != 0) {
+        // the position is stale once the object left the log, the log entry confirms it
+        const uint32_t position = iter.Pending(m_slot);
+        return position < m_pending.size() && m_pending[position] == iter;
+    } else {
+        return false;
+    }
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+bool
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Undefer(const Iter& iter) noexcept {
+    if constexpr (kPending != 0) {
+        if (!IsPending(iter)) {
+            return false;
+        }
+        
+        // the last pending object takes the place
+        const uint32_t position = iter.Pending(m_slot);
+        m_pending[position] = m_pending.back();
+        m_pending[position].Pending(m_slot) = position;
+        m_pending.pop_back();
+        m_behind.store(!m_pending.empty(), std::memory_order_release);
+        return true;
+    } else {
+        return false;
+    }
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+void
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Sync() noexcept {
+    if (m_pending.empty()) {
+        return;
+    }
+    
+    this->reserve(this->size() + m_pending.size());
+    if constexpr (!std::is_base_of<ConcurrentTraits, typename std::tuple_element<2, ARGS...>::type>::value) { // the concurrent indices have no key order
+        this->sort_keys(m_pending);
+    }
+    for (const auto& iter : m_pending) {
+        this->insert(true, iter);
+    }
+    m_pending.clear();
+    m_pending.shrink_to_fit();
+    m_behind.store(false, std::memory_order_release);
+    InvalidateResults();
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+ResultCacheStats
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::GetResultCacheStats() const noexcept {
+    return m_results.Stats();
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+template<typename V>
+bool
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::VisitCached(V&& visitor, const T& what) const noexcept {
+    using Cache = ResultCache<T, Iter>;
+    if (!m_results.Enabled()) {
+        return false;
+    }
+    
+    typename Cache::Items items;
+    size_t count = m_results.Find(what, [this](const T& first, const T& second) { return this->is_equal(first, second); }, items);
+    if (count == Cache::kMiss) {
+        count = 0;
+        auto p = this->equal_range(what);
+        for (; p.first != p.second && count < Cache::kMaxItems; ++p.first) {
+            items[count++] = *p.first;
+        }
+        
+        if (p.first != p.second) { // too many to cache
+            for (p = this->equal_range(what); p.first != p.second; ++p.first) {
+                visitor(*p.first);
+            }
+            return true;
+        }
+        m_results.Store(what, items, count);
+    }
+    
+    for (size_t i = 0; i < count; ++i) {
+        visitor(items[i]);
+    }
+    return true;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+size_t
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Size() const noexcept {
+    return this->size();
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+void
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Freeze(Iter first, Iter last, size_t count) noexcept {
+    std::vector<Iter> items;
+    items.reserve(count);
+    for (; first != last; ++first) {
+        items.push_back(first);
+    }
+    this->freeze(items);
+    InvalidateResults();
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+void
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Clear() noexcept {
+    this->clear();
+    m_pending.clear();
+    m_behind.store(false, std::memory_order_release);
+    InvalidateResults();
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename I, typename... ARGS>
+void
+MultiIndexTable<L, Capacity, T, P...>::CommonIndex<I, ARGS...>::Traverse() const noexcept {
+    this->traverse();
+}
+
+/////////////////////////////////////////////////////// MultiIndexTable
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+MultiIndexTable<L, Capacity, T, P...>::MultiIndexTable(size_t hashSize, float maxFactor, P&&... predicates) noexcept :
+    m_IndexObjects(std::make_tuple(hashSize, maxFactor, std::forward<P>(predicates))...) {
+    static_assert(Capacity > 0);
+    if constexpr (kHandles) {
+        std::apply([this](auto&... idx) { // for all indexes
+            (idx.AttachHandles(&m_handles), ...);
+        }, m_IndexObjects);
+    }
+    
+    if constexpr (kPositions != 0 || kNodes != 0) {
+        std::apply([](auto&... idx) { // for all indexes
+            uint32_t position = 0;
+            uint32_t node = 0;
+            (idx.AttachPosition(position, node), ...);
+        }, m_IndexObjects);
+    }
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+MultiIndexTable<L, Capacity, T, P...>::~MultiIndexTable() noexcept {
+    std::vector<Iter> records;
+    if constexpr (L == LockPolicy::Concurrent) {
+        // free the erased records, the live ones are found through the first index
+        EpochManager::Instance().Flush(this);
+        records.reserve(std::get<0>(m_IndexObjects).Size());
+        std::get<0>(m_IndexObjects).VisitAll([&records](const Iter& iter) { records.push_back(iter); });
+    }
+    
+    std::apply([&](auto&... idx) { // for all indexes
+        (idx.Clear(), ...);
+    }, m_IndexObjects);
+    
+    if constexpr (L == LockPolicy::Concurrent) {
+        for (const auto& iter : records) {
+            delete iter.Base();
+        }
+    }
+    m_objects.clear();
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::Insert(T&& obj, bool noRehash) noexcept {
+    InsertObject(std::forward<T>(obj), Expiry(m_cache.ttl), noRehash);
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::Insert(T&& obj, std::chrono::milliseconds ttl, bool noRehash) noexcept {
+    static_assert(L != LockPolicy::Concurrent, "Expiry is not available with LockPolicy::Concurrent");
+    InsertObject(std::forward<T>(obj), Expiry(ttl), noRehash);
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::InsertObject(T&& obj, uint64_t expiry, bool noRehash) noexcept {
+    SampleWrite();
+    MULTIINDEX_TIME(m_instruments, TableOperation::Insert);
+    std::bitset<sizeof...(P)> affectedIndices(1);
+    // lock
+    m_writer.Execute([&]() {
+        if (m_frozen) {
+            return;
+        }
+        
+        auto iter = StoreObject(std::forward<T>(obj), expiry);
+        std::apply([&](auto&... idx) { // for all indexes
+            (idx.Insert(noRehash, iter, affectedIndices[0]), ...);
+        }, m_IndexObjects);
+        if constexpr (L == LockPolicy::Concurrent) {
+            PublishObject(iter);
+        } else {
+            Evict(kExpireSteps);
+        }
+    });
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::PublishObject(const Iter& iter) noexcept {
+    uint64_t state = iter.GetRecord().m_state.fetch_or(Record::kIndexed, std::memory_order_acq_rel);
+    if ((state & Record::kUnlinked) != 0) {
+        // the concurrent erase ran before the object got into all indices
+        std::apply([&iter](auto&... idx) { // for all indexes
+            (idx.Delete(iter), ...);
+        }, m_IndexObjects);
+        EraseObject(iter);
+    }
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+bool MultiIndexTable<L, Capacity, T, P...>::ClaimObject(const Iter& iter, bool& indexed) noexcept {
+    // the writers may find the object through different indices, the first one takes it
+    uint64_t state = iter.GetRecord().m_state.fetch_or(Record::kUnlinked, std::memory_order_acq_rel);
+    indexed = (state & Record::kIndexed) != 0;
+    return (state & Record::kUnlinked) == 0;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::UnlinkObject(const Iter& iter, bool indexed) noexcept {
+    if (indexed) { // otherwise PublishObject erases it
+        EraseObject(iter);
+    }
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename O>
+typename MultiIndexTable<L, Capacity, T, P...>::Iter
+MultiIndexTable<L, Capacity, T, P...>::StoreObject(O&& obj, uint64_t expiry) noexcept {
+    if constexpr (L == LockPolicy::Concurrent) {
+        return new Record(std::forward<O>(obj));
+    } else {
+        // just behind the CLOCK hand, the new object is the last one to be examined
+        auto it = m_objects.emplace(m_hand, std::forward<O>(obj));
+        if constexpr (kHandles) {
+            it->m_handle = m_handles.Acquire(it);
+        }
+        
+        if (expiry != 0) {
+            it->m_state.store(expiry, std::memory_order_relaxed);
+            m_expiring = true;
+        }
+        
+        if (m_cache.maxBytes != 0) {
+            m_bytes += Footprint(it->m_object);
+        }
+        NotifyInsert(it->m_object);
+        return it;
+    }
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::EraseObject(const Iter& iter) noexcept {
+    if constexpr (L == LockPolicy::Concurrent) {
+        // readers inside the current epoch may still hold the object
+        Record* record = iter.Base();
+        EpochManager::Instance().Retire(this, [record]() { delete record; });
+    } else {
+        // keep the cache positions valid
+        if (iter.Base() == m_hand) {
+            ++m_hand;
+        }
+        
+        if (iter.Base() == m_expireFrom) {
+            ++m_expireFrom;
+        }
+        
+        if (m_cache.maxBytes != 0) {
+            m_bytes -= Footprint(*iter);
+        }
+        if constexpr (kHandles) {
+            m_handles.Release(iter.Handle());
+        }
+        NotifyErase(*iter);
+        m_objects.erase(iter.Base());
+    }
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename B>
+void MultiIndexTable<L, Capacity, T, P...>::BuildIndices(B&& builder) noexcept {
+    if constexpr (sizeof...(P) == 1) {
+        builder(std::get<0>(m_IndexObjects));
+    } else {
+        // indices are independent from each other and only read the objects
+        std::vector<std::thread> workers;
+        workers.reserve(sizeof...(P));
+        std::apply([&](auto&... idx) { // for all indexes
+            (workers.emplace_back([&builder, &idx]() { builder(idx); }), ...);
+        }, m_IndexObjects);
+        
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::Load(ObjectContainer&& objects) noexcept {
+    const size_t count = objects.size();
+    if (count == 0) {
+        return;
+    }
+    MULTIINDEX_TIME(m_instruments, TableOperation::Bulk);
+    // lock
+    m_writer.Execute([&]() {
+        if (m_frozen) {
+            return;
+        }
+        
+        if constexpr (L == LockPolicy::Concurrent) {
+            std::vector<Iter> loaded;
+            loaded.reserve(count);
+            for (auto& object : objects) {
+                loaded.push_back(StoreObject(std::move(object)));
+            }
+            objects.clear();
+            
+            BuildIndices([&loaded](auto& idx) {
+                EpochGuard guard; // the worker thread reads the index tables too
+                auto iters = loaded; // every index reorders its own copy
+                idx.InsertBatch(iters);
+            });
+            // a concurrent writer may have found a record through the indices done first
+            for (const auto& iter : loaded) {
+                PublishObject(iter);
+            }
+        } else {
+            // the new objects go to the storage tail
+            Storage loaded(m_objects.get_allocator());
+            const uint64_t expiry = Expiry(m_cache.ttl);
+            for (auto& object : objects) {
+                auto it = loaded.emplace(loaded.end(), std::move(object));
+                it->m_state.store(expiry, std::memory_order_relaxed);
+                if (m_cache.maxBytes != 0) {
+                    m_bytes += Footprint(it->m_object);
+                }
+            }
+            objects.clear();
+            m_expiring = m_expiring || expiry != 0;
+            
+            auto first = loaded.begin();
+            for (const auto& record : loaded) {
+                NotifyInsert(record.m_object);
+            }
+            m_objects.splice(m_objects.end(), loaded);
+            if constexpr (kHandles) {
+                for (auto it = first; it != m_objects.end(); ++it) {
+                    it->m_handle = m_handles.Acquire(it);
+                }
+            }
+            
+            BuildIndices([&first, this, count](auto& idx) {
+                idx.Build(first, m_objects.end(), count);
+            });
+            Evict(kExpireSteps);
+        }
+    });
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::Rebuild() noexcept {
+    static_assert(L != LockPolicy::Concurrent, "Rebuild requires exclusive access to the indices");
+    MULTIINDEX_TIME(m_instruments, TableOperation::Bulk);
+    // lock
+    m_writer.Execute([&]() {
+        if (m_frozen) {
+            return;
+        }
+        
+        BuildIndices([this](auto& idx) {
+            idx.Clear();
+            idx.Build(m_objects.begin(), m_objects.end(), m_objects.size());
+        });
+    });
+}
+
+// Update by index
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::PackObjects() noexcept {
+    std::vector<std::pair<T, uint64_t>> objects;
+    objects.reserve(m_objects.size());
+    for (auto& record : m_objects) {
+        objects.emplace_back(std::move(record.m_object), record.m_state.load(std::memory_order_relaxed));
+    }
+    // releases the previous block, if any
+    m_objects.clear();
+    m_handles.Clear();
+    
+    m_arena.Open(objects.size());
+    for (auto& object : objects) {
+        auto it = m_objects.emplace(m_objects.end(), std::move(object.first));
+        it->m_state.store(object.second, std::memory_order_relaxed);
+        if constexpr (kHandles) {
+            it->m_handle = m_handles.Acquire(it);
+        }
+    }
+    m_arena.Close();
+    
+    m_hand = m_objects.end();
+    m_expireFrom = m_objects.end();
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::Freeze() noexcept {
+    static_assert((!std::is_base_of<ConcurrentTraits, P>::value && ...), "Freeze is not available with the concurrent indices");
+    MULTIINDEX_TIME(m_instruments, TableOperation::Bulk);
+    // lock
+    m_writer.Execute([&]() {
+        if (m_frozen) {
+            return;
+        }
+        
+        PackObjects();
+        BuildIndices([this](auto& idx) {
+            idx.Clear();
+            idx.Freeze(m_objects.begin(), m_objects.end(), m_objects.size());
+        });
+        m_frozen = true;
+    });
+    
+#if defined(__GLIBC__)
+    // return the freed nodes and buckets to the system
+    malloc_trim(0);
+#endif
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::Thaw() noexcept {
+    MULTIINDEX_TIME(m_instruments, TableOperation::Bulk);
+    // lock
+    m_writer.Execute([&]() {
+        if (!m_frozen) {
+            return;
+        }
+        
+        BuildIndices([this](auto& idx) {
+            idx.Clear();
+            idx.Build(m_objects.begin(), m_objects.end(), m_objects.size());
+        });
+        m_frozen = false;
+    });
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+bool MultiIndexTable<L, Capacity, T, P...>::IsFrozen() const noexcept {
+    // lock
+    ReadLock<L> locker(m_mutex);
+    return m_frozen;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+bool MultiIndexTable<L, Capacity, T, P...>::Update(const T& where, T&& what) noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    // find the index by a position
+    auto& idx = std::get<I>(m_IndexObjects);
+    SampleWrite();
+    MULTIINDEX_TIME(m_instruments, TableOperation::Update, I);
+    bool updated = false;
+    if constexpr (L == LockPolicy::Concurrent) {
+        // readers may hold the object, replace it by a copy instead of changing it in place
+        WriteLock<L> locker(m_mutex);
+        for (auto& iter : idx.FindIterators(where)) {
+            bool indexed = false;
+            if (!ClaimObject(iter, indexed)) { // concurrent update or delete took it
+                continue;
+            }
+            
+            std::apply([&iter](auto&... idx) { // for all indexes
+                (idx.Delete(iter), ...);
+            }, m_IndexObjects);
+            UnlinkObject(iter, indexed);
+            
+            std::bitset<sizeof...(P)> affectedIndices(1);
+            auto copy = StoreObject(what); // must be copyable
+            std::apply([&](auto&... idx) { // for all indexes
+                (idx.Insert(false, copy, affectedIndices[0]), ...);
+            }, m_IndexObjects);
+            PublishObject(copy);
+            updated = true;
+        }
+    } else {
+        // lock
+        m_writer.Execute([&]() {
+            if (m_frozen) {
+                return;
+            }
+            
+            updated = UpdateObjects<I>(where, std::forward<T>(what)) != 0;
+            Evict(kExpireSteps);
+        });
+    }
+    
+    return updated;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+size_t MultiIndexTable<L, Capacity, T, P...>::UpdateObjects(const T& where, T&& what) noexcept {
+    std::get<I>(m_IndexObjects).Sync();
+    auto iters = std::get<I>(m_IndexObjects).FindIterators(where);
+    for (auto& iter : iters) {
+        size_t indexPos = 0;
+        std::bitset<sizeof...(P)> affectediIndices;
+        std::apply([&](auto&... idx) { // for all indexes
+            (idx.Update(iter, what, affectediIndices[indexPos++]), ...);
+        }, m_IndexObjects);
+        
+        if (m_cache.maxBytes != 0) {
+            m_bytes -= Footprint(*iter);
+        }
+        NotifyErase(*iter);
+        
+        if (iters.size() == 1) {
+            *iter = std::forward<T>(what);
+        } else {
+            *iter = std::cref(what); // must be copyable
+        }
+        
+        if (m_cache.maxBytes != 0) {
+            m_bytes += Footprint(*iter);
+        }
+        NotifyInsert(*iter);
+        
+        indexPos = 0;
+        std::apply([&](auto&... idx) { // for all indexes
+            (idx.Insert(true, iter, affectediIndices[indexPos++]), ...);
+        }, m_IndexObjects);
+    }
+    
+    return iters.size();
+}
+
+
+// Delete by index
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+size_t MultiIndexTable<L, Capacity, T, P...>::Delete(const T& where) noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    // find the index by a position
+    auto& idx = std::get<I>(m_IndexObjects);
+    SampleWrite();
+    MULTIINDEX_TIME(m_instruments, TableOperation::Delete, I);
+    size_t deleted = 0;
+    // lock
+    m_writer.Execute([&]() {
+        if (m_frozen) {
+            return;
+        }
+        
+        // Find all candidates for deletion
+        idx.Sync();
+        auto iters = idx.FindIterators(where);
+        
+        for (auto& iter : iters) {
+            bool indexed = false;
+            if constexpr (L == LockPolicy::Concurrent) {
+                if (!ClaimObject(iter, indexed)) { // concurrent update or delete took it
+                    continue;
+                }
+            }
+            
+            std::apply([&iter](auto&... idx) { // for all indexes
+                (idx.Delete(iter), ...);
+            }, m_IndexObjects);
+            
+            if constexpr (L == LockPolicy::Concurrent) {
+                UnlinkObject(iter, indexed);
+            } else {
+                EraseObject(iter);
+            }
+            ++deleted;
+        }
+    });
+ 
+    return deleted;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+size_t MultiIndexTable<L, Capacity, T, P...>::DeleteRange(const T& lo, const T& hi) noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    constexpr IndexKind kind = IndexKindOf<std::tuple_element_t<I, std::tuple<P...>>>();
+    static_assert(kind == IndexKind::Ordered || kind == IndexKind::Radix, "DeleteRange requires an ordered or radix index");
+    static_assert(L != LockPolicy::Concurrent, "DeleteRange is not available with LockPolicy::Concurrent");
+    // find the index by a position
+    auto& idx = std::get<I>(m_IndexObjects);
+    SampleWrite();
+    MULTIINDEX_TIME(m_instruments, TableOperation::Delete, I);
+    size_t deleted = 0;
+    // lock
+    m_writer.Execute([&]() {
+        if (m_frozen) {
+            return;
+        }
+        
+        // the victims must include the pending inserts the range erase below will apply
+        idx.Sync();
+        std::vector<Iter> victims;
+        idx.VisitRange([&victims](const Iter& iter) {
+            iter.GetRecord().m_state.fetch_or(Record::kErased, std::memory_order_relaxed);
+            victims.push_back(iter);
+        }, lo, hi);
+        
+        if (victims.empty()) {
+            return;
+        }
+        
+        idx.DeleteRange(lo, hi);
+        DeleteMarked(victims, I, std::make_index_sequence<sizeof...(P)>());
+        for (const auto& iter : victims) {
+            EraseObject(iter);
+        }
+        deleted = victims.size();
+    });
+    
+    return deleted;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename F>
+size_t MultiIndexTable<L, Capacity, T, P...>::DeleteWhere(F&& pred) noexcept {
+    static_assert(L != LockPolicy::Concurrent, "DeleteWhere is not available with LockPolicy::Concurrent");
+    SampleWrite();
+    MULTIINDEX_TIME(m_instruments, TableOperation::Delete);
+    size_t deleted = 0;
+    // lock
+    m_writer.Execute([&]() {
+        if (m_frozen) {
+            return;
+        }
+        
+        std::vector<Iter> victims;
+        for (auto it = m_objects.begin(); it != m_objects.end(); ++it) {
+            if (pred(static_cast<const T&>(it->m_object))) {
+                it->m_state.fetch_or(Record::kErased, std::memory_order_relaxed);
+                victims.push_back(it);
+            }
+        }
+        
+        if (victims.empty()) {
+            return;
+        }
+        
+        DeleteMarked(victims, sizeof...(P), std::make_index_sequence<sizeof...(P)>());
+        for (const auto& iter : victims) {
+            EraseObject(iter);
+        }
+        deleted = victims.size();
+    });
+    
+    return deleted;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+void MultiIndexTable<L, Capacity, T, P...>::DeleteMarked(std::vector<Iter>& victims, size_t skip) noexcept {
+    if (I == skip) {
+        return;
+    }
+    
+    auto& idx = std::get<I>(m_IndexObjects);
+    if constexpr (!std::is_base_of<ConcurrentTraits, std::tuple_element_t<I, std::tuple<P...>>>::value) {
+        // a few victims are cheaper to look up than to sweep the whole index for
+        if (victims.size() * kSweepRatio >= idx.Size()) {
+            idx.DeleteMarked();
+            return;
+        }
+    }
+    
+    // every index reorders the objects in its own way
+    std::vector<Iter> iters(victims);
+    idx.DeleteBatch(iters);
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t... I>
+void MultiIndexTable<L, Capacity, T, P...>::DeleteMarked(std::vector<Iter>& victims, size_t skip, std::index_sequence<I...>) noexcept {
+    (DeleteMarked<I>(victims, skip), ...);
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t... I>
+size_t MultiIndexTable<L, Capacity, T, P...>::UpdateObjects(size_t index, const T& where, T&& what, std::index_sequence<I...>) noexcept {
+    size_t updated = 0;
+    ((index == I ? void(updated = UpdateObjects<I>(where, std::forward<T>(what))) : void()), ...);
+    return updated;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t... I>
+void MultiIndexTable<L, Capacity, T, P...>::FindIterators(size_t index, const T& where, std::vector<Iter>& iters, std::index_sequence<I...>) const noexcept {
+    ((index == I ? void(std::get<I>(m_IndexObjects).VisitHandles([&iters](const Iter& iter) { iters.push_back(iter); }, where)) : void()), ...);
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+size_t MultiIndexTable<L, Capacity, T, P...>::ApplyBatch(Batch&& batch) noexcept {
+    static_assert(L != LockPolicy::Concurrent, "Batches require exclusive access to the indices");
+    using Kind = typename Batch::Kind;
+    auto& operations = batch.m_operations;
+    size_t affected = 0;
+    MULTIINDEX_TIME(m_instruments, TableOperation::Bulk);
+    // lock
+    m_writer.Execute([&]() {
+        if (m_frozen) {
+            return;
+        }
+        
+        const uint64_t expiry = Expiry(m_cache.ttl);
+        std::vector<Iter> iters;
+        for (size_t first = 0, last = 0; first < operations.size(); first = last) {
+            const Kind kind = operations[first].m_kind;
+            for (last = first + 1; last < operations.size() && operations[last].m_kind == kind; ++last) {
+            }
+            
+            iters.clear();
+            switch (kind) {
+            case Kind::Insert:
+                for (size_t i = first; i < last; ++i) {
+                    SampleWrite();
+                    iters.push_back(StoreObject(std::move(*operations[i].m_what), expiry));
+                }
+                
+                std::apply([&iters](auto&... idx) { // for all indexes
+                    (idx.InsertBatch(iters), ...);
+                }, m_IndexObjects);
+                affected += last - first;
+                break;
+            case Kind::Update:
+                for (size_t i = first; i < last; ++i) {
+                    SampleWrite();
+                    affected += UpdateObjects(operations[i].m_index, *operations[i].m_where, std::move(*operations[i].m_what), std::index_sequence_for<P...>());
+                }
+                break;
+            case Kind::Delete:
+                // the deletes don't add objects, so the sequential result is the union of their matches
+                for (size_t i = first; i < last; ++i) {
+                    SampleWrite();
+                    size_t indexPos = 0;
+                    std::apply([&](auto&... idx) { // the lookup index applies its pending log
+                        ((indexPos++ == operations[i].m_index ? idx.Sync() : void()), ...);
+                    }, m_IndexObjects);
+                    FindIterators(operations[i].m_index, *operations[i].m_where, iters, std::index_sequence_for<P...>());
+                }
+                
+                std::sort(iters.begin(), iters.end(), [](const Iter& left, const Iter& right) {
+                    return std::less<const Record*>()(&left.GetRecord(), &right.GetRecord());
+                });
+                iters.erase(std::unique(iters.begin(), iters.end()), iters.end());
+                affected += iters.size();
+                
+                {
+                    // every index reorders the objects in its own way
+                    std::vector<Iter> victims(iters);
+                    std::apply([&victims](auto&... idx) { // for all indexes
+                        (idx.DeleteBatch(victims), ...);
+                    }, m_IndexObjects);
+                }
+                
+                for (const auto& iter : iters) {
+                    EraseObject(iter);
+                }
+                break;
+            }
+        }
+        
+        Evict(kExpireSteps);
+    });
+    
+    batch.Clear();
+    return affected;
+}
+
+// Search by index
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+std::optional<T> MultiIndexTable<L, Capacity, T, P...>::FindFirst(const T& what) const noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    // find the index by a position
+    const auto& idx = std::get<I>(m_IndexObjects);
+    SampleRead<I>();
+    MULTIINDEX_TIME(m_instruments, TableOperation::Find, I);
+    // lock
+    ReadLock<L> locker(m_mutex);
+    CatchUp<I>(locker);
+    return idx.FindFirst(what, ReadAccess());
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+typename MultiIndexTable<L, Capacity, T, P...>::ObjectContainer MultiIndexTable<L, Capacity, T, P...>::FindAll(const T& what) const noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    // find the index by a position
+    const auto& idx = std::get<I>(m_IndexObjects);
+    SampleRead<I>();
+    MULTIINDEX_TIME(m_instruments, TableOperation::Find, I);
+    // lock
+    ReadLock<L> locker(m_mutex);
+    CatchUp<I>(locker);
+    return idx.FindAll(what, ReadAccess());
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+std::vector<std::optional<T>> MultiIndexTable<L, Capacity, T, P...>::FindFirstBatch(const std::vector<T>& keys) const noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    // find the index by a position
+    const auto& idx = std::get<I>(m_IndexObjects);
+    constexpr IndexKind kind = IndexKindOf<std::tuple_element_t<I, std::tuple<P...>>>();
+    SampleRead<I>();
+    MULTIINDEX_TIME(m_instruments, TableOperation::Find, I);
+    std::vector<std::optional<T>> results(keys.size());
+    // lock
+    ReadLock<L> locker(m_mutex);
+    CatchUp<I>(locker);
+    const Access access = ReadAccess();
+    if constexpr (kind == IndexKind::HashedOrdered || kind == IndexKind::UnOrdered) {
+        idx.FindFirstBatch(keys, results, access);
+    } else { // the tree descent and the concurrent chains are dependent loads, nothing to overlap
+        for (size_t i = 0; i < keys.size(); ++i) {
+            results[i] = idx.FindFirst(keys[i], access);
+        }
+    }
+    return results;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I, typename S>
+void MultiIndexTable<L, Capacity, T, P...>::FindBySelector(S&& selector, const T& what) const noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    // find the index by a position
+    const auto& idx = std::get<I>(m_IndexObjects);
+    SampleRead<I>();
+    MULTIINDEX_TIME(m_instruments, TableOperation::Find, I);
+    // lock
+    ReadLock<L> locker(m_mutex);
+    CatchUp<I>(locker);
+    idx.FindBySelector(std::forward<S>(selector), what, ReadAccess());
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t... I>
+typename MultiIndexTable<L, Capacity, T, P...>::ObjectContainer MultiIndexTable<L, Capacity, T, P...>::FindAllOf(const T& what) const noexcept {
+    ObjectContainer result;
+    FindBySelectorOf<I...>([&result](const T& item) { result.push_back(item); }, what);
+    return result;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t... I, typename S>
+void MultiIndexTable<L, Capacity, T, P...>::FindBySelectorOf(S&& selector, const T& what) const noexcept {
+    // check the indices existance
+    static_assert(sizeof...(I) > 0, "At least one index is required");
+    static_assert(((I < sizeof...(P)) && ...), "Index is out of range");
+    (SampleRead<I>(), ...);
+    MULTIINDEX_TIME(m_instruments, TableOperation::Find);
+    // lock
+    ReadLock<L> locker(m_mutex);
+    CatchUp(locker, std::index_sequence<I...>());
+    const Access access = ReadAccess();
+    for (const auto& iter : Intersect<I...>(what)) {
+        if (access.Visit(iter)) {
+            selector(*iter);
+        }
+    }
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+bool MultiIndexTable<L, Capacity, T, P...>::Estimate(const T& what, size_t limit, size_t& count) const noexcept {
+    const auto& idx = std::get<I>(m_IndexObjects);
+    // ranked indices count in O(log n) regardless of the number of matches
+    if constexpr (std::is_base_of<RankedOrderedTraits, std::tuple_element_t<I, std::tuple<P...>>>::value) {
+        count = idx.Count(what, what);
+        return true;
+    } else {
+        count = idx.Estimate(what, limit);
+        return count < limit;
+    }
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t... I>
+typename MultiIndexTable<L, Capacity, T, P...>::Handles
+MultiIndexTable<L, Capacity, T, P...>::Intersect(const T& what) const noexcept {
+    constexpr size_t K = sizeof...(I);
+    // runs @f(idx) for the index at position @target of I...
+    auto visit = [this](size_t target, auto&& f) {
+        size_t j = 0;
+        ((j++ == target ? f(std::get<I>(m_IndexObjects)) : void()), ...);
+    };
+    
+    // cardinality estimates, the limit doubles until the most selective index is counted,
+    // so the estimates cost O(k * m) index entries, m - matches of the most selective index
+    std::array<size_t, K> counts{};
+    std::bitset<K> counted;
+    size_t fewest = std::numeric_limits<size_t>::max();
+    for (size_t limit = kEstimateFrom; fewest >= limit; limit *= 2) {
+        size_t j = 0;
+        ((counted[j] ? void() : void(counted[j] = Estimate<I>(what, limit, counts[j])), ++j), ...);
+        // the indices not counted yet have at least @limit matches
+        for (j = 0; j < K; ++j) {
+            if (counted[j]) {
+                fewest = std::min(fewest, counts[j]);
+            }
+        }
+    }
+    
+    Handles candidates;
+    if (fewest == 0) {
+        return candidates;
+    }
+    
+    // the indices over the residual limit only check the candidates
+    const size_t residual = fewest * kResidualRatio;
+    {
+        size_t j = 0;
+        ((counted[j] || counts[j] >= residual ? void() : void(Estimate<I>(what, residual, counts[j])), ++j), ...);
+    }
+    
+    std::array<size_t, K> order;
+    for (size_t j = 0; j < K; ++j) {
+        order[j] = j;
+    }
+    std::sort(order.begin(), order.end(), [&counts](size_t left, size_t right) { return counts[left] < counts[right]; });
+    
+    // handles are ordered by the storage record address
+    auto less = [](const Iter& left, const Iter& right) {
+        return std::less<const Record*>()(&left.GetRecord(), &right.GetRecord());
+    };
+    
+    candidates.reserve(counts[order[0]]);
+    visit(order[0], [&](const auto& idx) {
+        idx.VisitHandles([&candidates](const Iter& iter) { candidates.push_back(iter); }, what);
+    });
+    std::sort(candidates.begin(), candidates.end(), less);
+    
+    size_t n = 1;
+    for (; n < K && counts[order[n]] < residual && !candidates.empty(); ++n) {
+        Handles common;
+        if (counts[order[n]] <= candidates.size() * kMergeRatio) {
+            // comparable sets, sorted merge
+            Handles other;
+            other.reserve(counts[order[n]]);
+            visit(order[n], [&](const auto& idx) {
+                idx.VisitHandles([&other](const Iter& iter) { other.push_back(iter); }, what);
+            });
+            std::sort(other.begin(), other.end(), less);
+            std::set_intersection(candidates.begin(), candidates.end(), other.begin(), other.end(), std::back_inserter(common), less);
+        } else {
+            // hash probe of the smaller candidates set
+            std::unordered_set<const Record*> probe;
+            probe.reserve(candidates.size());
+            for (const auto& iter : candidates) {
+                probe.insert(&iter.GetRecord());
+            }
+            visit(order[n], [&](const auto& idx) {
+                idx.VisitHandles([&](const Iter& iter) {
+                    if (probe.count(&iter.GetRecord()) != 0) {
+                        common.push_back(iter);
+                    }
+                }, what);
+            });
+            std::sort(common.begin(), common.end(), less);
+        }
+        candidates.swap(common);
+    }
+    
+    // residual indices, the candidates are few, check them by the index predicates
+    for (; n < K && !candidates.empty(); ++n) {
+        visit(order[n], [&](const auto& idx) {
+            candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](const Iter& iter) {
+                return !idx.Matches(*iter, what);
+            }), candidates.end());
+        });
+    }
+    
+    return candidates;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+typename MultiIndexTable<L, Capacity, T, P...>::Cursor
+MultiIndexTable<L, Capacity, T, P...>::Seek(const T& key, bool reverse) const noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    constexpr IndexKind kind = IndexKindOf<std::tuple_element_t<I, std::tuple<P...>>>();
+    static_assert(kind == IndexKind::Ordered || kind == IndexKind::ConcurrentOrdered || kind == IndexKind::Radix, "Cursor requires an ordered index");
+    Cursor cursor;
+    cursor.m_key = std::cref(key); // copyable
+    cursor.m_reverse = reverse;
+    return cursor;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+typename MultiIndexTable<L, Capacity, T, P...>::Cursor
+MultiIndexTable<L, Capacity, T, P...>::SeekFirst(bool reverse) const noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    constexpr IndexKind kind = IndexKindOf<std::tuple_element_t<I, std::tuple<P...>>>();
+    static_assert(kind == IndexKind::Ordered || kind == IndexKind::ConcurrentOrdered || kind == IndexKind::Radix, "Cursor requires an ordered index");
+    Cursor cursor;
+    cursor.m_reverse = reverse;
+    return cursor;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I, typename S>
+size_t MultiIndexTable<L, Capacity, T, P...>::Next(S&& selector, Cursor& cursor, size_t count) const noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    constexpr IndexKind kind = IndexKindOf<std::tuple_element_t<I, std::tuple<P...>>>();
+    static_assert(kind == IndexKind::Ordered || kind == IndexKind::ConcurrentOrdered || kind == IndexKind::Radix, "Cursor requires an ordered index");
+    // find the index by a position
+    const auto& idx = std::get<I>(m_IndexObjects);
+    SampleRead<I>();
+    MULTIINDEX_TIME(m_instruments, TableOperation::Scan, I);
+    // lock
+    ReadLock<L> locker(m_mutex);
+    CatchUp<I>(locker);
+    // the scans don't mark the objects as used, a full scan would flush the CLOCK history
+    auto access = ReadAccess();
+    access.m_touch = false;
+    return idx.Scan(std::forward<S>(selector), cursor, count, access);
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+typename MultiIndexTable<L, Capacity, T, P...>::ObjectContainer
+MultiIndexTable<L, Capacity, T, P...>::Next(Cursor& cursor, size_t count) const noexcept {
+    ObjectContainer result;
+    Next<I>([&result](const T& item) { result.push_back(item); }, cursor, count);
+    return result;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I, typename S>
+void MultiIndexTable<L, Capacity, T, P...>::FindRange(S&& selector, const T& lo, const T& hi) const noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    constexpr IndexKind kind = IndexKindOf<std::tuple_element_t<I, std::tuple<P...>>>();
+    static_assert(kind == IndexKind::Ordered || kind == IndexKind::ConcurrentOrdered || kind == IndexKind::Radix, "FindRange requires an ordered index");
+    // find the index by a position
+    const auto& idx = std::get<I>(m_IndexObjects);
+    SampleRead<I>();
+    MULTIINDEX_TIME(m_instruments, TableOperation::Find, I);
+    // lock
+    ReadLock<L> locker(m_mutex);
+    CatchUp<I>(locker);
+    const Access access = ReadAccess();
+    idx.VisitRange([&](const Iter& iter) {
+        if (access.Visit(iter)) {
+            selector(*iter);
+        }
+    }, lo, hi);
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I, typename S>
+void MultiIndexTable<L, Capacity, T, P...>::FindByPrefix(S&& selector, const RadixKey& prefix) const noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    static_assert(IndexKindOf<std::tuple_element_t<I, std::tuple<P...>>>() == IndexKind::Radix, "FindByPrefix requires a radix index");
+    // find the index by a position
+    const auto& idx = std::get<I>(m_IndexObjects);
+    SampleRead<I>();
+    MULTIINDEX_TIME(m_instruments, TableOperation::Find, I);
+    // lock
+    ReadLock<L> locker(m_mutex);
+    CatchUp<I>(locker);
+    const Access access = ReadAccess();
+    idx.VisitPrefix([&](const Iter& iter) {
+        if (access.Visit(iter)) {
+            selector(*iter);
+        }
+    }, prefix);
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+typename MultiIndexTable<L, Capacity, T, P...>::ObjectContainer
+MultiIndexTable<L, Capacity, T, P...>::FindByPrefix(const RadixKey& prefix) const noexcept {
+    ObjectContainer result;
+    FindByPrefix<I>([&result](const T& item) { result.push_back(item); }, prefix);
+    return result;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I, typename S, size_t D>
+void MultiIndexTable<L, Capacity, T, P...>::FindInBox(S&& selector, const SpatialBox<D>& box) const noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    using Pred = std::tuple_element_t<I, std::tuple<P...>>;
+    static_assert(IndexKindOf<Pred>() == IndexKind::Spatial, "FindInBox requires a spatial index");
+    static_assert(D == Pred::Dimensions, "Box dimensions must match the index dimensions");
+    // find the index by a position
+    const auto& idx = std::get<I>(m_IndexObjects);
+    SampleRead<I>();
+    MULTIINDEX_TIME(m_instruments, TableOperation::Find, I);
+    // lock
+    ReadLock<L> locker(m_mutex);
+    CatchUp<I>(locker);
+    const Access access = ReadAccess();
+    idx.VisitBox([&](const Iter& iter) {
+        if (access.Visit(iter)) {
+            selector(*iter);
+        }
+    }, box);
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I, size_t D>
+typename MultiIndexTable<L, Capacity, T, P...>::ObjectContainer
+MultiIndexTable<L, Capacity, T, P...>::FindInBox(const SpatialBox<D>& box) const noexcept {
+    ObjectContainer result;
+    FindInBox<I>([&result](const T& item) { result.push_back(item); }, box);
+    return result;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I, typename S, size_t D>
+void MultiIndexTable<L, Capacity, T, P...>::FindNearest(S&& selector, const SpatialPoint<D>& point, size_t k) const noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    using Pred = std::tuple_element_t<I, std::tuple<P...>>;
+    static_assert(IndexKindOf<Pred>() == IndexKind::Spatial, "FindNearest requires a spatial index");
+    static_assert(D == Pred::Dimensions, "Point dimensions must match the index dimensions");
+    if (k == 0) {
+        return;
+    }
+    // find the index by a position
+    const auto& idx = std::get<I>(m_IndexObjects);
+    SampleRead<I>();
+    MULTIINDEX_TIME(m_instruments, TableOperation::Find, I);
+    // lock
+    ReadLock<L> locker(m_mutex);
+    CatchUp<I>(locker);
+    const Access access = ReadAccess();
+    size_t visited = 0;
+    // expired objects don't count
+    idx.VisitNearest([&](const Iter& iter) {
+        if (access.Visit(iter)) {
+            selector(*iter);
+            ++visited;
+        }
+        return visited < k;
+    }, point);
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I, size_t D>
+typename MultiIndexTable<L, Capacity, T, P...>::ObjectContainer
+MultiIndexTable<L, Capacity, T, P...>::FindNearest(const SpatialPoint<D>& point, size_t k) const noexcept {
+    ObjectContainer result;
+    FindNearest<I>([&result](const T& item) { result.push_back(item); }, point, k);
+    return result;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+const RoaringBitmap& MultiIndexTable<L, Capacity, T, P...>::Bitmaps::Of(const T& what) const noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    static_assert(IndexKindOf<std::tuple_element_t<I, std::tuple<P...>>>() == IndexKind::Bitmap, "Bitmaps::Of requires a bitmap index");
+    static const RoaringBitmap none;
+    const RoaringBitmap* handles = std::get<I>(m_table.m_IndexObjects).Bitmap(what);
+    return handles != nullptr ? *handles : none;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+const RoaringBitmap& MultiIndexTable<L, Capacity, T, P...>::Bitmaps::All() const noexcept {
+    return m_table.m_handles.Live();
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename S, typename F>
+void MultiIndexTable<L, Capacity, T, P...>::FindByBitmap(S&& selector, F&& filter) const noexcept {
+    static_assert(kHandles, "FindByBitmap requires a bitmap index");
+    MULTIINDEX_TIME(m_instruments, TableOperation::Find);
+    // lock
+    ReadLock<L> locker(m_mutex);
+    // the filter may read any bitmap index
+    CatchUp(locker, std::index_sequence_for<P...>());
+    const Access access = ReadAccess();
+    const RoaringBitmap handles = filter(Bitmaps(*this));
+    for (uint32_t handle : handles) {
+        const Iter& iter = m_handles[handle];
+        if (access.Visit(iter)) {
+            selector(*iter);
+        }
+    }
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<typename F>
+typename MultiIndexTable<L, Capacity, T, P...>::ObjectContainer
+MultiIndexTable<L, Capacity, T, P...>::FindByBitmap(F&& filter) const noexcept {
+    ObjectContainer result;
+    FindByBitmap([&result](const T& item) { result.push_back(item); }, std::forward<F>(filter));
+    return result;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+size_t MultiIndexTable<L, Capacity, T, P...>::Count(const T& lo, const T& hi) const noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    static_assert(std::is_base_of<RankedOrderedTraits, std::tuple_element_t<I, std::tuple<P...>>>::value, "Count requires a ranked ordered index");
+    // find the index by a position
+    const auto& idx = std::get<I>(m_IndexObjects);
+    SampleRead<I>();
+    MULTIINDEX_TIME(m_instruments, TableOperation::Find, I);
+    // lock
+    ReadLock<L> locker(m_mutex);
+    CatchUp<I>(locker);
+    return idx.Count(lo, hi);
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+size_t MultiIndexTable<L, Capacity, T, P...>::Rank(const T& key) const noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    static_assert(std::is_base_of<RankedOrderedTraits, std::tuple_element_t<I, std::tuple<P...>>>::value, "Rank requires a ranked ordered index");
+    // find the index by a position
+    const auto& idx = std::get<I>(m_IndexObjects);
+    SampleRead<I>();
+    MULTIINDEX_TIME(m_instruments, TableOperation::Find, I);
+    // lock
+    ReadLock<L> locker(m_mutex);
+    CatchUp<I>(locker);
+    return idx.Rank(key);
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+std::optional<T> MultiIndexTable<L, Capacity, T, P...>::Nth(size_t k) const noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    static_assert(std::is_base_of<RankedOrderedTraits, std::tuple_element_t<I, std::tuple<P...>>>::value, "Nth requires a ranked ordered index");
+    // find the index by a position
+    const auto& idx = std::get<I>(m_IndexObjects);
+    SampleRead<I>();
+    MULTIINDEX_TIME(m_instruments, TableOperation::Find, I);
+    // lock
+    ReadLock<L> locker(m_mutex);
+    CatchUp<I>(locker);
+    return idx.Nth(k);
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+size_t MultiIndexTable<L, Capacity, T, P...>::Size() const noexcept {
+    // lock
+    ReadLock<L> locker(m_mutex);
+    if constexpr (L == LockPolicy::Concurrent) {
+        // erased objects stay in the storage until reclaimed, the index counts the live ones
+        return std::get<0>(m_IndexObjects).Size();
+    } else {
+        return m_objects.size();
+    }
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+void MultiIndexTable<L, Capacity, T, P...>::SetResultCache(size_t entries) noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    static_assert(L != LockPolicy::Concurrent, "Result cache is not available with LockPolicy::Concurrent");
+    // lock
+    m_writer.Execute([&]() {
+        std::get<I>(m_IndexObjects).SetResultCache(entries);
+    });
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+ResultCacheStats MultiIndexTable<L, Capacity, T, P...>::GetResultCacheStats() const noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    return std::get<I>(m_IndexObjects).GetResultCacheStats();
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+void MultiIndexTable<L, Capacity, T, P...>::SetDeferred(bool deferred) noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    static_assert(L != LockPolicy::Concurrent, "Deferred indices are not available with LockPolicy::Concurrent");
+    // lock
+    m_writer.Execute([&]() {
+        std::get<I>(m_IndexObjects).SetDeferred(deferred, uint32_t(I));
+    });
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+void MultiIndexTable<L, Capacity, T, P...>::Sync() noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    MULTIINDEX_TIME(m_instruments, TableOperation::Bulk);
+    // lock
+    m_writer.Execute([&]() {
+        std::get<I>(m_IndexObjects).Sync();
+    });
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+void MultiIndexTable<L, Capacity, T, P...>::CatchUp(ReadLock<L>& locker) const noexcept {
+    CatchUp(locker, std::index_sequence<I>());
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t... I>
+void MultiIndexTable<L, Capacity, T, P...>::CatchUp(ReadLock<L>& locker, std::index_sequence<I...>) const noexcept {
+    if constexpr (L != LockPolicy::Concurrent) {
+        // the pending log is applied under the write lock, the read is not a modification of the table.
+        // A writer may defer more inserts before the read lock is back, so the check repeats under it.
+        while ((std::get<I>(m_IndexObjects).Behind() || ...)) {
+            locker.Release([this]() {
+                (const_cast<MultiIndexTable*>(this)->Sync<I>(), ...);
+            });
+        }
+    }
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+template<size_t I>
+void MultiIndexTable<L, Capacity, T, P...>::SampleRead() const noexcept {
+    if (m_tuning.load(std::memory_order_relaxed)) {
+        m_reads[I].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::SampleWrite() noexcept {
+    if (m_tuning.load(std::memory_order_relaxed)) {
+        m_writes.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::SetTuning(bool enable) noexcept {
+    if (enable && !m_tuning.load(std::memory_order_relaxed)) { // a new sampling period
+        for (auto& reads : m_reads) {
+            reads.store(0, std::memory_order_relaxed);
+        }
+        m_writes.store(0, std::memory_order_relaxed);
+    }
+    m_tuning.store(enable, std::memory_order_relaxed);
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+std::array<IndexStats, sizeof...(P)> MultiIndexTable<L, Capacity, T, P...>::Tune(bool adopt) noexcept {
+    std::array<IndexStats, sizeof...(P)> stats;
+    auto collect = [&]() {
+        const size_t writes = m_writes.load(std::memory_order_relaxed);
+        size_t i = 0;
+        std::apply([&](auto&... idx) { // for all indexes
+            ((stats[i] = idx.Stats(m_reads[i].load(std::memory_order_relaxed), writes), ++i), ...);
+        }, m_IndexObjects);
+    };
+    
+    if (!adopt) {
+        // lock
+        ReadLock<L> locker(m_mutex);
+        collect();
+        return stats;
+    }
+    
+    // lock
+    m_writer.Execute([&]() {
+        collect();
+        size_t i = 0;
+        std::apply([&](auto&... idx) { // for all indexes
+            (idx.SetCapacity(stats[i++].recommended), ...);
+        }, m_IndexObjects);
+    });
+    
+    return stats;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::Compact(float fill) noexcept {
+    MULTIINDEX_TIME(m_instruments, TableOperation::Bulk);
+    // lock
+    m_writer.Execute([&]() {
+        if (m_frozen) {
+            return;
+        }
+        
+        std::apply([&](auto&... idx) { // for all indexes
+            (idx.Compact(std::chrono::steady_clock::time_point::max(), fill), ...);
+        }, m_IndexObjects);
+        m_compacted.reset();
+    });
+    
+#if defined(__GLIBC__)
+    // return the freed pages to the system
+    malloc_trim(0);
+#endif
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+bool MultiIndexTable<L, Capacity, T, P...>::Compact(std::chrono::microseconds slice, float fill) noexcept {
+    if constexpr (L == LockPolicy::Concurrent) {
+        // concurrent indices compact in one step
+        Compact(fill);
+        return true;
+    } else {
+        MULTIINDEX_TIME(m_instruments, TableOperation::Bulk);
+        bool done = false;
+        // lock
+        m_writer.Execute([&]() {
+            if (m_frozen) { // nothing to compact
+                done = true;
+                return;
+            }
+            
+            const auto deadline = std::chrono::steady_clock::now() + slice;
+            size_t i = 0;
+            std::apply([&](auto&... idx) { // for all indexes, every pending index makes progress
+                ((m_compacted[i] = m_compacted[i] || idx.Compact(deadline, fill), ++i), ...);
+            }, m_IndexObjects);
+            
+            done = m_compacted.all();
+            if (done) {
+                m_compacted.reset();
+            }
+        });
+        
+#if defined(__GLIBC__)
+        if (done) {
+            // return the freed pages to the system
+            malloc_trim(0);
+        }
+#endif
+        return done;
+    }
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+inline bool MultiIndexTable<L, Capacity, T, P...>::Access::Visit(const Iter& iter) const noexcept {
+    auto& state = iter.GetRecord().m_state; // mutable
+    uint64_t value = state.load(std::memory_order_relaxed);
+    if (m_now != 0) {
+        uint64_t expiry = value & Record::kExpiry;
+        if (expiry != 0 && expiry <= m_now) {
+            return false;
+        }
+    }
+    
+    // the readers share the lock, set the bit only once to keep the cache line clean
+    if (m_touch && (value & Record::kReferenced) == 0) {
+        state.fetch_or(Record::kReferenced, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+typename MultiIndexTable<L, Capacity, T, P...>::Access
+MultiIndexTable<L, Capacity, T, P...>::ReadAccess() const noexcept {
+    Access access;
+    access.m_touch = m_bounded;
+    access.m_now = m_expiring ? NowMs() : 0;
+    return access;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+uint64_t MultiIndexTable<L, Capacity, T, P...>::Expiry(std::chrono::milliseconds ttl) const noexcept {
+    return ttl.count() > 0 ? NowMs() + uint64_t(ttl.count()) : 0;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+/*static*/
+uint64_t MultiIndexTable<L, Capacity, T, P...>::NowMs() noexcept {
+    return uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+size_t MultiIndexTable<L, Capacity, T, P...>::Footprint(const T& obj) const noexcept {
+    // the list node keeps two pointers besides the record
+    return m_cache.sizeOf ? m_cache.sizeOf(obj) : sizeof(Record) + 2 * sizeof(void*);
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::EvictObject(typename Storage::iterator it) noexcept {
+    Iter iter(it);
+    std::apply([&iter](auto&... idx) { // for all indexes in one pass
+        (idx.Delete(iter), ...);
+    }, m_IndexObjects);
+    
+    if (m_cache.onEvict) {
+        m_cache.onEvict(*iter);
+    }
+    EraseObject(iter);
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+size_t MultiIndexTable<L, Capacity, T, P...>::Evict(size_t expireSteps) noexcept {
+    size_t evicted = 0;
+    if (m_frozen) { // the frozen objects stay until Thaw
+        return evicted;
+    }
+    
+    if (m_expiring) {
+        const uint64_t now = NowMs();
+        for (size_t i = 0; i < expireSteps && !m_objects.empty(); ++i) {
+            if (m_expireFrom == m_objects.end()) {
+                m_expireFrom = m_objects.begin();
+            }
+            
+            auto it = m_expireFrom++;
+            uint64_t expiry = it->m_state.load(std::memory_order_relaxed) & Record::kExpiry;
+            if (expiry != 0 && expiry <= now) {
+                EvictObject(it);
+                ++evicted;
+            }
+        }
+    }
+    
+    if (!m_bounded) {
+        return evicted;
+    }
+    
+    // CLOCK - the hand clears the reference bits until it finds an object not used since the last pass
+    while ((m_cache.maxObjects != 0 && m_objects.size() > m_cache.maxObjects)
+           || (m_cache.maxBytes != 0 && m_bytes > m_cache.maxBytes && !m_objects.empty())) {
+        if (m_hand == m_objects.end()) {
+            m_hand = m_objects.begin();
+        }
+        
+        auto it = m_hand++;
+        if ((it->m_state.load(std::memory_order_relaxed) & Record::kReferenced) != 0) {
+            it->m_state.fetch_and(~Record::kReferenced, std::memory_order_relaxed);
+        } else {
+            EvictObject(it);
+        }
+    }
+    
+    return evicted;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::SetCacheOptions(CacheOptions options) noexcept {
+    static_assert(L != LockPolicy::Concurrent, "Cache mode is not available with LockPolicy::Concurrent");
+    // lock
+    m_writer.Execute([&]() {
+        m_cache = std::move(options);
+        m_bounded = m_cache.maxObjects != 0 || m_cache.maxBytes != 0;
+        m_bytes = 0;
+        if (m_cache.maxBytes != 0) {
+            for (const auto& record : m_objects) {
+                m_bytes += Footprint(record.m_object);
+            }
+        }
+        // apply the new limits right away
+        Evict(0);
+    });
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+size_t MultiIndexTable<L, Capacity, T, P...>::Expire(size_t budget) noexcept {
+    static_assert(L != LockPolicy::Concurrent, "Expiry is not available with LockPolicy::Concurrent");
+    size_t expired = 0;
+    MULTIINDEX_TIME(m_instruments, TableOperation::Bulk);
+    // lock
+    m_writer.Execute([&]() {
+        if (m_expiring) {
+            // one pass over the storage at most
+            expired = Evict(std::min(budget, m_objects.size()));
+        }
+    });
+    return expired;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::NotifyInsert(const T& object) noexcept {
+    for (auto* observer : m_observers) {
+        observer->OnInsert(object);
+    }
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::NotifyErase(const T& object) noexcept {
+    for (auto* observer : m_observers) {
+        observer->OnErase(object);
+    }
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::Attach(TableObserver<T>& observer) noexcept {
+    static_assert(L != LockPolicy::Concurrent, "Observers are not available with LockPolicy::Concurrent");
+    // lock
+    m_writer.Execute([&]() {
+        for (const auto& record : m_objects) {
+            observer.OnInsert(record.m_object);
+        }
+        m_observers.push_back(&observer);
+    });
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::Detach(TableObserver<T>& observer) noexcept {
+    static_assert(L != LockPolicy::Concurrent, "Observers are not available with LockPolicy::Concurrent");
+    // lock
+    m_writer.Execute([&]() {
+        m_observers.erase(std::remove(m_observers.begin(), m_observers.end(), &observer), m_observers.end());
+    });
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+TableMetrics<sizeof...(P)> MultiIndexTable<L, Capacity, T, P...>::GetMetrics() const noexcept {
+    TableMetrics<sizeof...(P)> metrics;
+#if defined(MULTIINDEX_INSTRUMENTATION)
+    for (size_t i = 0; i < kTableOperations; ++i) {
+        metrics.operations[i] = m_instruments.m_operations[i].Get();
+    }
+    
+    size_t i = 0;
+    std::apply([&](const auto&... idx) { // for all indexes
+        ((metrics.indices[i].latency = m_instruments.m_indices[i].Get(),
+          metrics.indices[i].rehashes = idx.Events().rehashes.load(std::memory_order_relaxed),
+          metrics.indices[i].splits = idx.Events().splits.load(std::memory_order_relaxed),
+          metrics.indices[i].merges = idx.Events().merges.load(std::memory_order_relaxed), ++i), ...);
+    }, m_IndexObjects);
+    metrics.readLockWaits = m_instruments.m_lockWaits.read.Get();
+    metrics.writeLockWaits = m_instruments.m_lockWaits.write.Get();
+#endif
+    return metrics;
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::ResetMetrics() noexcept {
+#if defined(MULTIINDEX_INSTRUMENTATION)
+    for (auto& operation : m_instruments.m_operations) {
+        operation.Reset();
+    }
+    
+    for (auto& index : m_instruments.m_indices) {
+        index.Reset();
+    }
+    
+    std::apply([](const auto&... idx) { // for all indexes
+        ((idx.Events().rehashes.store(0, std::memory_order_relaxed),
+          idx.Events().splits.store(0, std::memory_order_relaxed),
+          idx.Events().merges.store(0, std::memory_order_relaxed)), ...);
+    }, m_IndexObjects);
+    m_instruments.m_lockWaits.read.Reset();
+    m_instruments.m_lockWaits.write.Reset();
+#endif
+}
+
+template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
+void MultiIndexTable<L, Capacity, T, P...>::Clear() noexcept {
+    MULTIINDEX_TIME(m_instruments, TableOperation::Bulk);
+    // lock
+    m_writer.Execute([&]() {
+        if constexpr (L == LockPolicy::Concurrent) {
+            // the concurrent writers keep running, every object is claimed the way Delete claims it
+            auto& first = std::get<0>(m_IndexObjects);
+            std::vector<Iter> iters;
+            iters.reserve(first.Size());
+            first.VisitAll([&iters](const Iter& iter) { iters.push_back(iter); });
+            for (const auto& iter : iters) {
+                bool indexed = false;
+                if (!ClaimObject(iter, indexed)) { // concurrent update or delete took it
+                    continue;
+                }
+                
+                std::apply([&iter](auto&... idx) { // for all indexes
+                    (idx.Delete(iter), ...);
+                }, m_IndexObjects);
+                UnlinkObject(iter, indexed);
+            }
+        } else {
+            std::apply([&](auto&... idx) { // for all indexes
+                (idx.Clear(), ...);
+            }, m_IndexObjects);
+            m_objects.clear();
+            m_handles.Clear();
+            for (auto* observer : m_observers) {
+                observer->OnClear();
+            }
+            m_hand = m_objects.end();
+            m_expireFrom = m_objects.end();
+            m_bytes = 0;
+            m_frozen = false;
+        }
+    });
 }
 
 template<LockPolicy L, uint32_t Capacity, typename T, typename... P>
@@ -254,5 +2239,6 @@ void MultiIndexTable<L, Capacity, T, P...>::Traverse() const noexcept {
     // find the index by a position
     const auto& idx = std::get<I>(m_IndexObjects);
     ReadLock<L> locker(m_mutex);
+    CatchUp<I>(locker);
     idx.Traverse();
 }
@@ -8,23 +8,55 @@
 #pragma once
 
 #include <set>
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <new>
+#include <optional>
+#include <vector>
+
+#include "Instrumentation.h"
 
 #define assertm(exp, msg) assert(((void)msg, exp))
 
+struct RankedOrderedTraits;
+
+// ranked indices keep the number of items in the node subtree
+struct OrderedSubtreeCount {
+    size_t m_subtreeItems{0};
+};
+
+struct OrderedNoSubtreeCount {};
+
+// the stored objects of the tables with the ordered indices keep their bucket nodes, one per ordered index
+template <size_t N>
+struct IndexNodes {
+    void* m_nodes[N];
+};
+
+template <>
+struct IndexNodes<0> {};
+
 // Index keeps list<Key>::iterator(s), which are essentially pointers
 // therefore index nodes should be small in size, ideally just packed arrays of iterators
 // to reduce the memory usage overhead.
 // [0][1][2]...[M] - binary tree
 // [0] -> [0][1][2]...[N] - array of iterators sorted by keys
+// Keys not less than the rightmost one are appended to the rightmost bucket without a descent,
+// a full bucket is not split by them, so the time series and sequence keys fill the buckets completely.
+// Every object keeps the node of its bucket, the erase looks for the object among the node items only.
+// Equal keys are ordered by the object address, so every object has a unique position.
 template <uint32_t Capacity, typename Iter, typename Pred>
 class OrderedMultiSet {
+    using Value = std::remove_reference_t<decltype(*std::declval<Iter>())>;
+    static constexpr bool kRanked = std::is_base_of<RankedOrderedTraits, Pred>::value;
+
     struct Bucket {
         size_t m_size{0};
         Iter m_head[Capacity];
     };
     
-    struct BucketNode {
+    struct BucketNode : std::conditional_t<kRanked, OrderedSubtreeCount, OrderedNoSubtreeCount> {
         BucketNode* m_parent{nullptr};
         BucketNode* m_left{nullptr};
         BucketNode* m_right{nullptr};
@@ -33,6 +65,10 @@ class OrderedMultiSet {
         bool m_isNull{false};
     };
 
+public:
+    // the erase takes the object node, no descent and no scan of the equal keys
+    static constexpr bool kDirectErase = true;
+
 private:
     // not publicaly exposed, no need to follow std iterator interface
     class iterator {
@@ -116,10 +152,26 @@ private:
     void LRotate(BucketNode* w) noexcept;
     void RRotate(BucketNode* w) noexcept;
     void Remove(BucketNode* z) noexcept;
+    // recalculates subtree counts from x up to the root, ranked indices only
+    void Recount(BucketNode* x) noexcept;
+    // the items [@from, @to) of x moved into x
+    void Adopt(BucketNode* x, size_t from, size_t to) noexcept;
+    // restores the red-black invariants and the counts after the new leaf x is linked
+    void Rebalance(BucketNode* x) noexcept;
+    // moves the items of w past @keep to a new next bucket
+    void SplitTail(BucketNode* w, size_t keep) noexcept;
+
+    static size_t SubtreeItems(const BucketNode* x) noexcept;
+    // the index order, the key then the object address
+    bool Precedes(const Value& first, const Value& second) const noexcept {
+        return m_compare(first, second) || (!m_compare(second, first) && &first < &second);
+    }
 
     static BucketNode* Max(BucketNode* x) noexcept;
     static BucketNode* Min(BucketNode* x) noexcept;
     static void Destroy(BucketNode* node) noexcept;
+    // deletes all nodes of the tree
+    void DestroyTree() noexcept;
 
 private:
     
@@ -132,6 +184,14 @@ private:
     //    is root is null m_headNode.m_parent = m_headNode.m_left = m_headNode.m_right = &m_headNode;
     BucketNode m_headNode;
     size_t m_totalItems{0}; // keeps track of total number of items.
+    std::optional<Value> m_compactFrom; // resume key of the time sliced compaction
+    std::optional<Iter> m_compactAt; // resume object, the node of its bucket is past the equal keys compacted already
+    uint32_t m_bucketCapacity{Capacity}; // runtime bucket split threshold, never exceeds Capacity
+    BucketNode* m_frozen{nullptr}; // all nodes in the breadth first order of the tree, see freeze
+    uint32_t m_node{0}; // object node slot of the index, see attach_node
+#if defined(MULTIINDEX_INSTRUMENTATION)
+    mutable IndexEvents m_events;
+#endif
     
     OrderedMultiSet(const OrderedMultiSet& src) noexcept = delete;
     OrderedMultiSet(OrderedMultiSet&& src) noexcept = delete;
@@ -139,9 +199,15 @@ private:
 protected:
     explicit OrderedMultiSet(TupleParams<Pred>&& params) noexcept;
     ~OrderedMultiSet() noexcept;
+    
+    // the slot of the object nodes, the ordered indices of a table get the distinct slots before the first insert
+    void attach_node(uint32_t slot) noexcept { m_node = slot; }
  
     template <typename K>
     bool is_equal(const K& first, const K& second) const noexcept;
+    
+    template <typename K>
+    bool is_less(const K& first, const K& second) const noexcept { return m_compare(first, second); }
 
     // insert
     bool insert(bool, const Iter& key) noexcept;
@@ -149,6 +215,35 @@ protected:
     // erase
     size_t erase(Iter key) noexcept;
     
+    // erases the items of [@first, @last) @doomed returns true for, bucket by bucket,
+    // the emptied buckets are dropped from the tree at once. The remaining buckets are not merged, see compact.
+    template <typename F>
+    size_t erase_if(iterator first, iterator last, F&& doomed) noexcept;
+    template <typename F>
+    size_t erase_if(F&& doomed) noexcept { return erase_if(begin(), end(), std::forward<F>(doomed)); }
+    
+    // nothing to preallocate, buckets are allocated on demand
+    void reserve(size_t) noexcept {}
+    
+    size_t size() const noexcept { return m_totalItems; }
+#if defined(MULTIINDEX_INSTRUMENTATION)
+    IndexEvents& events() const noexcept { return m_events; }
+#endif
+    
+    // repacks up to @steps buckets to @fill of the Capacity pulling items from the following buckets,
+    // a bucket over the runtime capacity is split first,
+    // returns true when the last bucket is reached, otherwise the next call resumes from where it stopped.
+    bool compact(size_t steps, float fill) noexcept;
+    
+    // runtime bucket capacity, clamped to Capacity, compact splits the existing buckets over it
+    void set_capacity(uint32_t capacity) noexcept;
+    
+    // structure statistics and the recommended capacity for the sampled @reads and @writes
+    IndexStats stats(size_t reads, size_t writes) const noexcept;
+    
+    // sorts @keys by the index order, batched inserts and erases walk the tree left to right
+    void sort_keys(std::vector<Iter>& keys) const noexcept;
+    
     // const version equal_range
     template <typename K>
     std::pair<iterator, iterator> equal_range(const K& key) const noexcept;
@@ -156,11 +251,35 @@ protected:
     // find the first item by the key.
     template <typename K>
     iterator find(const K& key) const noexcept;
+    
+    // the first item not less than the key
+    template <typename K>
+    iterator lower_bound(const K& key) const noexcept;
+    
+    // the first item greater than the key
+    template <typename K>
+    iterator upper_bound(const K& key) const noexcept;
+    
+    // the first item not before the position of @key at @object in the index order, @object may be gone
+    iterator lower_bound(const Value& key, const Value* object) const noexcept;
+
+    // number of items before the iterator position, O(log n), ranked indices only
+    size_t rank(const iterator& it) const noexcept;
+    
+    // iterator to the item at position k in the sorted order, O(log n), ranked indices only
+    iterator nth(size_t k) const noexcept;
 
     iterator begin() const noexcept { return iterator(LMost(), 0); }
 
     iterator end() const noexcept { return iterator(HeadNode(), 0); }
     
+    // read only flat layout - builds the empty set of @items as a complete tree with full buckets in one array
+    // of nodes laid out breadth first (Eytzinger order), so the top levels of every descent share the cache lines.
+    // The nodes keep their links, the iterators and the order statistics work as usual.
+    // The set must not be modified until clear.
+    void freeze(std::vector<Iter>& items) noexcept;
+    bool frozen() const noexcept { return m_frozen != nullptr; }
+    
     // clear
     void clear() noexcept;
     
@@ -13,7 +13,7 @@ OrderedMultiSet<Capacity, Iter, Pred>::OrderedMultiSet(TupleParams<Pred>&& param
 
 template <uint32_t Capacity, typename Iter, typename Pred>
 OrderedMultiSet<Capacity, Iter, Pred>::~OrderedMultiSet() noexcept {
-    Destroy(Root());
+    DestroyTree();
 }
 
 template <uint32_t Capacity, typename Iter, typename Pred>
@@ -54,6 +54,11 @@ void OrderedMultiSet<Capacity, Iter, Pred>::LRotate(BucketNode* w) noexcept {
     
     x->m_left = w;
     w->m_parent = x;
+    
+    if constexpr (kRanked) {
+        x->m_subtreeItems = w->m_subtreeItems;
+        w->m_subtreeItems = w->m_bucket.m_size + SubtreeItems(w->m_left) + SubtreeItems(w->m_right);
+    }
 }
 
 template <uint32_t Capacity, typename Iter, typename Pred>
@@ -74,6 +79,11 @@ void OrderedMultiSet<Capacity, Iter, Pred>::RRotate(BucketNode* w) noexcept {
     
     x->m_right = w;
     w->m_parent = x;
+    
+    if constexpr (kRanked) {
+        x->m_subtreeItems = w->m_subtreeItems;
+        w->m_subtreeItems = w->m_bucket.m_size + SubtreeItems(w->m_left) + SubtreeItems(w->m_right);
+    }
 }
     
 template <uint32_t Capacity, typename Iter, typename Pred>
@@ -145,6 +155,9 @@ void OrderedMultiSet<Capacity, Iter, Pred>::Remove(BucketNode* z) noexcept {
         x->m_parent = z->m_parent; // link successor up
         std::swap(x->m_isBlack, z->m_isBlack);// recolor it
     }
+    
+    // the path from rParent to the root lost z, rotations below keep counts consistent
+    Recount(rParent);
 
     if (z->m_isBlack) {    // erasing black link, must recolor/rebalance tree
         for (; r != Root() && r->m_isBlack; rParent = r->m_parent) {
@@ -209,6 +222,99 @@ void OrderedMultiSet<Capacity, Iter, Pred>::Remove(BucketNode* z) noexcept {
     }
 }
 
+template <uint32_t Capacity, typename Iter, typename Pred>
+void OrderedMultiSet<Capacity, Iter, Pred>::Recount(BucketNode* x) noexcept {
+    if constexpr (kRanked) {
+        for (; !x->m_isNull; x = x->m_parent) {
+            x->m_subtreeItems = x->m_bucket.m_size + SubtreeItems(x->m_left) + SubtreeItems(x->m_right);
+        }
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+void OrderedMultiSet<Capacity, Iter, Pred>::Adopt(BucketNode* x, size_t from, size_t to) noexcept {
+    for (size_t i = from; i < to; ++i) {
+        x->m_bucket.m_head[i].Node(m_node) = x;
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+void OrderedMultiSet<Capacity, Iter, Pred>::Rebalance(BucketNode* x) noexcept {
+    // the new node and its ancestors, rotations below keep counts consistent
+    Recount(x);
+    
+    BucketNode* w;
+    while (!x->m_parent->m_isBlack) {
+        if (x->m_parent == x->m_parent->m_parent->m_left) {    // fixup red-red in left subtree
+            w = x->m_parent->m_parent->m_right;
+            if (!w->m_isBlack) {    // parent has two red children, blacken both
+                x->m_parent->m_isBlack = true;
+                w->m_isBlack = true;
+                x->m_parent->m_parent->m_isBlack = false;
+                x= x->m_parent->m_parent;
+            } else {    // parent has red and black children
+                if (x == x->m_parent->m_right) {    // rotate right child to left
+                    x = x->m_parent;
+                    LRotate(x);
+                }
+                x->m_parent->m_isBlack = true;
+                x->m_parent->m_parent->m_isBlack = false;
+                RRotate(x->m_parent->m_parent);
+            }
+        } else {    // fixup red-red in right subtree
+            w = x->m_parent->m_parent->m_left;
+            if (!w->m_isBlack) {    // parent has two red children, blacken both
+                x->m_parent->m_isBlack = true;
+                w->m_isBlack = true;
+                x->m_parent->m_parent->m_isBlack = false;
+                x = x->m_parent->m_parent;
+            } else {    // parent has red and black children
+                if (x == x->m_parent->m_left) {    // rotate left child to right
+                    x = x->m_parent;
+                    RRotate(x);
+                }
+                x->m_parent->m_isBlack = true;
+                x->m_parent->m_parent->m_isBlack = false;
+                LRotate(x->m_parent->m_parent);
+            }
+        }
+    }
+    Root()->m_isBlack = true;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+void OrderedMultiSet<Capacity, Iter, Pred>::SplitTail(BucketNode* w, size_t keep) noexcept {
+    MULTIINDEX_COUNT(m_events.splits);
+    BucketNode* x = allocateNode();
+    x->m_bucket.m_size = w->m_bucket.m_size - keep;
+    memcpy(x->m_bucket.m_head, w->m_bucket.m_head + keep, sizeof(Iter) * x->m_bucket.m_size);
+    w->m_bucket.m_size = keep;
+    Adopt(x, 0, x->m_bucket.m_size);
+    
+    if (w == RMost()) {
+        RMost() = x;
+    }
+    // the new bucket is the in-order successor of the old one, attached as a leaf
+    if (w->m_right->m_isNull) {
+        x->m_parent = w;
+        w->m_right = x;
+    } else {
+        x->m_parent = Min(w->m_right);
+        x->m_parent->m_left = x;
+    }
+    Rebalance(x);
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+/*static*/
+size_t OrderedMultiSet<Capacity, Iter, Pred>::SubtreeItems(const BucketNode* x) noexcept {
+    if constexpr (kRanked) {
+        return x->m_isNull ? 0 : x->m_subtreeItems;
+    } else {
+        return 0;
+    }
+}
+
 template <uint32_t Capacity, typename Iter, typename Pred>
 typename OrderedMultiSet<Capacity, Iter, Pred>::BucketNode* OrderedMultiSet<Capacity, Iter, Pred>::allocateNode() {
     BucketNode* newNode = new BucketNode;
@@ -259,6 +365,16 @@ void OrderedMultiSet<Capacity, Iter, Pred>::Destroy(BucketNode* node) noexcept {
     }
 }
 
+template <uint32_t Capacity, typename Iter, typename Pred>
+void OrderedMultiSet<Capacity, Iter, Pred>::DestroyTree() noexcept {
+    if (m_frozen != nullptr) {
+        delete[] m_frozen;
+        m_frozen = nullptr;
+    } else {
+        Destroy(Root());
+    }
+}
+
 template <uint32_t Capacity, typename Iter, typename Pred>
 template <typename K>
 std::pair<typename OrderedMultiSet<Capacity, Iter, Pred>::iterator, typename OrderedMultiSet<Capacity, Iter, Pred>::iterator>
@@ -317,6 +433,18 @@ template <uint32_t Capacity, typename Iter, typename Pred>
 template <typename K>
 typename OrderedMultiSet<Capacity, Iter, Pred>::iterator
 OrderedMultiSet<Capacity, Iter, Pred>::find(const K& key) const noexcept {
+    iterator lower = lower_bound(key);
+    if (lower != end() && !m_compare(key, **lower)) {
+        return lower;
+    }
+    
+    return end();
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+template <typename K>
+typename OrderedMultiSet<Capacity, Iter, Pred>::iterator
+OrderedMultiSet<Capacity, Iter, Pred>::lower_bound(const K& key) const noexcept {
     const BucketNode* x = Root();
     const BucketNode* l = HeadNode();
 
@@ -337,9 +465,98 @@ OrderedMultiSet<Capacity, Iter, Pred>::find(const K& key) const noexcept {
         assert(offset != l->m_bucket.m_size);
     }
     
-    iterator lower(l, offset);
-    if (lower != end() && !m_compare(key, **lower)) {
-        return lower;
+    return iterator(l, offset);
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+template <typename K>
+typename OrderedMultiSet<Capacity, Iter, Pred>::iterator
+OrderedMultiSet<Capacity, Iter, Pred>::upper_bound(const K& key) const noexcept {
+    const BucketNode* x = Root();
+    const BucketNode* u = HeadNode();
+
+    while (!x->m_isNull) {
+        if (m_compare(key, *x->m_bucket.m_head[x->m_bucket.m_size - 1])) { // x greater than key, remember it
+            u = x;
+            x = x->m_left;    // descend left subtree
+        } else {
+            x = x->m_right;    // descend right subtree
+        }
+    }
+    
+    size_t offset = 0;
+    if (!u->m_isNull) { // indication of end node
+        offset = std::upper_bound(u->m_bucket.m_head, u->m_bucket.m_head + u->m_bucket.m_size, key,
+                                  [this](const K& first, const Iter& second) -> bool { return m_compare(first, *second); }
+        ) - u->m_bucket.m_head;
+        assert(offset != u->m_bucket.m_size);
+    }
+    
+    return iterator(u, offset);
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+typename OrderedMultiSet<Capacity, Iter, Pred>::iterator
+OrderedMultiSet<Capacity, Iter, Pred>::lower_bound(const Value& key, const Value* object) const noexcept {
+    // the position compares as the key, then as the address
+    auto before = [this, &key, object](const Iter& item) -> bool {
+        const Value& value = *item;
+        return m_compare(value, key) || (!m_compare(key, value) && &value < object);
+    };
+    
+    const BucketNode* x = Root();
+    const BucketNode* l = HeadNode();
+    while (!x->m_isNull) {
+        if (before(x->m_bucket.m_head[x->m_bucket.m_size - 1])) {
+            x = x->m_right;
+        } else {
+            l = x;
+            x = x->m_left;
+        }
+    }
+    
+    size_t offset = 0;
+    if (!l->m_isNull) {
+        offset = std::partition_point(l->m_bucket.m_head, l->m_bucket.m_head + l->m_bucket.m_size, before) - l->m_bucket.m_head;
+        assert(offset != l->m_bucket.m_size);
+    }
+    
+    return iterator(l, offset);
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+size_t OrderedMultiSet<Capacity, Iter, Pred>::rank(const iterator& it) const noexcept {
+    static_assert(kRanked, "Ordered index predicate must be derived from RankedOrderedTraits");
+    const BucketNode* x = it.GetNodePtr();
+    if (x->m_isNull) {
+        return m_totalItems;
+    }
+    
+    size_t r = it.GetOffset() + SubtreeItems(x->m_left);
+    for (; !x->m_parent->m_isNull; x = x->m_parent) {
+        if (x == x->m_parent->m_right) { // everything in the parent's left subtree and bucket precedes x
+            r += SubtreeItems(x->m_parent->m_left) + x->m_parent->m_bucket.m_size;
+        }
+    }
+    
+    return r;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+typename OrderedMultiSet<Capacity, Iter, Pred>::iterator
+OrderedMultiSet<Capacity, Iter, Pred>::nth(size_t k) const noexcept {
+    static_assert(kRanked, "Ordered index predicate must be derived from RankedOrderedTraits");
+    const BucketNode* x = Root();
+    while (!x->m_isNull) {
+        size_t left = SubtreeItems(x->m_left);
+        if (k < left) {
+            x = x->m_left;
+        } else if (k < left + x->m_bucket.m_size) {
+            return iterator(x, k - left);
+        } else {
+            k -= left + x->m_bucket.m_size;
+            x = x->m_right;
+        }
     }
     
     return end();
@@ -354,17 +571,34 @@ OrderedMultiSet<Capacity, Iter, Pred>::insert(bool, const Iter& key) noexcept {
     //      2.a - split the old bucket into two buckets and insert the new key into the correct position
     //      2.b - old bucket will serve as a parent node for the new node, reconnect the new node and do the rebalance
     // 3. First bucket - just create a new bucket node as a root and add the new key
+    // 4. The key is not less than the rightmost one (timestamps, sequences) - append to the rightmost bucket,
+    //    a full one is not split, the new key opens the next bucket, so the appended buckets stay full
 
     BucketNode* x = Root();
     BucketNode* w = HeadNode();
     bool addLeft = true;
+    const bool append = !x->m_isNull && !Precedes(*key, *RMost()->m_bucket.m_head[RMost()->m_bucket.m_size - 1]);
+    if (append) {
+        w = RMost();
+        if (w->m_bucket.m_size < m_bucketCapacity) {
+            memcpy(w->m_bucket.m_head + w->m_bucket.m_size, &key, sizeof(key));
+            ++w->m_bucket.m_size;
+            key.Node(m_node) = w;
+            Recount(w);
+            ++m_totalItems;
+            return true;
+        }
+        x = HeadNode(); // no descent, the new bucket goes to the right of the rightmost one
+        addLeft = false;
+    }
+
     while (!x->m_isNull) {  // look for the bucket to insert
         w = x;
         
-        if (m_compare(*key, *x->m_bucket.m_head[0])) { // i.e. 1 [2,3]
+        if (Precedes(*key, *x->m_bucket.m_head[0])) { // i.e. 1 [2,3]
             x = x->m_left;
             addLeft = true;
-        } else if (m_compare(*x->m_bucket.m_head[x->m_bucket.m_size - 1], *key)) { // [2,3] 4
+        } else if (Precedes(*x->m_bucket.m_head[x->m_bucket.m_size - 1], *key)) { // [2,3] 4
             x = x->m_right;
             addLeft = false;
         } else { // i.e. 2 [1, 3]
@@ -377,11 +611,11 @@ OrderedMultiSet<Capacity, Iter, Pred>::insert(bool, const Iter& key) noexcept {
     }
     
     if (!w->m_isNull) {
-        if (w->m_bucket.m_size != Capacity) {
+        if (w->m_bucket.m_size < m_bucketCapacity) {
             assert(w->m_bucket.m_size > 0);
             size_t offset = w->m_bucket.m_size;
             auto* ptr = std::lower_bound(w->m_bucket.m_head, w->m_bucket.m_head + offset, key,
-                                         [this](const Iter& first, const Iter& second) -> bool { return m_compare(*first, *second); }
+                                         [this](const Iter& first, const Iter& second) -> bool { return Precedes(*first, *second); }
                                          );
             
             if (ptr != w->m_bucket.m_head + offset) {
@@ -392,16 +626,19 @@ OrderedMultiSet<Capacity, Iter, Pred>::insert(bool, const Iter& key) noexcept {
             
             memcpy(ptr, &key, sizeof(key));
             ++w->m_bucket.m_size;
+            key.Node(m_node) = w;
+            Recount(w);
             ++m_totalItems;
             return true;
-        } else if (w->m_bucket.m_size != 1) {
-            assert(w->m_bucket.m_size == Capacity);
+        } else if (w->m_bucket.m_size != 1 && !append) {
+            assert(w->m_bucket.m_size >= m_bucketCapacity);
             // the bucket is full - split it
-            size_t moffset = (Capacity - 1) / 2; // 2->0, 3->1, 4->1, 5->2, 6->2 ..., etc
+            MULTIINDEX_COUNT(m_events.splits);
+            size_t moffset = (w->m_bucket.m_size - 1) / 2; // 2->0, 3->1, 4->1, 5->2, 6->2 ..., etc
             
             size_t offset = w->m_bucket.m_size;
             auto* ptr = std::lower_bound(w->m_bucket.m_head, w->m_bucket.m_head + offset, key,
-                                         [this](const Iter& first, const Iter& second) -> bool { return m_compare(*first, *second); }
+                                         [this](const Iter& first, const Iter& second) -> bool { return Precedes(*first, *second); }
                                          );
 
             offset = ptr - w->m_bucket.m_head;
@@ -427,13 +664,14 @@ OrderedMultiSet<Capacity, Iter, Pred>::insert(bool, const Iter& key) noexcept {
                 if (w == LMost()) {
                     LMost() = x;
                 }
-                x->m_parent = w;
-                x->m_left = w->m_left;
-                if (!w->m_left->m_isNull) {
-                    x->m_left = w->m_left;
-                    w->m_left->m_parent = x;
+                // the new bucket is the in-order predecessor of the old one, attached as a leaf
+                if (w->m_left->m_isNull) {
+                    x->m_parent = w;
+                    w->m_left = x;
+                } else {
+                    x->m_parent = Max(w->m_left);
+                    x->m_parent->m_right = x;
                 }
-                w->m_left = x;
             } else {
                 if (offset != moffset + 1) {
                     // copy the second half of the bucket before offset, if any
@@ -452,13 +690,14 @@ OrderedMultiSet<Capacity, Iter, Pred>::insert(bool, const Iter& key) noexcept {
                 if (w == RMost()) {
                     RMost() = x;
                 }
-                x->m_parent = w;
-                x->m_right = w->m_right;
-                if (!w->m_right->m_isNull) {
-                    x->m_right = w->m_right;
-                    w->m_right->m_parent = x;
+                // the new bucket is the in-order successor of the old one, attached as a leaf
+                if (w->m_right->m_isNull) {
+                    x->m_parent = w;
+                    w->m_right = x;
+                } else {
+                    x->m_parent = Min(w->m_right);
+                    x->m_parent->m_left = x;
                 }
-                w->m_right = x;
             }
         } else {
             x = allocateNode();
@@ -489,100 +728,308 @@ OrderedMultiSet<Capacity, Iter, Pred>::insert(bool, const Iter& key) noexcept {
         RMost() = x;
     }
 
-    while (!x->m_parent->m_isBlack) {
-        if (x->m_parent == x->m_parent->m_parent->m_left) {    // fixup red-red in left subtree
-            w = x->m_parent->m_parent->m_right;
-            if (!w->m_isBlack) {    // parent has two red children, blacken both
-                x->m_parent->m_isBlack = true;
-                w->m_isBlack = true;
-                x->m_parent->m_parent->m_isBlack = false;
-                x= x->m_parent->m_parent;
-            } else {    // parent has red and black children
-                if (x == x->m_parent->m_right) {    // rotate right child to left
-                    x = x->m_parent;
-                    LRotate(x);
-                }
-                x->m_parent->m_isBlack = true;
-                x->m_parent->m_parent->m_isBlack = false;
-                RRotate(x->m_parent->m_parent);
-            }
-        } else {    // fixup red-red in right subtree
-            w = x->m_parent->m_parent->m_left;
-            if (!w->m_isBlack) {    // parent has two red children, blacken both
-                x->m_parent->m_isBlack = true;
-                w->m_isBlack = true;
-                x->m_parent->m_parent->m_isBlack = false;
-                x = x->m_parent->m_parent;
-            } else {    // parent has red and black children
-                if (x == x->m_parent->m_left) {    // rotate left child to right
-                    x = x->m_parent;
-                    RRotate(x);
-                }
-                x->m_parent->m_isBlack = true;
-                x->m_parent->m_parent->m_isBlack = false;
-                LRotate(x->m_parent->m_parent);
-            }
-        }
-    }
-    Root()->m_isBlack = true;
+    // the new bucket has the key and the items moved by the split
+    Adopt(x, 0, x->m_bucket.m_size);
+    Rebalance(x);
     ++m_totalItems;
     return true;
 }
 
 template <uint32_t Capacity, typename Iter, typename Pred>
 size_t OrderedMultiSet<Capacity, Iter, Pred>::erase(Iter key) noexcept {
-    for (auto p = equal_range(*key); p.first != p.second; ++p.first) {
-        if (*p.first == key) {
-            BucketNode* node = p.first.GetNodePtr();
-            size_t offset = p.first.GetOffset();
-            if (offset + 1 == node->m_bucket.m_size) { // last item in the bucket
-                if (1 == node->m_bucket.m_size) { // the only one item
-                    Remove(node);
-                    delete node;
-                    --m_totalItems;
-                    return 1;
-                } else {
-                    --node->m_bucket.m_size; // just reduce the size
-                }
+    // the object node, then the object among the node items, the keys are not compared
+    BucketNode* node = static_cast<BucketNode*>(key.Node(m_node));
+    Iter* ptr = std::find(node->m_bucket.m_head, node->m_bucket.m_head + node->m_bucket.m_size, key);
+    if (ptr == node->m_bucket.m_head + node->m_bucket.m_size) {
+        return 0;
+    }
+    
+    if (m_compactAt && *m_compactAt == key) {
+        m_compactAt.reset();
+    }
+    
+    size_t offset = ptr - node->m_bucket.m_head;
+    if (offset + 1 == node->m_bucket.m_size) { // last item in the bucket
+        if (1 == node->m_bucket.m_size) { // the only one item
+            Remove(node);
+            delete node;
+            --m_totalItems;
+            return 1;
+        } else {
+            --node->m_bucket.m_size; // just reduce the size
+        }
+    } else {
+        // void* memmove( void* dest, const void* src, size_t count );
+        memmove(node->m_bucket.m_head + offset, node->m_bucket.m_head + offset + 1, sizeof(Iter) * (node->m_bucket.m_size - offset - 1));
+        --node->m_bucket.m_size;
+    }
+    
+    Recount(node);
+
+    // check if the current semi-empty bucket if it's a leaf and can be merged with parent
+    if (!node->m_parent->m_isNull // parent exists
+        && node->m_bucket.m_size < m_bucketCapacity / 2
+        && node->m_parent->m_bucket.m_size < m_bucketCapacity / 2) {
+        bool isLeft = node == node->m_parent->m_left;
+        
+        if ((isLeft && node->m_right->m_isNull) || (!isLeft && node->m_left->m_isNull)) {
+            BucketNode* parent = node->m_parent;
+            // if this node is left add to the head, if right one add to the tail
+            if (isLeft) {
+                memmove(parent->m_bucket.m_head + node->m_bucket.m_size, parent->m_bucket.m_head, sizeof(Iter) * parent->m_bucket.m_size);
+                memcpy(parent->m_bucket.m_head, node->m_bucket.m_head, sizeof(Iter) * node->m_bucket.m_size);
+                parent->m_bucket.m_size += node->m_bucket.m_size;
+                Adopt(parent, 0, node->m_bucket.m_size);
             } else {
-                // void* memmove( void* dest, const void* src, size_t count );
-                memmove(node->m_bucket.m_head + offset, node->m_bucket.m_head + offset + 1, sizeof(Iter) * (node->m_bucket.m_size - offset - 1));
-                --node->m_bucket.m_size;
+                memcpy(parent->m_bucket.m_head + parent->m_bucket.m_size, node->m_bucket.m_head, sizeof(Iter) * node->m_bucket.m_size);
+                parent->m_bucket.m_size += node->m_bucket.m_size;
+                Adopt(parent, parent->m_bucket.m_size - node->m_bucket.m_size, parent->m_bucket.m_size);
             }
+            Remove(node);
+            delete node;
+            MULTIINDEX_COUNT(m_events.merges);
+        }
+    }
+    --m_totalItems;
+    return 1;
+}
 
-            // check if the current semi-empty bucket if it's a leaf and can be merged with parent
-            if (!node->m_parent->m_isNull // parent exists
-                && node->m_bucket.m_size < Capacity / 2
-                && node->m_parent->m_bucket.m_size < Capacity / 2) {
-                bool isLeft = node == node->m_parent->m_left;
-                
-                if ((isLeft && node->m_right->m_isNull) || (!isLeft && node->m_left->m_isNull)) {
-                    // if this node is left add to the head, if right one add to the tail
-                    if (isLeft) {
-                        memmove(node->m_parent->m_bucket.m_head + node->m_bucket.m_size, node->m_parent->m_bucket.m_head, sizeof(Iter) * node->m_parent->m_bucket.m_size);
-                        memcpy(node->m_parent->m_bucket.m_head, node->m_bucket.m_head, sizeof(Iter) * node->m_bucket.m_size);
-                        node->m_parent->m_bucket.m_size += node->m_bucket.m_size;
-                    } else {
-                        memcpy(node->m_parent->m_bucket.m_head + node->m_parent->m_bucket.m_size, node->m_bucket.m_head, sizeof(Iter) * node->m_bucket.m_size);
-                        node->m_parent->m_bucket.m_size += node->m_bucket.m_size;
-                    }
-                    Remove(node);
-                    delete node;
-                }
+template <uint32_t Capacity, typename Iter, typename Pred>
+template <typename F>
+size_t OrderedMultiSet<Capacity, Iter, Pred>::erase_if(iterator first, iterator last, F&& doomed) noexcept {
+    size_t erased = 0;
+    BucketNode* node = first.GetNodePtr();
+    size_t from = first.GetOffset();
+    while (!node->m_isNull) {
+        const bool isLast = node == last.GetNodePtr();
+        const size_t to = isLast ? last.GetOffset() : node->m_bucket.m_size;
+        // the nodes don't move, the next one stays valid when this one is removed
+        iterator next(node, node->m_bucket.m_size - 1);
+        ++next;
+        
+        size_t kept = from;
+        for (size_t i = from; i < to; ++i) {
+            if (!doomed(node->m_bucket.m_head[i])) {
+                node->m_bucket.m_head[kept++] = node->m_bucket.m_head[i];
+            } else if (m_compactAt && *m_compactAt == node->m_bucket.m_head[i]) {
+                m_compactAt.reset();
             }
-            --m_totalItems;
-            return 1;
+        }
+        
+        if (kept != to) {
+            memmove(node->m_bucket.m_head + kept, node->m_bucket.m_head + to, sizeof(Iter) * (node->m_bucket.m_size - to));
+            node->m_bucket.m_size -= to - kept;
+            erased += to - kept;
+            if (node->m_bucket.m_size == 0) {
+                Remove(node);
+                delete node;
+            } else {
+                Recount(node);
+            }
+        }
+        
+        if (isLast) {
+            break;
+        }
+        
+        node = next.GetNodePtr();
+        from = 0;
+    }
+    
+    m_totalItems -= erased;
+    return erased;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+bool OrderedMultiSet<Capacity, Iter, Pred>::compact(size_t steps, float fill) noexcept {
+    const size_t target = std::clamp<size_t>(size_t(m_bucketCapacity * fill), 1, m_bucketCapacity);
+    // the resume object leads to its bucket, the resume key is the fallback once the object is erased
+    BucketNode* x = m_compactAt ? static_cast<BucketNode*>(m_compactAt->Node(m_node))
+        : m_compactFrom ? lower_bound(*m_compactFrom).GetNodePtr() : LMost();
+    
+    for (; !x->m_isNull && steps != 0; --steps) {
+        // a bucket over the lowered runtime capacity hands its largest items to a new next bucket
+        if (x->m_bucket.m_size > m_bucketCapacity) {
+            SplitTail(x, m_bucketCapacity);
+        }
+        
+        // pull the smallest items of the next buckets, the order of items is preserved
+        while (x->m_bucket.m_size < target) {
+            iterator next(x, x->m_bucket.m_size - 1);
+            ++next;
+            BucketNode* y = next.GetNodePtr();
+            if (y->m_isNull) {
+                break;
+            }
+            
+            size_t moved = std::min(target - x->m_bucket.m_size, y->m_bucket.m_size);
+            memcpy(x->m_bucket.m_head + x->m_bucket.m_size, y->m_bucket.m_head, sizeof(Iter) * moved);
+            Adopt(x, x->m_bucket.m_size, x->m_bucket.m_size + moved);
+            x->m_bucket.m_size += moved;
+            y->m_bucket.m_size -= moved;
+            if (y->m_bucket.m_size != 0) {
+                memmove(y->m_bucket.m_head, y->m_bucket.m_head + moved, sizeof(Iter) * y->m_bucket.m_size);
+            }
+            
+            Recount(y);
+            Recount(x);
+            if (y->m_bucket.m_size == 0) {
+                Remove(y);
+                delete y;
+                MULTIINDEX_COUNT(m_events.merges);
+            }
+        }
+        
+        iterator next(x, x->m_bucket.m_size - 1);
+        ++next;
+        x = next.GetNodePtr();
+    }
+    
+    if (!x->m_isNull) {
+        m_compactFrom = *x->m_bucket.m_head[0];
+        m_compactAt = x->m_bucket.m_head[0];
+        return false;
+    }
+    
+    m_compactFrom.reset();
+    m_compactAt.reset();
+    return true;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+void OrderedMultiSet<Capacity, Iter, Pred>::set_capacity(uint32_t capacity) noexcept {
+    // equal keys never descend past a bucket, so the buckets hold at least two items unless Capacity is 1
+    m_bucketCapacity = std::clamp<uint32_t>(capacity, std::min<uint32_t>(2, Capacity), Capacity);
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+void OrderedMultiSet<Capacity, Iter, Pred>::sort_keys(std::vector<Iter>& keys) const noexcept {
+    // equal keys by the object address, the index order
+    std::sort(keys.begin(), keys.end(), [this](const Iter& first, const Iter& second) -> bool { return Precedes(*first, *second); });
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+IndexStats OrderedMultiSet<Capacity, Iter, Pred>::stats(size_t reads, size_t writes) const noexcept {
+    IndexStats stats;
+    stats.items = m_totalItems;
+    stats.capacity = m_bucketCapacity;
+    stats.reads = reads;
+    stats.writes = writes;
+    for (auto it = begin(); it != end(); ) { // bucket by bucket
+        BucketNode* x = it.GetNodePtr();
+        ++stats.buckets;
+        stats.slots += Capacity;
+        it = iterator(x, x->m_bucket.m_size - 1);
+        ++it;
+    }
+    
+    // tree height, the walk keeps the depth of every pending node
+    std::vector<std::pair<const BucketNode*, size_t>> pending;
+    if (!Root()->m_isNull) {
+        pending.emplace_back(Root(), 1);
+    }
+    while (!pending.empty()) {
+        auto [x, depth] = pending.back();
+        pending.pop_back();
+        stats.depth = std::max(stats.depth, depth);
+        if (!x->m_left->m_isNull) {
+            pending.emplace_back(x->m_left, depth + 1);
+        }
+        if (!x->m_right->m_isNull) {
+            pending.emplace_back(x->m_right, depth + 1);
+        }
+    }
+    
+    // per operation cost in compares, a node visit is a cache miss worth kMiss compares,
+    // an insert or erase moves half of the bucket, kMove moves per compare.
+    constexpr double kMiss = 8.0;
+    constexpr double kMove = 0.25;
+    const double n = double(std::max<size_t>(m_totalItems, 1));
+    const double r = reads + writes == 0 ? 1.0 : double(reads);
+    const double w = reads + writes == 0 ? 1.0 : double(writes);
+    double best = 0.0;
+    auto consider = [&](uint32_t c) {
+        const double depth = std::max(std::log2(n / c), 0.0) + 1.0;
+        const double cost = (r + w) * (depth * kMiss + std::log2(double(c))) + w * kMove * c / 2;
+        if (best == 0.0 || cost < best) {
+            best = cost;
+            stats.recommended = c;
+        }
+    };
+    
+    for (uint32_t c = 2; c < Capacity; c *= 2) {
+        consider(c);
+    }
+    consider(Capacity);
+    
+    return stats;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+void OrderedMultiSet<Capacity, Iter, Pred>::freeze(std::vector<Iter>& items) noexcept {
+    if (m_frozen != nullptr || m_totalItems != 0 || items.empty()) {
+        return;
+    }
+    
+    sort_keys(items);
+    // node k has children 2k + 1 and 2k + 2, the items are spread evenly over the nodes
+    const size_t count = (items.size() + Capacity - 1) / Capacity;
+    BucketNode* nodes = new (std::nothrow) BucketNode[count];
+    if (nodes == nullptr) { // allocation failure, stay as is
+        return;
+    }
+    
+    // a complete tree is a red black tree with the incomplete last level red
+    size_t depth = 0;
+    while ((size_t(2) << depth) <= count) {
+        ++depth;
+    }
+    const bool complete = ((count + 1) & count) == 0;
+    
+    size_t next = 0;
+    size_t ordinal = 0;
+    auto assign = [&](auto& self, size_t k, size_t level) -> void {
+        if (k >= count) {
+            return;
+        }
+        
+        BucketNode* node = nodes + k;
+        node->m_parent = k == 0 ? HeadNode() : nodes + (k - 1) / 2;
+        node->m_left = 2 * k + 1 < count ? nodes + 2 * k + 1 : HeadNode();
+        node->m_right = 2 * k + 2 < count ? nodes + 2 * k + 2 : HeadNode();
+        node->m_isBlack = complete || level < depth;
+        node->m_isNull = false;
+        
+        self(self, 2 * k + 1, level + 1);
+        const size_t last = items.size() * ++ordinal / count;
+        node->m_bucket.m_size = last - next;
+        std::copy(items.begin() + next, items.begin() + last, node->m_bucket.m_head);
+        Adopt(node, 0, node->m_bucket.m_size);
+        next = last;
+        self(self, 2 * k + 2, level + 1);
+    };
+    assign(assign, 0, 0);
+    
+    if constexpr (kRanked) {
+        for (size_t k = count; k-- > 0;) {
+            nodes[k].m_subtreeItems = nodes[k].m_bucket.m_size + SubtreeItems(nodes[k].m_left) + SubtreeItems(nodes[k].m_right);
         }
     }
     
-    return 0;
+    Root() = nodes;
+    LMost() = Min(nodes);
+    RMost() = Max(nodes);
+    m_frozen = nodes;
+    m_totalItems = items.size();
 }
 
 template <uint32_t Capacity, typename Iter, typename Pred>
 void OrderedMultiSet<Capacity, Iter, Pred>::clear() noexcept {
-    Destroy(Root());
+    DestroyTree();
     resetHead();
     m_totalItems = 0;
+    m_compactFrom.reset();
+    m_compactAt.reset();
 }
 
 template <uint32_t Capacity, typename Iter, typename Pred>
@@ -0,0 +1,134 @@
+//
+//  PackedArena.h
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+// One block for the objects packed by MultiIndexTable::Freeze.
+// Open(count) makes the next @count allocations of one size come from the block one after another,
+// the block is released once Close is called and the last of them is deallocated.
+// Single threaded, the table calls it under the write lock.
+class PackedArena {
+    char* m_begin{nullptr};
+    char* m_next{nullptr};
+    char* m_end{nullptr};
+    size_t m_size{0}; // size of the allocations from the block
+    size_t m_align{0};
+    size_t m_count{0}; // allocations the block is sized for
+    size_t m_live{0}; // allocations in the block
+    bool m_open{false};
+
+    PackedArena(const PackedArena&) = delete;
+    PackedArena& operator=(const PackedArena&) = delete;
+
+    void Release() noexcept {
+        if (m_begin != nullptr) {
+            ::operator delete(m_begin, std::align_val_t(m_align));
+            m_begin = m_next = m_end = nullptr;
+        }
+    }
+
+public:
+    PackedArena() noexcept = default;
+    ~PackedArena() noexcept { Release(); }
+
+    // false if the previous block still has allocations
+    bool Open(size_t count) noexcept {
+        if (m_begin != nullptr) {
+            return false;
+        }
+
+        m_count = count;
+        m_open = count != 0;
+        return true;
+    }
+
+    void Close() noexcept {
+        m_open = false;
+        if (m_live == 0) {
+            Release();
+        }
+    }
+
+    // nullptr if the allocation doesn't go to the block
+    void* Allocate(size_t size, size_t align) noexcept {
+        if (!m_open) {
+            return nullptr;
+        }
+
+        if (m_begin == nullptr) { // the first allocation sizes the block
+            m_begin = static_cast<char*>(::operator new(size * m_count, std::align_val_t(align), std::nothrow));
+            if (m_begin == nullptr) {
+                m_open = false;
+                return nullptr;
+            }
+
+            m_next = m_begin;
+            m_end = m_begin + size * m_count;
+            m_size = size;
+            m_align = align;
+        }
+
+        if (size != m_size || m_next == m_end) {
+            return nullptr;
+        }
+
+        void* ptr = m_next;
+        m_next += size;
+        ++m_live;
+        return ptr;
+    }
+
+    // false if @ptr is not from the block
+    bool Deallocate(void* ptr) noexcept {
+        if (m_begin == nullptr || ptr < m_begin || ptr >= m_end) {
+            return false;
+        }
+
+        if (--m_live == 0 && !m_open) {
+            Release();
+        }
+        return true;
+    }
+};
+
+// Storage allocator, takes the memory from the arena while it is open, from the heap otherwise
+template<typename U>
+class PackedAllocator {
+    template<typename> friend class PackedAllocator;
+    PackedArena* m_arena{nullptr};
+
+public:
+    using value_type = U;
+
+    explicit PackedAllocator(PackedArena* arena = nullptr) noexcept : m_arena(arena) {}
+    template<typename V>
+    PackedAllocator(const PackedAllocator<V>& src) noexcept : m_arena(src.m_arena) {}
+
+    U* allocate(size_t n) {
+        if (m_arena != nullptr) {
+            if (void* ptr = m_arena->Allocate(sizeof(U) * n, alignof(U))) {
+                return static_cast<U*>(ptr);
+            }
+        }
+        return std::allocator<U>().allocate(n);
+    }
+
+    void deallocate(U* ptr, size_t n) noexcept {
+        if (m_arena == nullptr || !m_arena->Deallocate(ptr)) {
+            std::allocator<U>().deallocate(ptr, n);
+        }
+    }
+
+    template<typename V>
+    bool operator==(const PackedAllocator<V>& right) const noexcept { return m_arena == right.m_arena; }
+    template<typename V>
+    bool operator!=(const PackedAllocator<V>& right) const noexcept { return m_arena != right.m_arena; }
+};
@@ -0,0 +1,289 @@
+//
+//  RadixMultiSet.h
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "Instrumentation.h"
+
+// Byte comparable key of the radix index, the byte order of the keys is the order of the objects.
+using RadixKey = std::string;
+
+// Appends the big endian integer, the sign bit of the signed ones is flipped,
+// so the keys of the same width compare as the integers.
+template<typename N>
+std::enable_if_t<std::is_integral<N>::value> RadixAppend(RadixKey& key, N value) noexcept {
+    using U = std::make_unsigned_t<N>;
+    U bits = static_cast<U>(value);
+    if constexpr (std::is_signed<N>::value) {
+        bits ^= U(1) << (sizeof(N) * 8 - 1);
+    }
+    for (size_t i = sizeof(N); i-- > 0;) {
+        key.push_back(char((bits >> (i * 8)) & 0xff));
+    }
+}
+
+// Appends the bytes as is, the last part of the composite keys
+inline void RadixAppend(RadixKey& key, std::string_view value) noexcept {
+    key.append(value.data(), value.size());
+}
+
+// Appends the bytes followed by the terminator, the middle parts of the composite keys:
+// 0x00 is escaped as 0x00 0xff and the terminator 0x00 0x00 sorts before any byte.
+inline void RadixAppendTerminated(RadixKey& key, std::string_view value) noexcept {
+    for (char c : value) {
+        key.push_back(c);
+        if (c == 0) {
+            key.push_back(char(0xff));
+        }
+    }
+    key.push_back(0);
+    key.push_back(0);
+}
+
+// Adaptive radix tree (ART) of the byte comparable keys with the objects of equal keys in one leaf.
+// Inner nodes grow and shrink through Node4, Node16, Node48 and Node256 by the number of children,
+// single child paths are compressed into the node prefix (the first kMaxPrefix bytes are kept,
+// the rest is read from a leaf). A key ending inside the tree is kept by the node where it ends.
+// The leaves are chained in the key order for the ordered iteration and range scans.
+// A lookup costs O(key length) regardless of the number of keys.
+template <typename Iter, typename Pred>
+class RadixMultiSet {
+    using Value = std::remove_reference_t<decltype(*std::declval<Iter>())>;
+    static constexpr size_t kMaxPrefix = 8;
+
+    struct Leaf {
+        Leaf* m_prev{nullptr}; // key order chain, closed by the head leaf
+        Leaf* m_next{nullptr};
+        RadixKey m_key;
+        std::vector<Iter> m_items; // equal keys by the object address, every object has a unique position
+    };
+
+    // inner node or leaf, the leaves are tagged by the lowest bit
+    using Child = void*;
+
+    enum NodeType : uint8_t {
+        kNode4 = 0,
+        kNode16,
+        kNode48,
+        kNode256
+    };
+
+    struct Node {
+        NodeType m_type;
+        uint16_t m_count{0}; // children
+        uint32_t m_prefixLength{0}; // compressed path length
+        uint8_t m_prefix[kMaxPrefix]; // first bytes of the compressed path
+        Leaf* m_leaf{nullptr}; // the key ending at this node, if any
+
+        explicit Node(NodeType type) noexcept : m_type(type) {}
+    };
+
+    // sorted keys
+    struct Node4 : Node {
+        uint8_t m_keys[4];
+        Child m_children[4];
+        Node4() noexcept : Node(kNode4) {}
+    };
+
+    struct Node16 : Node {
+        uint8_t m_keys[16];
+        Child m_children[16];
+        Node16() noexcept : Node(kNode16) {}
+    };
+
+    // m_index - child position + 1 by the key byte, 0 - no child
+    struct Node48 : Node {
+        uint8_t m_index[256];
+        Child m_children[48];
+        Node48() noexcept : Node(kNode48) { memset(m_index, 0, sizeof(m_index)); memset(m_children, 0, sizeof(m_children)); }
+    };
+
+    struct Node256 : Node {
+        Child m_children[256];
+        Node256() noexcept : Node(kNode256) { memset(m_children, 0, sizeof(m_children)); }
+    };
+
+    // not publicaly exposed, no need to follow std iterator interface
+    class iterator {
+        const Leaf* m_leaf{nullptr};
+        size_t m_offset{0};
+
+    public:
+        iterator(const Leaf* leaf, size_t offset) noexcept : m_leaf(leaf), m_offset(offset) {}
+
+        iterator& operator++() noexcept {
+            if (++m_offset >= m_leaf->m_items.size()) {
+                m_leaf = m_leaf->m_next;
+                m_offset = 0;
+            }
+            return *this;
+        }
+
+        iterator& operator--() noexcept {
+            if (m_offset == 0) {
+                m_leaf = m_leaf->m_prev;
+                m_offset = m_leaf->m_items.empty() ? 0 : m_leaf->m_items.size() - 1;
+            } else {
+                --m_offset;
+            }
+            return *this;
+        }
+
+        inline Iter& operator*() const noexcept {
+            return const_cast<Leaf*>(m_leaf)->m_items[m_offset];
+        }
+
+        inline size_t GetOffset() const noexcept { return m_offset; }
+        inline Leaf* GetLeafPtr() const noexcept { return const_cast<Leaf*>(m_leaf); }
+
+        inline bool operator==(const iterator& right) const noexcept {
+            return m_leaf == right.m_leaf && m_offset == right.m_offset;
+        }
+
+        inline bool operator!=(const iterator& right) const noexcept {
+            return !(*this == right);
+        }
+    };
+
+    static bool IsLeaf(Child child) noexcept { return (reinterpret_cast<uintptr_t>(child) & 1) != 0; }
+    static Leaf* AsLeaf(Child child) noexcept { return reinterpret_cast<Leaf*>(reinterpret_cast<uintptr_t>(child) & ~uintptr_t(1)); }
+    static Node* AsNode(Child child) noexcept { return static_cast<Node*>(child); }
+    static Child LeafChild(Leaf* leaf) noexcept { return reinterpret_cast<Child>(reinterpret_cast<uintptr_t>(leaf) | 1); }
+
+    // node children
+    static Child* FindChild(Node* node, uint8_t byte) noexcept;
+    // the first child with the key byte not less than @from, nullptr if none
+    static Child ChildFrom(const Node* node, unsigned from) noexcept;
+    static void AddChild(Child& ref, Node* node, uint8_t byte, Child child) noexcept;
+    static void RemoveChild(Child& ref, Node* node, uint8_t byte) noexcept;
+    // replaces the underfilled node by a smaller one, collapses the single child paths
+    static void Shrink(Child& ref) noexcept;
+    static void CopyHeader(Node* to, const Node* from) noexcept;
+    static void DeleteNode(Node* node) noexcept;
+    static void Destroy(Child child) noexcept;
+
+    // the smallest leaf of the subtree
+    static Leaf* Minimum(Child child) noexcept;
+    // byte @i of the compressed path of the node at @depth
+    static uint8_t PrefixAt(const Node* node, size_t depth, size_t i) noexcept;
+    // number of the compressed path bytes matching @key from @depth
+    static size_t PrefixMatch(const Node* node, const RadixKey& key, size_t depth) noexcept;
+    // optimistic match, only the kept bytes are compared, the leaf key compare validates the path
+    static bool PrefixFits(const Node* node, const RadixKey& key, size_t depth) noexcept;
+
+    // the leaf of @key, nullptr if none
+    Leaf* Find(const RadixKey& key) const noexcept;
+    // the first leaf with the key not less than @key in the subtree, nullptr if none
+    static Leaf* LowerBound(Child child, const RadixKey& key, size_t depth) noexcept;
+    Leaf* LowerBoundLeaf(const RadixKey& key) const noexcept;
+    // adds the leaf of a new key
+    static void InsertLeaf(Child& ref, Leaf* leaf, size_t depth) noexcept;
+    static void PlaceLeaf(Child& ref, Node* node, Leaf* leaf, size_t depth) noexcept;
+    // removes the leaf of @key, returns false if there is none
+    static bool RemoveLeaf(Child& ref, const RadixKey& key, size_t depth) noexcept;
+    // removes the empty leaf from the tree and the chain and deletes it
+    void DropLeaf(Leaf* leaf) noexcept;
+
+    Leaf* Head() const noexcept { return const_cast<Leaf*>(&m_head); }
+    RadixKey Encode(const Value& object) const noexcept;
+
+private:
+    const Pred m_encoder; // key encoder
+    Child m_root{nullptr};
+    // m_head.m_next points to the smallest leaf, m_head.m_prev to the largest one
+    Leaf m_head;
+    size_t m_totalItems{0}; // keeps track of total number of items.
+    size_t m_leaves{0}; // distinct keys
+    std::optional<RadixKey> m_compactFrom; // resume key of the time sliced compaction
+#if defined(MULTIINDEX_INSTRUMENTATION)
+    mutable IndexEvents m_events;
+#endif
+
+    RadixMultiSet(const RadixMultiSet& src) noexcept = delete;
+    RadixMultiSet(RadixMultiSet&& src) noexcept = delete;
+
+protected:
+    explicit RadixMultiSet(TupleParams<Pred>&& params) noexcept;
+    ~RadixMultiSet() noexcept;
+
+    bool is_equal(const Value& first, const Value& second) const noexcept { return Encode(first) == Encode(second); }
+    bool is_less(const Value& first, const Value& second) const noexcept { return Encode(first) < Encode(second); }
+
+    // insert
+    bool insert(bool, const Iter& key) noexcept;
+
+    // erase
+    size_t erase(Iter key) noexcept;
+
+    // erases the items of [@first, @last) @doomed returns true for, the emptied leaves are dropped
+    template <typename F>
+    size_t erase_if(iterator first, iterator last, F&& doomed) noexcept;
+    template <typename F>
+    size_t erase_if(F&& doomed) noexcept { return erase_if(begin(), end(), std::forward<F>(doomed)); }
+
+    // nothing to preallocate, nodes are allocated on demand
+    void reserve(size_t) noexcept {}
+
+    size_t size() const noexcept { return m_totalItems; }
+#if defined(MULTIINDEX_INSTRUMENTATION)
+    IndexEvents& events() const noexcept { return m_events; }
+#endif
+
+    // trims the item arrays of up to @steps leaves to their sizes if they are filled less than @fill,
+    // returns true when the last leaf is reached, otherwise the next call resumes from where it stopped.
+    bool compact(size_t steps, float fill) noexcept;
+
+    // the nodes are sized by the number of children, there is no bucket capacity
+    void set_capacity(uint32_t) noexcept {}
+
+    // structure statistics, the leaves are reported as buckets
+    IndexStats stats(size_t reads, size_t writes) const noexcept;
+
+    // sorts @keys by the index order, batched inserts and erases visit the leaves in the key order
+    void sort_keys(std::vector<Iter>& keys) const noexcept;
+
+    // the radix tree has no separate read only layout, builds the empty set of @items
+    void freeze(std::vector<Iter>& items) noexcept;
+
+    std::pair<iterator, iterator> equal_range(const Value& key) const noexcept;
+
+    // find the first item by the key.
+    iterator find(const Value& key) const noexcept;
+
+    // the first item not less than the key
+    iterator lower_bound(const Value& key) const noexcept;
+
+    // the first item greater than the key
+    iterator upper_bound(const Value& key) const noexcept;
+
+    // the first item not before the position of @key at @object in the index order, @object may be gone
+    iterator lower_bound(const Value& key, const Value* object) const noexcept;
+
+    // the items with the keys starting with @prefix
+    std::pair<iterator, iterator> prefix_range(const RadixKey& prefix) const noexcept;
+
+    iterator begin() const noexcept { return iterator(m_head.m_next, 0); }
+
+    iterator end() const noexcept { return iterator(Head(), 0); }
+
+    // clear
+    void clear() noexcept;
+
+    // traverse
+    void traverse() const noexcept;
+};
+
+#include "RadixMultiSet.hpp"
@@ -0,0 +1,862 @@
+//
+//  RadixMultiSet.hpp
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+template <typename Iter, typename Pred>
+RadixMultiSet<Iter, Pred>::RadixMultiSet(TupleParams<Pred>&& params) noexcept :
+    m_encoder(std::move(std::get<2>(params))) {
+    m_head.m_prev = m_head.m_next = &m_head;
+}
+
+template <typename Iter, typename Pred>
+RadixMultiSet<Iter, Pred>::~RadixMultiSet() noexcept {
+    Destroy(m_root);
+}
+
+template <typename Iter, typename Pred>
+RadixKey RadixMultiSet<Iter, Pred>::Encode(const Value& object) const noexcept {
+    RadixKey key;
+    m_encoder(object, key);
+    return key;
+}
+
+template <typename Iter, typename Pred>
+typename RadixMultiSet<Iter, Pred>::Child* RadixMultiSet<Iter, Pred>::FindChild(Node* node, uint8_t byte) noexcept {
+    switch (node->m_type) {
+        case kNode4: {
+            Node4* n = static_cast<Node4*>(node);
+            for (size_t i = 0; i < n->m_count; ++i) {
+                if (n->m_keys[i] == byte) {
+                    return &n->m_children[i];
+                }
+            }
+            return nullptr;
+        }
+        case kNode16: {
+            Node16* n = static_cast<Node16*>(node);
+            const uint8_t* pos = std::lower_bound(n->m_keys, n->m_keys + n->m_count, byte);
+            return pos != n->m_keys + n->m_count && *pos == byte ? &n->m_children[pos - n->m_keys] : nullptr;
+        }
+        case kNode48: {
+            Node48* n = static_cast<Node48*>(node);
+            return n->m_index[byte] != 0 ? &n->m_children[n->m_index[byte] - 1] : nullptr;
+        }
+        case kNode256: {
+            Node256* n = static_cast<Node256*>(node);
+            return n->m_children[byte] != nullptr ? &n->m_children[byte] : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+template <typename Iter, typename Pred>
+typename RadixMultiSet<Iter, Pred>::Child RadixMultiSet<Iter, Pred>::ChildFrom(const Node* node, unsigned from) noexcept {
+    switch (node->m_type) {
+        case kNode4: {
+            const Node4* n = static_cast<const Node4*>(node);
+            for (size_t i = 0; i < n->m_count; ++i) {
+                if (n->m_keys[i] >= from) {
+                    return n->m_children[i];
+                }
+            }
+            return nullptr;
+        }
+        case kNode16: {
+            const Node16* n = static_cast<const Node16*>(node);
+            for (size_t i = 0; i < n->m_count; ++i) {
+                if (n->m_keys[i] >= from) {
+                    return n->m_children[i];
+                }
+            }
+            return nullptr;
+        }
+        case kNode48: {
+            const Node48* n = static_cast<const Node48*>(node);
+            for (; from < 256; ++from) {
+                if (n->m_index[from] != 0) {
+                    return n->m_children[n->m_index[from] - 1];
+                }
+            }
+            return nullptr;
+        }
+        case kNode256: {
+            const Node256* n = static_cast<const Node256*>(node);
+            for (; from < 256; ++from) {
+                if (n->m_children[from] != nullptr) {
+                    return n->m_children[from];
+                }
+            }
+            return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+template <typename Iter, typename Pred>
+void RadixMultiSet<Iter, Pred>::CopyHeader(Node* to, const Node* from) noexcept {
+    to->m_count = from->m_count;
+    to->m_prefixLength = from->m_prefixLength;
+    memcpy(to->m_prefix, from->m_prefix, kMaxPrefix);
+    to->m_leaf = from->m_leaf;
+}
+
+template <typename Iter, typename Pred>
+void RadixMultiSet<Iter, Pred>::AddChild(Child& ref, Node* node, uint8_t byte, Child child) noexcept {
+    switch (node->m_type) {
+        case kNode4: {
+            Node4* n = static_cast<Node4*>(node);
+            if (n->m_count < 4) {
+                const size_t pos = std::lower_bound(n->m_keys, n->m_keys + n->m_count, byte) - n->m_keys;
+                memmove(n->m_keys + pos + 1, n->m_keys + pos, n->m_count - pos);
+                memmove(n->m_children + pos + 1, n->m_children + pos, sizeof(Child) * (n->m_count - pos));
+                n->m_keys[pos] = byte;
+                n->m_children[pos] = child;
+                ++n->m_count;
+                return;
+            }
+
+            Node16* grown = new Node16;
+            CopyHeader(grown, n);
+            memcpy(grown->m_keys, n->m_keys, 4);
+            memcpy(grown->m_children, n->m_children, sizeof(Child) * 4);
+            ref = grown;
+            delete n;
+            AddChild(ref, grown, byte, child);
+            return;
+        }
+        case kNode16: {
+            Node16* n = static_cast<Node16*>(node);
+            if (n->m_count < 16) {
+                const size_t pos = std::lower_bound(n->m_keys, n->m_keys + n->m_count, byte) - n->m_keys;
+                memmove(n->m_keys + pos + 1, n->m_keys + pos, n->m_count - pos);
+                memmove(n->m_children + pos + 1, n->m_children + pos, sizeof(Child) * (n->m_count - pos));
+                n->m_keys[pos] = byte;
+                n->m_children[pos] = child;
+                ++n->m_count;
+                return;
+            }
+
+            Node48* grown = new Node48;
+            CopyHeader(grown, n);
+            for (size_t i = 0; i < 16; ++i) {
+                grown->m_index[n->m_keys[i]] = uint8_t(i + 1);
+                grown->m_children[i] = n->m_children[i];
+            }
+            ref = grown;
+            delete n;
+            AddChild(ref, grown, byte, child);
+            return;
+        }
+        case kNode48: {
+            Node48* n = static_cast<Node48*>(node);
+            if (n->m_count < 48) {
+                size_t pos = 0;
+                while (n->m_children[pos] != nullptr) { // the removed children leave holes
+                    ++pos;
+                }
+                n->m_children[pos] = child;
+                n->m_index[byte] = uint8_t(pos + 1);
+                ++n->m_count;
+                return;
+            }
+
+            Node256* grown = new Node256;
+            CopyHeader(grown, n);
+            for (size_t b = 0; b < 256; ++b) {
+                if (n->m_index[b] != 0) {
+                    grown->m_children[b] = n->m_children[n->m_index[b] - 1];
+                }
+            }
+            ref = grown;
+            delete n;
+            AddChild(ref, grown, byte, child);
+            return;
+        }
+        case kNode256: {
+            Node256* n = static_cast<Node256*>(node);
+            n->m_children[byte] = child;
+            ++n->m_count;
+            return;
+        }
+    }
+}
+
+template <typename Iter, typename Pred>
+void RadixMultiSet<Iter, Pred>::RemoveChild(Child& ref, Node* node, uint8_t byte) noexcept {
+    switch (node->m_type) {
+        case kNode4: {
+            Node4* n = static_cast<Node4*>(node);
+            const size_t pos = std::find(n->m_keys, n->m_keys + n->m_count, byte) - n->m_keys;
+            memmove(n->m_keys + pos, n->m_keys + pos + 1, n->m_count - pos - 1);
+            memmove(n->m_children + pos, n->m_children + pos + 1, sizeof(Child) * (n->m_count - pos - 1));
+            --n->m_count;
+            break;
+        }
+        case kNode16: {
+            Node16* n = static_cast<Node16*>(node);
+            const size_t pos = std::lower_bound(n->m_keys, n->m_keys + n->m_count, byte) - n->m_keys;
+            memmove(n->m_keys + pos, n->m_keys + pos + 1, n->m_count - pos - 1);
+            memmove(n->m_children + pos, n->m_children + pos + 1, sizeof(Child) * (n->m_count - pos - 1));
+            --n->m_count;
+            break;
+        }
+        case kNode48: {
+            Node48* n = static_cast<Node48*>(node);
+            n->m_children[n->m_index[byte] - 1] = nullptr;
+            n->m_index[byte] = 0;
+            --n->m_count;
+            break;
+        }
+        case kNode256: {
+            Node256* n = static_cast<Node256*>(node);
+            n->m_children[byte] = nullptr;
+            --n->m_count;
+            break;
+        }
+    }
+
+    Shrink(ref);
+}
+
+template <typename Iter, typename Pred>
+void RadixMultiSet<Iter, Pred>::Shrink(Child& ref) noexcept {
+    // the smaller nodes take over below the growth points, a node doesn't flip on a single insert and erase
+    Node* node = AsNode(ref);
+    switch (node->m_type) {
+        case kNode4: {
+            Node4* n = static_cast<Node4*>(node);
+            if (n->m_count == 0) { // the key ending here is the only one left
+                ref = n->m_leaf != nullptr ? LeafChild(n->m_leaf) : nullptr;
+                delete n;
+            } else if (n->m_count == 1 && n->m_leaf == nullptr) { // single child path, collapse
+                Child only = n->m_children[0];
+                if (!IsLeaf(only)) {
+                    // the child path becomes the node path, its key byte and the child path
+                    Node* child = AsNode(only);
+                    uint8_t prefix[kMaxPrefix];
+                    size_t length = std::min<size_t>(n->m_prefixLength, kMaxPrefix);
+                    memcpy(prefix, n->m_prefix, length);
+                    if (length < kMaxPrefix) {
+                        prefix[length++] = n->m_keys[0];
+                    }
+                    const size_t tail = std::min<size_t>(child->m_prefixLength, kMaxPrefix - length);
+                    memcpy(prefix + length, child->m_prefix, tail);
+                    memcpy(child->m_prefix, prefix, length + tail);
+                    child->m_prefixLength += n->m_prefixLength + 1;
+                }
+                ref = only;
+                delete n;
+            }
+            return;
+        }
+        case kNode16: {
+            Node16* n = static_cast<Node16*>(node);
+            if (n->m_count <= 3) {
+                Node4* shrunk = new Node4;
+                CopyHeader(shrunk, n);
+                memcpy(shrunk->m_keys, n->m_keys, n->m_count);
+                memcpy(shrunk->m_children, n->m_children, sizeof(Child) * n->m_count);
+                ref = shrunk;
+                delete n;
+                Shrink(ref);
+            }
+            return;
+        }
+        case kNode48: {
+            Node48* n = static_cast<Node48*>(node);
+            if (n->m_count <= 12) {
+                Node16* shrunk = new Node16;
+                CopyHeader(shrunk, n);
+                size_t pos = 0;
+                for (size_t b = 0; b < 256; ++b) {
+                    if (n->m_index[b] != 0) {
+                        shrunk->m_keys[pos] = uint8_t(b);
+                        shrunk->m_children[pos++] = n->m_children[n->m_index[b] - 1];
+                    }
+                }
+                ref = shrunk;
+                delete n;
+            }
+            return;
+        }
+        case kNode256: {
+            Node256* n = static_cast<Node256*>(node);
+            if (n->m_count <= 37) {
+                Node48* shrunk = new Node48;
+                CopyHeader(shrunk, n);
+                size_t pos = 0;
+                for (size_t b = 0; b < 256; ++b) {
+                    if (n->m_children[b] != nullptr) {
+                        shrunk->m_index[b] = uint8_t(pos + 1);
+                        shrunk->m_children[pos++] = n->m_children[b];
+                    }
+                }
+                ref = shrunk;
+                delete n;
+            }
+            return;
+        }
+    }
+}
+
+template <typename Iter, typename Pred>
+void RadixMultiSet<Iter, Pred>::DeleteNode(Node* node) noexcept {
+    // no virtual destructor, the type tag selects the node
+    switch (node->m_type) {
+        case kNode4: delete static_cast<Node4*>(node); break;
+        case kNode16: delete static_cast<Node16*>(node); break;
+        case kNode48: delete static_cast<Node48*>(node); break;
+        case kNode256: delete static_cast<Node256*>(node); break;
+    }
+}
+
+template <typename Iter, typename Pred>
+void RadixMultiSet<Iter, Pred>::Destroy(Child child) noexcept {
+    if (child == nullptr) {
+        return;
+    }
+
+    if (IsLeaf(child)) {
+        delete AsLeaf(child);
+        return;
+    }
+
+    Node* node = AsNode(child);
+    delete node->m_leaf;
+    switch (node->m_type) {
+        case kNode4: {
+            Node4* n = static_cast<Node4*>(node);
+            for (size_t i = 0; i < n->m_count; ++i) {
+                Destroy(n->m_children[i]);
+            }
+            break;
+        }
+        case kNode16: {
+            Node16* n = static_cast<Node16*>(node);
+            for (size_t i = 0; i < n->m_count; ++i) {
+                Destroy(n->m_children[i]);
+            }
+            break;
+        }
+        case kNode48: {
+            Node48* n = static_cast<Node48*>(node);
+            for (Child next : n->m_children) {
+                Destroy(next);
+            }
+            break;
+        }
+        case kNode256: {
+            Node256* n = static_cast<Node256*>(node);
+            for (Child next : n->m_children) {
+                Destroy(next);
+            }
+            break;
+        }
+    }
+    DeleteNode(node);
+}
+
+template <typename Iter, typename Pred>
+typename RadixMultiSet<Iter, Pred>::Leaf* RadixMultiSet<Iter, Pred>::Minimum(Child child) noexcept {
+    while (child != nullptr) {
+        if (IsLeaf(child)) {
+            return AsLeaf(child);
+        }
+
+        const Node* node = AsNode(child);
+        if (node->m_leaf != nullptr) { // a key ending here is less than the ones below
+            return node->m_leaf;
+        }
+        child = ChildFrom(node, 0);
+    }
+    return nullptr;
+}
+
+template <typename Iter, typename Pred>
+uint8_t RadixMultiSet<Iter, Pred>::PrefixAt(const Node* node, size_t depth, size_t i) noexcept {
+    return i < kMaxPrefix ? node->m_prefix[i] : uint8_t(Minimum(const_cast<Node*>(node))->m_key[depth + i]);
+}
+
+template <typename Iter, typename Pred>
+size_t RadixMultiSet<Iter, Pred>::PrefixMatch(const Node* node, const RadixKey& key, size_t depth) noexcept {
+    const size_t limit = std::min<size_t>(node->m_prefixLength, key.size() - depth);
+    const Leaf* min = nullptr;
+    for (size_t i = 0; i < limit; ++i) {
+        uint8_t byte;
+        if (i < kMaxPrefix) {
+            byte = node->m_prefix[i];
+        } else {
+            if (min == nullptr) {
+                min = Minimum(const_cast<Node*>(node));
+            }
+            byte = uint8_t(min->m_key[depth + i]);
+        }
+        if (uint8_t(key[depth + i]) != byte) {
+            return i;
+        }
+    }
+    return limit;
+}
+
+template <typename Iter, typename Pred>
+bool RadixMultiSet<Iter, Pred>::PrefixFits(const Node* node, const RadixKey& key, size_t depth) noexcept {
+    if (depth + node->m_prefixLength > key.size()) {
+        return false;
+    }
+
+    const size_t kept = std::min<size_t>(node->m_prefixLength, kMaxPrefix);
+    return memcmp(node->m_prefix, key.data() + depth, kept) == 0;
+}
+
+template <typename Iter, typename Pred>
+typename RadixMultiSet<Iter, Pred>::Leaf* RadixMultiSet<Iter, Pred>::Find(const RadixKey& key) const noexcept {
+    Child child = m_root;
+    size_t depth = 0;
+    while (child != nullptr) {
+        if (IsLeaf(child)) {
+            Leaf* leaf = AsLeaf(child);
+            return leaf->m_key == key ? leaf : nullptr;
+        }
+
+        Node* node = AsNode(child);
+        if (!PrefixFits(node, key, depth)) {
+            return nullptr;
+        }
+
+        depth += node->m_prefixLength;
+        if (depth == key.size()) {
+            return node->m_leaf != nullptr && node->m_leaf->m_key == key ? node->m_leaf : nullptr;
+        }
+
+        Child* next = FindChild(node, uint8_t(key[depth]));
+        if (next == nullptr) {
+            return nullptr;
+        }
+        child = *next;
+        ++depth;
+    }
+    return nullptr;
+}
+
+template <typename Iter, typename Pred>
+typename RadixMultiSet<Iter, Pred>::Leaf* RadixMultiSet<Iter, Pred>::LowerBound(Child child, const RadixKey& key, size_t depth) noexcept {
+    // the keys of the subtree share the first @depth bytes of @key
+    if (child == nullptr) {
+        return nullptr;
+    }
+
+    if (IsLeaf(child)) {
+        Leaf* leaf = AsLeaf(child);
+        return leaf->m_key.compare(key) >= 0 ? leaf : nullptr;
+    }
+
+    Node* node = AsNode(child);
+    if (node->m_prefixLength != 0) {
+        const size_t match = PrefixMatch(node, key, depth);
+        if (match < node->m_prefixLength) {
+            // the whole subtree is either greater or less than the key
+            if (depth + match == key.size() || uint8_t(key[depth + match]) < PrefixAt(node, depth, match)) {
+                return Minimum(child);
+            }
+            return nullptr;
+        }
+        depth += node->m_prefixLength;
+    }
+
+    if (depth == key.size()) { // the key ends here, nothing below is less
+        return Minimum(child);
+    }
+
+    // the key ending here, if any, is a prefix of the key and less than it
+    const uint8_t byte = uint8_t(key[depth]);
+    if (Child* next = FindChild(node, byte)) {
+        if (Leaf* leaf = LowerBound(*next, key, depth + 1)) {
+            return leaf;
+        }
+    }
+
+    return Minimum(ChildFrom(node, unsigned(byte) + 1));
+}
+
+template <typename Iter, typename Pred>
+typename RadixMultiSet<Iter, Pred>::Leaf* RadixMultiSet<Iter, Pred>::LowerBoundLeaf(const RadixKey& key) const noexcept {
+    Leaf* leaf = LowerBound(m_root, key, 0);
+    return leaf != nullptr ? leaf : Head();
+}
+
+template <typename Iter, typename Pred>
+void RadixMultiSet<Iter, Pred>::PlaceLeaf(Child& ref, Node* node, Leaf* leaf, size_t depth) noexcept {
+    if (leaf->m_key.size() == depth) {
+        node->m_leaf = leaf;
+    } else {
+        AddChild(ref, node, uint8_t(leaf->m_key[depth]), LeafChild(leaf));
+    }
+}
+
+template <typename Iter, typename Pred>
+void RadixMultiSet<Iter, Pred>::InsertLeaf(Child& ref, Leaf* leaf, size_t depth) noexcept {
+    // - Cases:
+    // 1. Empty slot - the leaf takes it
+    // 2. Another leaf - a new node with the common bytes as the path takes both
+    // 3. The node path differs from the key - a new node splits the path
+    // 4. The node path matches - the key ends here or descends by its next byte
+    const RadixKey& key = leaf->m_key;
+    if (ref == nullptr) {
+        ref = LeafChild(leaf);
+        return;
+    }
+
+    if (IsLeaf(ref)) {
+        Leaf* other = AsLeaf(ref);
+        const size_t limit = std::min(key.size(), other->m_key.size());
+        size_t common = depth;
+        while (common < limit && key[common] == other->m_key[common]) {
+            ++common;
+        }
+
+        Node4* node = new Node4;
+        node->m_prefixLength = uint32_t(common - depth);
+        memcpy(node->m_prefix, key.data() + depth, std::min<size_t>(node->m_prefixLength, kMaxPrefix));
+        ref = node;
+        PlaceLeaf(ref, node, other, common);
+        PlaceLeaf(ref, node, leaf, common);
+        return;
+    }
+
+    Node* node = AsNode(ref);
+    if (node->m_prefixLength != 0) {
+        const size_t match = PrefixMatch(node, key, depth);
+        if (match < node->m_prefixLength) {
+            Node4* parent = new Node4;
+            parent->m_prefixLength = uint32_t(match);
+            memcpy(parent->m_prefix, key.data() + depth, std::min<size_t>(match, kMaxPrefix));
+
+            // the node keeps the path after the byte it hangs by
+            const uint8_t byte = PrefixAt(node, depth, match);
+            if (node->m_prefixLength > kMaxPrefix) {
+                const Leaf* min = Minimum(node);
+                node->m_prefixLength -= uint32_t(match + 1);
+                memcpy(node->m_prefix, min->m_key.data() + depth + match + 1, std::min<size_t>(node->m_prefixLength, kMaxPrefix));
+            } else {
+                node->m_prefixLength -= uint32_t(match + 1);
+                memmove(node->m_prefix, node->m_prefix + match + 1, node->m_prefixLength);
+            }
+
+            ref = parent;
+            AddChild(ref, parent, byte, node);
+            PlaceLeaf(ref, parent, leaf, depth + match);
+            return;
+        }
+        depth += node->m_prefixLength;
+    }
+
+    if (depth == key.size()) {
+        node->m_leaf = leaf;
+        return;
+    }
+
+    if (Child* next = FindChild(node, uint8_t(key[depth]))) {
+        InsertLeaf(*next, leaf, depth + 1);
+    } else {
+        AddChild(ref, node, uint8_t(key[depth]), LeafChild(leaf));
+    }
+}
+
+template <typename Iter, typename Pred>
+bool RadixMultiSet<Iter, Pred>::RemoveLeaf(Child& ref, const RadixKey& key, size_t depth) noexcept {
+    if (ref == nullptr) {
+        return false;
+    }
+
+    if (IsLeaf(ref)) {
+        if (AsLeaf(ref)->m_key != key) {
+            return false;
+        }
+        ref = nullptr;
+        return true;
+    }
+
+    Node* node = AsNode(ref);
+    if (!PrefixFits(node, key, depth)) {
+        return false;
+    }
+
+    depth += node->m_prefixLength;
+    if (depth == key.size()) {
+        if (node->m_leaf == nullptr || node->m_leaf->m_key != key) {
+            return false;
+        }
+        node->m_leaf = nullptr;
+        Shrink(ref);
+        return true;
+    }
+
+    const uint8_t byte = uint8_t(key[depth]);
+    Child* next = FindChild(node, byte);
+    if (next == nullptr) {
+        return false;
+    }
+
+    if (IsLeaf(*next)) {
+        if (AsLeaf(*next)->m_key != key) {
+            return false;
+        }
+        RemoveChild(ref, node, byte);
+        return true;
+    }
+
+    if (!RemoveLeaf(*next, key, depth + 1)) {
+        return false;
+    }
+
+    if (*next == nullptr) {
+        RemoveChild(ref, node, byte);
+    }
+    return true;
+}
+
+template <typename Iter, typename Pred>
+void RadixMultiSet<Iter, Pred>::DropLeaf(Leaf* leaf) noexcept {
+    RemoveLeaf(m_root, leaf->m_key, 0);
+    leaf->m_prev->m_next = leaf->m_next;
+    leaf->m_next->m_prev = leaf->m_prev;
+    delete leaf;
+    --m_leaves;
+}
+
+template <typename Iter, typename Pred>
+bool RadixMultiSet<Iter, Pred>::insert(bool, const Iter& key) noexcept {
+    RadixKey encoded = Encode(*key);
+    if (Leaf* leaf = Find(encoded)) { // equal keys share the leaf
+        const Value* object = &*key;
+        auto at = std::upper_bound(leaf->m_items.begin(), leaf->m_items.end(), object,
+                                   [](const Value* first, const Iter& second) -> bool { return first < &*second; });
+        leaf->m_items.insert(at, key);
+        ++m_totalItems;
+        return true;
+    }
+
+    Leaf* next = LowerBoundLeaf(encoded);
+    Leaf* leaf = new (std::nothrow) Leaf;
+    if (leaf == nullptr) {
+        return false;
+    }
+
+    leaf->m_key = std::move(encoded);
+    leaf->m_items.push_back(key);
+    InsertLeaf(m_root, leaf, 0);
+
+    // chain before the first greater key
+    leaf->m_next = next;
+    leaf->m_prev = next->m_prev;
+    next->m_prev->m_next = leaf;
+    next->m_prev = leaf;
+    ++m_leaves;
+    ++m_totalItems;
+    return true;
+}
+
+template <typename Iter, typename Pred>
+size_t RadixMultiSet<Iter, Pred>::erase(Iter key) noexcept {
+    Leaf* leaf = Find(Encode(*key));
+    if (leaf == nullptr) {
+        return 0;
+    }
+
+    auto it = std::find(leaf->m_items.begin(), leaf->m_items.end(), key);
+    if (it == leaf->m_items.end()) {
+        return 0;
+    }
+
+    leaf->m_items.erase(it);
+    --m_totalItems;
+    if (leaf->m_items.empty()) {
+        DropLeaf(leaf);
+    }
+    return 1;
+}
+
+template <typename Iter, typename Pred>
+template <typename F>
+size_t RadixMultiSet<Iter, Pred>::erase_if(iterator first, iterator last, F&& doomed) noexcept {
+    size_t erased = 0;
+    Leaf* leaf = first.GetLeafPtr();
+    size_t from = first.GetOffset();
+    while (leaf != Head()) {
+        const bool isLast = leaf == last.GetLeafPtr();
+        const size_t to = isLast ? last.GetOffset() : leaf->m_items.size();
+        Leaf* next = leaf->m_next; // stays valid when this one is dropped
+
+        size_t kept = from;
+        for (size_t i = from; i < to; ++i) {
+            if (!doomed(leaf->m_items[i])) {
+                leaf->m_items[kept++] = leaf->m_items[i];
+            }
+        }
+
+        if (kept != to) {
+            leaf->m_items.erase(leaf->m_items.begin() + kept, leaf->m_items.begin() + to);
+            erased += to - kept;
+            if (leaf->m_items.empty()) {
+                DropLeaf(leaf);
+            }
+        }
+
+        if (isLast) {
+            break;
+        }
+
+        leaf = next;
+        from = 0;
+    }
+
+    m_totalItems -= erased;
+    return erased;
+}
+
+template <typename Iter, typename Pred>
+bool RadixMultiSet<Iter, Pred>::compact(size_t steps, float fill) noexcept {
+    Leaf* leaf = m_compactFrom ? LowerBoundLeaf(*m_compactFrom) : m_head.m_next;
+    for (; leaf != Head() && steps != 0; --steps, leaf = leaf->m_next) {
+        if (leaf->m_items.size() < leaf->m_items.capacity() * fill) {
+            leaf->m_items.shrink_to_fit();
+        }
+    }
+
+    if (leaf != Head()) {
+        m_compactFrom = leaf->m_key;
+        return false;
+    }
+
+    m_compactFrom.reset();
+    return true;
+}
+
+template <typename Iter, typename Pred>
+IndexStats RadixMultiSet<Iter, Pred>::stats(size_t reads, size_t writes) const noexcept {
+    IndexStats stats;
+    stats.items = m_totalItems;
+    stats.buckets = m_leaves;
+    stats.reads = reads;
+    stats.writes = writes;
+    for (const Leaf* leaf = m_head.m_next; leaf != &m_head; leaf = leaf->m_next) {
+        stats.slots += leaf->m_items.capacity();
+    }
+    return stats;
+}
+
+template <typename Iter, typename Pred>
+void RadixMultiSet<Iter, Pred>::sort_keys(std::vector<Iter>& keys) const noexcept {
+    // encoded once, the leaves order equal keys by the address on insert
+    std::vector<std::pair<RadixKey, Iter>> encoded;
+    encoded.reserve(keys.size());
+    for (const Iter& key : keys) {
+        encoded.emplace_back(Encode(*key), key);
+    }
+
+    std::stable_sort(encoded.begin(), encoded.end(), [](const auto& first, const auto& second) -> bool { return first.first < second.first; });
+    for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = encoded[i].second;
+    }
+}
+
+template <typename Iter, typename Pred>
+void RadixMultiSet<Iter, Pred>::freeze(std::vector<Iter>& items) noexcept {
+    if (m_totalItems != 0) {
+        return;
+    }
+
+    sort_keys(items);
+    for (const Iter& item : items) {
+        insert(false, item);
+    }
+}
+
+template <typename Iter, typename Pred>
+std::pair<typename RadixMultiSet<Iter, Pred>::iterator, typename RadixMultiSet<Iter, Pred>::iterator>
+RadixMultiSet<Iter, Pred>::equal_range(const Value& key) const noexcept {
+    const RadixKey encoded = Encode(key);
+    if (const Leaf* leaf = Find(encoded)) {
+        return {iterator(leaf, 0), iterator(leaf->m_next, 0)};
+    }
+
+    const iterator it(LowerBoundLeaf(encoded), 0);
+    return {it, it};
+}
+
+template <typename Iter, typename Pred>
+typename RadixMultiSet<Iter, Pred>::iterator
+RadixMultiSet<Iter, Pred>::find(const Value& key) const noexcept {
+    const Leaf* leaf = Find(Encode(key));
+    return leaf != nullptr ? iterator(leaf, 0) : end();
+}
+
+template <typename Iter, typename Pred>
+typename RadixMultiSet<Iter, Pred>::iterator
+RadixMultiSet<Iter, Pred>::lower_bound(const Value& key) const noexcept {
+    return iterator(LowerBoundLeaf(Encode(key)), 0);
+}
+
+template <typename Iter, typename Pred>
+typename RadixMultiSet<Iter, Pred>::iterator
+RadixMultiSet<Iter, Pred>::upper_bound(const Value& key) const noexcept {
+    const RadixKey encoded = Encode(key);
+    const Leaf* leaf = LowerBoundLeaf(encoded);
+    if (leaf != &m_head && leaf->m_key == encoded) {
+        leaf = leaf->m_next;
+    }
+    return iterator(leaf, 0);
+}
+
+template <typename Iter, typename Pred>
+typename RadixMultiSet<Iter, Pred>::iterator
+RadixMultiSet<Iter, Pred>::lower_bound(const Value& key, const Value* object) const noexcept {
+    const RadixKey encoded = Encode(key);
+    const Leaf* leaf = LowerBoundLeaf(encoded);
+    if (leaf == &m_head || leaf->m_key != encoded) {
+        return iterator(leaf, 0);
+    }
+
+    const size_t offset = std::lower_bound(leaf->m_items.begin(), leaf->m_items.end(), object,
+                                           [](const Iter& first, const Value* second) -> bool { return &*first < second; }) - leaf->m_items.begin();
+    return offset != leaf->m_items.size() ? iterator(leaf, offset) : iterator(leaf->m_next, 0);
+}
+
+template <typename Iter, typename Pred>
+std::pair<typename RadixMultiSet<Iter, Pred>::iterator, typename RadixMultiSet<Iter, Pred>::iterator>
+RadixMultiSet<Iter, Pred>::prefix_range(const RadixKey& prefix) const noexcept {
+    // the keys with the prefix end before the next prefix of the same length
+    RadixKey next = prefix;
+    while (!next.empty() && uint8_t(next.back()) == 0xff) {
+        next.pop_back();
+    }
+
+    const Leaf* last = Head();
+    if (!next.empty()) {
+        next.back() = char(uint8_t(next.back()) + 1);
+        last = LowerBoundLeaf(next);
+    }
+    return {iterator(LowerBoundLeaf(prefix), 0), iterator(last, 0)};
+}
+
+template <typename Iter, typename Pred>
+void RadixMultiSet<Iter, Pred>::clear() noexcept {
+    Destroy(m_root);
+    m_root = nullptr;
+    m_head.m_prev = m_head.m_next = &m_head;
+    m_totalItems = 0;
+    m_leaves = 0;
+    m_compactFrom.reset();
+}
+
+template <typename Iter, typename Pred>
+void RadixMultiSet<Iter, Pred>::traverse() const noexcept {
+    // direct
+    for (auto bDirIt = begin(), eDirIt = end(); bDirIt != eDirIt; ++bDirIt) {
+        printf("Item(radix): %d\n", (*bDirIt)->i);
+    }
+    printf("_______________________\n");
+}
@@ -0,0 +1,116 @@
+//
+//  ResultCache.h
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+// Result cache counters, see MultiIndexTable::SetResultCache
+struct ResultCacheStats {
+    size_t hits{0};
+    size_t misses{0};
+    size_t entries{0}; // cache capacity
+};
+
+// Matches of the recent lookup keys of one index, validated by the index modification epoch.
+// Any change of the index bumps the epoch and so invalidates all entries at once,
+// the entries are replaced by CLOCK. The matches are kept as the storage iterators,
+// so the hits see the current objects and the table still checks the expiry.
+// Lookups run under the table read lock and take the cache mutex for the entry copy only,
+// Resize and Invalidate run under the table write lock.
+template<typename T, typename Iter>
+class ResultCache {
+public:
+    static constexpr size_t kMaxItems = 16; // the lookups with more matches are not cached
+    static constexpr size_t kMiss = size_t(-1);
+    using Items = std::array<Iter, kMaxItems>;
+
+private:
+    struct Entry {
+        std::optional<T> m_key;
+        uint64_t m_epoch{0};
+        size_t m_count{0};
+        bool m_referenced{false};
+        Items m_items;
+    };
+
+    mutable std::mutex m_mutex;
+    mutable std::vector<Entry> m_entries;
+    mutable size_t m_hand{0}; // CLOCK hand
+    uint64_t m_epoch{1}; // entries of the other epochs are stale
+    mutable std::atomic<size_t> m_hits{0};
+    mutable std::atomic<size_t> m_misses{0};
+
+public:
+    bool Enabled() const noexcept { return !m_entries.empty(); }
+
+    // drops the entries and the counters, 0 disables the cache
+    void Resize(size_t entries) noexcept {
+        m_entries.clear();
+        m_entries.resize(entries);
+        m_entries.shrink_to_fit();
+        m_hand = 0;
+        m_hits = 0;
+        m_misses = 0;
+    }
+
+    void Invalidate() noexcept { ++m_epoch; }
+
+    // copies the matches of @key into @items and returns their number, kMiss if the key is not cached.
+    // Type E should have: bool operator()(const T& first, const T& second), the index equality.
+    template<typename E>
+    size_t Find(const T& key, E&& equal, Items& items) const noexcept {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        for (auto& entry : m_entries) {
+            if (entry.m_epoch == m_epoch && equal(*entry.m_key, key)) {
+                entry.m_referenced = true;
+                std::copy(entry.m_items.begin(), entry.m_items.begin() + entry.m_count, items.begin());
+                m_hits.fetch_add(1, std::memory_order_relaxed);
+                return entry.m_count;
+            }
+        }
+
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        return kMiss;
+    }
+
+    // caches @count matches of @key, replaces a stale entry or the one not used since the last CLOCK pass
+    void Store(const T& key, const Items& items, size_t count) const noexcept {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        Entry* victim = nullptr;
+        while (victim == nullptr) {
+            Entry& entry = m_entries[m_hand];
+            m_hand = (m_hand + 1) % m_entries.size();
+            if (entry.m_epoch != m_epoch || !entry.m_referenced) {
+                victim = &entry;
+            } else {
+                entry.m_referenced = false;
+            }
+        }
+
+        victim->m_key = key;
+        victim->m_epoch = m_epoch;
+        victim->m_count = count;
+        victim->m_referenced = false;
+        std::copy(items.begin(), items.begin() + count, victim->m_items.begin());
+    }
+
+    ResultCacheStats Stats() const noexcept {
+        ResultCacheStats stats;
+        stats.hits = m_hits.load(std::memory_order_relaxed);
+        stats.misses = m_misses.load(std::memory_order_relaxed);
+        stats.entries = m_entries.size();
+        return stats;
+    }
+};
@@ -0,0 +1,122 @@
+//
+//  RoaringBitmap.h
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+// Compressed set of 32 bit integers (roaring bitmap).
+// The integers are grouped by the upper 16 bits into containers sorted by the key,
+// a container keeps the lower 16 bits as a sorted array up to kArrayMax of them (2 bytes per integer)
+// or as a bitset of 65536 bits (8KB) above. The bitset operations are plain word loops,
+// the compiler vectorizes them.
+class RoaringBitmap {
+    static constexpr uint32_t kArrayMax = 4096; // the array is smaller than the bitset up to it
+    static constexpr size_t kWords = 1024;
+
+    struct Container {
+        uint16_t m_key{0};
+        uint32_t m_cardinality{0};
+        std::vector<uint16_t> m_array; // sorted, empty for the bitset
+        std::vector<uint64_t> m_words; // kWords for the bitset, empty for the array
+
+        bool IsBitset() const noexcept { return !m_words.empty(); }
+        bool Add(uint16_t value) noexcept;
+        bool Remove(uint16_t value) noexcept;
+        bool Contains(uint16_t value) const noexcept;
+        uint16_t Minimum() const noexcept;
+        void ToBitset() noexcept;
+        void ToArray() noexcept;
+        // recounts the bitset and picks the smaller form
+        void Normalize() noexcept;
+        size_t Bytes() const noexcept;
+
+        void And(const Container& other) noexcept;
+        void Or(const Container& other) noexcept;
+        void AndNot(const Container& other) noexcept;
+    };
+
+    static uint32_t PopCount(uint64_t word) noexcept;
+    static uint32_t LowestBit(uint64_t word) noexcept;
+
+    // the container of @key, nullptr if none
+    Container* Find(uint16_t key) noexcept;
+    const Container* Find(uint16_t key) const noexcept;
+
+    std::vector<Container> m_containers; // by the key
+
+public:
+    // walks the integers in the increasing order
+    class iterator {
+        const RoaringBitmap* m_bitmap{nullptr};
+        size_t m_container{0};
+        uint32_t m_position{0}; // array index or bit index
+
+        // moves to the first integer from the current position
+        void Seek() noexcept;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = uint32_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const uint32_t*;
+        using reference = uint32_t;
+
+        iterator() noexcept = default;
+        iterator(const RoaringBitmap* bitmap, size_t container) noexcept;
+
+        iterator& operator++() noexcept {
+            ++m_position;
+            Seek();
+            return *this;
+        }
+
+        uint32_t operator*() const noexcept;
+
+        inline bool operator==(const iterator& right) const noexcept {
+            return m_bitmap == right.m_bitmap && m_container == right.m_container && m_position == right.m_position;
+        }
+
+        inline bool operator!=(const iterator& right) const noexcept {
+            return !(*this == right);
+        }
+    };
+
+    // returns false if the value is there already
+    bool Add(uint32_t value) noexcept;
+    // returns false if the value is not there
+    bool Remove(uint32_t value) noexcept;
+    bool Contains(uint32_t value) const noexcept;
+
+    bool Empty() const noexcept { return m_containers.empty(); }
+    size_t Cardinality() const noexcept;
+    // the smallest integer, the bitmap must not be empty
+    uint32_t Minimum() const noexcept;
+    // memory used by the containers
+    size_t Bytes() const noexcept;
+    // releases the unused capacity of the arrays
+    void Shrink() noexcept;
+    void Clear() noexcept { m_containers.clear(); }
+
+    iterator begin() const noexcept { return iterator(this, 0); }
+    iterator end() const noexcept { return iterator(this, m_containers.size()); }
+
+    // intersection, union and difference (the integers of this bitmap not in @other)
+    RoaringBitmap& operator&=(const RoaringBitmap& other) noexcept;
+    RoaringBitmap& operator|=(const RoaringBitmap& other) noexcept;
+    RoaringBitmap& operator-=(const RoaringBitmap& other) noexcept;
+
+    friend RoaringBitmap operator&(RoaringBitmap first, const RoaringBitmap& second) noexcept { return first &= second; }
+    friend RoaringBitmap operator|(RoaringBitmap first, const RoaringBitmap& second) noexcept { return first |= second; }
+    friend RoaringBitmap operator-(RoaringBitmap first, const RoaringBitmap& second) noexcept { return first -= second; }
+};
+
+#include "RoaringBitmap.hpp"
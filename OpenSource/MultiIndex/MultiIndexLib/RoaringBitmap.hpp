@@ -0,0 +1,388 @@
+//
+//  RoaringBitmap.hpp
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+/*static*/
+inline uint32_t RoaringBitmap::PopCount(uint64_t word) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    return uint32_t(__builtin_popcountll(word));
+#else
+    uint32_t count = 0;
+    for (; word != 0; word &= word - 1) {
+        ++count;
+    }
+    return count;
+#endif
+}
+
+/*static*/
+inline uint32_t RoaringBitmap::LowestBit(uint64_t word) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    return uint32_t(__builtin_ctzll(word));
+#else
+    uint32_t bit = 0;
+    while ((word & 1) == 0) {
+        word >>= 1;
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+inline bool RoaringBitmap::Container::Add(uint16_t value) noexcept {
+    if (IsBitset()) {
+        uint64_t& word = m_words[value >> 6];
+        const uint64_t bit = uint64_t(1) << (value & 63);
+        if ((word & bit) != 0) {
+            return false;
+        }
+        word |= bit;
+        ++m_cardinality;
+        return true;
+    }
+
+    auto it = std::lower_bound(m_array.begin(), m_array.end(), value);
+    if (it != m_array.end() && *it == value) {
+        return false;
+    }
+
+    if (m_array.size() == kArrayMax) {
+        ToBitset();
+        return Add(value);
+    }
+
+    m_array.insert(it, value);
+    ++m_cardinality;
+    return true;
+}
+
+inline bool RoaringBitmap::Container::Remove(uint16_t value) noexcept {
+    if (IsBitset()) {
+        uint64_t& word = m_words[value >> 6];
+        const uint64_t bit = uint64_t(1) << (value & 63);
+        if ((word & bit) == 0) {
+            return false;
+        }
+        word &= ~bit;
+        // half of the limit, the adds and removes around it don't convert back and forth
+        if (--m_cardinality <= kArrayMax / 2) {
+            ToArray();
+        }
+        return true;
+    }
+
+    auto it = std::lower_bound(m_array.begin(), m_array.end(), value);
+    if (it == m_array.end() || *it != value) {
+        return false;
+    }
+
+    m_array.erase(it);
+    --m_cardinality;
+    return true;
+}
+
+inline bool RoaringBitmap::Container::Contains(uint16_t value) const noexcept {
+    if (IsBitset()) {
+        return (m_words[value >> 6] & (uint64_t(1) << (value & 63))) != 0;
+    }
+    return std::binary_search(m_array.begin(), m_array.end(), value);
+}
+
+inline uint16_t RoaringBitmap::Container::Minimum() const noexcept {
+    if (IsBitset()) {
+        for (size_t i = 0; i < kWords; ++i) {
+            if (m_words[i] != 0) {
+                return uint16_t(i * 64 + LowestBit(m_words[i]));
+            }
+        }
+    }
+    return m_array.front();
+}
+
+inline void RoaringBitmap::Container::ToBitset() noexcept {
+    m_words.assign(kWords, 0);
+    for (uint16_t value : m_array) {
+        m_words[value >> 6] |= uint64_t(1) << (value & 63);
+    }
+    m_array.clear();
+    m_array.shrink_to_fit();
+}
+
+inline void RoaringBitmap::Container::ToArray() noexcept {
+    m_array.clear();
+    m_array.reserve(m_cardinality);
+    for (size_t i = 0; i < kWords; ++i) {
+        for (uint64_t word = m_words[i]; word != 0; word &= word - 1) {
+            m_array.push_back(uint16_t(i * 64 + LowestBit(word)));
+        }
+    }
+    m_words.clear();
+    m_words.shrink_to_fit();
+}
+
+inline void RoaringBitmap::Container::Normalize() noexcept {
+    if (IsBitset()) {
+        uint32_t cardinality = 0;
+        for (size_t i = 0; i < kWords; ++i) {
+            cardinality += PopCount(m_words[i]);
+        }
+        m_cardinality = cardinality;
+        if (m_cardinality <= kArrayMax) {
+            ToArray();
+        }
+    } else {
+        m_cardinality = uint32_t(m_array.size());
+        if (m_cardinality > kArrayMax) {
+            ToBitset();
+        }
+    }
+}
+
+inline size_t RoaringBitmap::Container::Bytes() const noexcept {
+    return sizeof(Container) + m_array.capacity() * sizeof(uint16_t) + m_words.capacity() * sizeof(uint64_t);
+}
+
+inline void RoaringBitmap::Container::And(const Container& other) noexcept {
+    if (IsBitset() && other.IsBitset()) {
+        for (size_t i = 0; i < kWords; ++i) {
+            m_words[i] &= other.m_words[i];
+        }
+    } else if (IsBitset()) { // the array values found in the bitset
+        std::vector<uint16_t> result;
+        result.reserve(other.m_array.size());
+        for (uint16_t value : other.m_array) {
+            if (Contains(value)) {
+                result.push_back(value);
+            }
+        }
+        m_words.clear();
+        m_words.shrink_to_fit();
+        m_array.swap(result);
+    } else if (other.IsBitset()) {
+        m_array.erase(std::remove_if(m_array.begin(), m_array.end(), [&other](uint16_t value) { return !other.Contains(value); }), m_array.end());
+    } else {
+        std::vector<uint16_t> result;
+        result.reserve(std::min(m_array.size(), other.m_array.size()));
+        std::set_intersection(m_array.begin(), m_array.end(), other.m_array.begin(), other.m_array.end(), std::back_inserter(result));
+        m_array.swap(result);
+    }
+    Normalize();
+}
+
+inline void RoaringBitmap::Container::Or(const Container& other) noexcept {
+    if (IsBitset() && other.IsBitset()) {
+        for (size_t i = 0; i < kWords; ++i) {
+            m_words[i] |= other.m_words[i];
+        }
+    } else if (IsBitset()) {
+        for (uint16_t value : other.m_array) {
+            m_words[value >> 6] |= uint64_t(1) << (value & 63);
+        }
+    } else if (other.IsBitset()) { // the array values go to a copy of the bitset
+        std::vector<uint16_t> values;
+        values.swap(m_array);
+        m_words = other.m_words;
+        for (uint16_t value : values) {
+            m_words[value >> 6] |= uint64_t(1) << (value & 63);
+        }
+    } else {
+        std::vector<uint16_t> result;
+        result.reserve(m_array.size() + other.m_array.size());
+        std::set_union(m_array.begin(), m_array.end(), other.m_array.begin(), other.m_array.end(), std::back_inserter(result));
+        m_array.swap(result);
+    }
+    Normalize();
+}
+
+inline void RoaringBitmap::Container::AndNot(const Container& other) noexcept {
+    if (IsBitset() && other.IsBitset()) {
+        for (size_t i = 0; i < kWords; ++i) {
+            m_words[i] &= ~other.m_words[i];
+        }
+    } else if (IsBitset()) {
+        for (uint16_t value : other.m_array) {
+            m_words[value >> 6] &= ~(uint64_t(1) << (value & 63));
+        }
+    } else if (other.IsBitset()) {
+        m_array.erase(std::remove_if(m_array.begin(), m_array.end(), [&other](uint16_t value) { return other.Contains(value); }), m_array.end());
+    } else {
+        std::vector<uint16_t> result;
+        result.reserve(m_array.size());
+        std::set_difference(m_array.begin(), m_array.end(), other.m_array.begin(), other.m_array.end(), std::back_inserter(result));
+        m_array.swap(result);
+    }
+    Normalize();
+}
+
+inline RoaringBitmap::iterator::iterator(const RoaringBitmap* bitmap, size_t container) noexcept :
+    m_bitmap(bitmap), m_container(container) {
+    Seek();
+}
+
+inline void RoaringBitmap::iterator::Seek() noexcept {
+    const auto& containers = m_bitmap->m_containers;
+    for (; m_container < containers.size(); ++m_container, m_position = 0) {
+        const Container& container = containers[m_container];
+        if (!container.IsBitset()) {
+            if (m_position < container.m_array.size()) {
+                return;
+            }
+            continue;
+        }
+
+        for (size_t i = m_position >> 6; i < kWords; ++i) {
+            uint64_t word = container.m_words[i];
+            if (i == (m_position >> 6)) {
+                word &= ~uint64_t(0) << (m_position & 63);
+            }
+
+            if (word != 0) {
+                m_position = uint32_t(i * 64 + LowestBit(word));
+                return;
+            }
+        }
+    }
+}
+
+inline uint32_t RoaringBitmap::iterator::operator*() const noexcept {
+    const Container& container = m_bitmap->m_containers[m_container];
+    const uint32_t low = container.IsBitset() ? m_position : container.m_array[m_position];
+    return (uint32_t(container.m_key) << 16) | low;
+}
+
+inline RoaringBitmap::Container* RoaringBitmap::Find(uint16_t key) noexcept {
+    auto it = std::lower_bound(m_containers.begin(), m_containers.end(), key,
+                               [](const Container& container, uint16_t value) -> bool { return container.m_key < value; });
+    return it != m_containers.end() && it->m_key == key ? &*it : nullptr;
+}
+
+inline const RoaringBitmap::Container* RoaringBitmap::Find(uint16_t key) const noexcept {
+    return const_cast<RoaringBitmap*>(this)->Find(key);
+}
+
+inline bool RoaringBitmap::Add(uint32_t value) noexcept {
+    const uint16_t key = uint16_t(value >> 16);
+    // the increasing values go to the last container
+    auto it = m_containers.end();
+    if (m_containers.empty() || m_containers.back().m_key < key) {
+        it = m_containers.emplace(m_containers.end());
+        it->m_key = key;
+    } else if (m_containers.back().m_key != key) {
+        it = std::lower_bound(m_containers.begin(), m_containers.end(), key,
+                              [](const Container& container, uint16_t other) -> bool { return container.m_key < other; });
+        if (it->m_key != key) {
+            it = m_containers.emplace(it);
+            it->m_key = key;
+        }
+    } else {
+        it = m_containers.end() - 1;
+    }
+
+    return it->Add(uint16_t(value & 0xffff));
+}
+
+inline bool RoaringBitmap::Remove(uint32_t value) noexcept {
+    Container* container = Find(uint16_t(value >> 16));
+    if (container == nullptr || !container->Remove(uint16_t(value & 0xffff))) {
+        return false;
+    }
+
+    if (container->m_cardinality == 0) {
+        m_containers.erase(m_containers.begin() + (container - m_containers.data()));
+    }
+    return true;
+}
+
+inline bool RoaringBitmap::Contains(uint32_t value) const noexcept {
+    const Container* container = Find(uint16_t(value >> 16));
+    return container != nullptr && container->Contains(uint16_t(value & 0xffff));
+}
+
+inline size_t RoaringBitmap::Cardinality() const noexcept {
+    size_t cardinality = 0;
+    for (const auto& container : m_containers) {
+        cardinality += container.m_cardinality;
+    }
+    return cardinality;
+}
+
+inline uint32_t RoaringBitmap::Minimum() const noexcept {
+    const Container& container = m_containers.front();
+    return (uint32_t(container.m_key) << 16) | container.Minimum();
+}
+
+inline size_t RoaringBitmap::Bytes() const noexcept {
+    size_t bytes = sizeof(RoaringBitmap) + (m_containers.capacity() - m_containers.size()) * sizeof(Container);
+    for (const auto& container : m_containers) {
+        bytes += container.Bytes();
+    }
+    return bytes;
+}
+
+inline void RoaringBitmap::Shrink() noexcept {
+    for (auto& container : m_containers) {
+        container.m_array.shrink_to_fit();
+    }
+    m_containers.shrink_to_fit();
+}
+
+inline RoaringBitmap& RoaringBitmap::operator&=(const RoaringBitmap& other) noexcept {
+    std::vector<Container> result;
+    for (size_t i = 0, j = 0; i < m_containers.size() && j < other.m_containers.size();) {
+        if (m_containers[i].m_key < other.m_containers[j].m_key) {
+            ++i;
+        } else if (other.m_containers[j].m_key < m_containers[i].m_key) {
+            ++j;
+        } else {
+            m_containers[i].And(other.m_containers[j++]);
+            if (m_containers[i].m_cardinality != 0) {
+                result.push_back(std::move(m_containers[i]));
+            }
+            ++i;
+        }
+    }
+    m_containers.swap(result);
+    return *this;
+}
+
+inline RoaringBitmap& RoaringBitmap::operator|=(const RoaringBitmap& other) noexcept {
+    std::vector<Container> result;
+    result.reserve(m_containers.size() + other.m_containers.size());
+    size_t i = 0;
+    size_t j = 0;
+    while (i < m_containers.size() || j < other.m_containers.size()) {
+        if (j == other.m_containers.size() || (i < m_containers.size() && m_containers[i].m_key < other.m_containers[j].m_key)) {
+            result.push_back(std::move(m_containers[i++]));
+        } else if (i == m_containers.size() || other.m_containers[j].m_key < m_containers[i].m_key) {
+            result.push_back(other.m_containers[j++]);
+        } else {
+            m_containers[i].Or(other.m_containers[j++]);
+            result.push_back(std::move(m_containers[i++]));
+        }
+    }
+    m_containers.swap(result);
+    return *this;
+}
+
+inline RoaringBitmap& RoaringBitmap::operator-=(const RoaringBitmap& other) noexcept {
+    std::vector<Container> result;
+    result.reserve(m_containers.size());
+    for (size_t i = 0, j = 0; i < m_containers.size(); ++i) {
+        while (j < other.m_containers.size() && other.m_containers[j].m_key < m_containers[i].m_key) {
+            ++j;
+        }
+
+        if (j < other.m_containers.size() && other.m_containers[j].m_key == m_containers[i].m_key) {
+            m_containers[i].AndNot(other.m_containers[j]);
+            if (m_containers[i].m_cardinality == 0) {
+                continue;
+            }
+        }
+        result.push_back(std::move(m_containers[i]));
+    }
+    m_containers.swap(result);
+    return *this;
+}
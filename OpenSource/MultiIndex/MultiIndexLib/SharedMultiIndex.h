@@ -0,0 +1,213 @@
+//
+//  SharedMultiIndex.h
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "MultiIndex.h"
+
+enum class SharedMode {
+    Create = 0, // writer process, creates the segment, a stale segment with the same name is replaced
+    Open // reader processes, map the existing segment read only
+};
+
+// Named shared memory mapping. The creator removes the name on destruction,
+// the processes which mapped the segment keep it until they unmap it.
+class SharedSegment {
+    std::string m_name;
+    void* m_address{nullptr};
+    size_t m_size{0};
+    bool m_owner{false};
+#if defined(_WIN32)
+    HANDLE m_mapping{nullptr};
+#endif
+
+    SharedSegment(const SharedSegment&) = delete;
+    SharedSegment& operator=(const SharedSegment&) = delete;
+
+public:
+    // @size is used by SharedMode::Create only, Open maps the whole segment
+    SharedSegment(const char* name, size_t size, SharedMode mode) noexcept;
+    ~SharedSegment() noexcept;
+
+    // nullptr if the segment can't be created or opened
+    void* Address() const noexcept { return m_address; }
+    size_t Size() const noexcept { return m_size; }
+};
+
+// Multi index table in a named shared memory segment - one writer process and many reader processes
+// share a single copy of the objects and the indices, i.e.
+// writer: SharedMultiIndexTable<Quote, ById, BySymbol> table("/quotes", SharedMode::Create, 1000000, ById(), BySymbol());
+// reader: SharedMultiIndexTable<Quote, ById, BySymbol> table("/quotes", SharedMode::Open, 0, ById(), BySymbol());
+// The objects and the index links are addressed by slot numbers instead of pointers,
+// so every process maps the segment at its own address. The capacity is fixed at creation.
+// Hashed predicates (UnOrderedTraits, HashedOrderedTraits) build chained hash indices,
+// ordered predicates build sorted slot arrays with O(n) insert, see Load for the bulk load.
+// Readers don't lock: the writer makes the segment sequence odd for the time of each mutation and
+// the readers repeat the lookups which overlapped one (seqlock). So T must be trivially copyable
+// and the predicates must tolerate the torn objects a repeated lookup may see.
+// Writes are serialized by a process local mutex and available to the creating process only.
+// A writer process killed in the middle of a mutation leaves the readers spinning, recreate the segment.
+template<typename T, typename... P>
+class SharedMultiIndexTable {
+    static_assert(std::is_trivially_copyable<T>::value, "Shared objects must be trivially copyable");
+    static_assert(((IndexKindOf<P>() == IndexKind::HashedOrdered || IndexKindOf<P>() == IndexKind::Ordered ||
+                    IndexKindOf<P>() == IndexKind::UnOrdered) && ...),
+                  "Predicate class must be derived from either OrderedTraits or UnOrderedTraits or HashedOrderedTraits");
+
+public:
+    using ObjectContainer = std::list<T>;
+
+private:
+    static constexpr uint32_t kNull = std::numeric_limits<uint32_t>::max();
+    static constexpr uint64_t kMagic = 0x4d756c7469496478; // "MultiIdx"
+
+    // beginning of the segment, the creator initializes it
+    struct Header {
+        uint64_t m_magic{0}; // kMagic, set once the segment is initialized
+        uint64_t m_layout{0}; // object size and index kinds, all processes must agree on them
+        uint64_t m_bytes{0}; // segment size in use
+        uint32_t m_capacity{0}; // object slots
+        uint32_t m_buckets{0}; // per hashed index
+        std::atomic<uint64_t> m_sequence{0}; // odd while the writer mutates the segment
+        uint32_t m_size{0}; // number of objects
+        uint32_t m_used{0}; // slots ever used
+        uint32_t m_free{kNull}; // chain of the deleted slots
+    };
+
+    struct Slot {
+        T m_object;
+        uint32_t m_next; // free chain
+    };
+
+    // byte offsets of the segment parts
+    struct Layout {
+        size_t m_slots{0};
+        std::array<size_t, sizeof...(P)> m_heads{}; // hashed index bucket heads, ordered index sorted slots
+        std::array<size_t, sizeof...(P)> m_links{}; // hashed index chains
+        size_t m_bytes{0};
+    };
+
+    std::tuple<P...> m_predicates;
+    SharedSegment m_segment;
+    const bool m_owner;
+    Header* m_header{nullptr}; // nullptr if the segment is not usable
+    Slot* m_slots{nullptr};
+    Layout m_layout;
+    std::mutex m_mutex; // writers of the creating process
+
+    SharedMultiIndexTable(const SharedMultiIndexTable&) = delete;
+    SharedMultiIndexTable& operator=(const SharedMultiIndexTable&) = delete;
+
+public:
+    // Constructor
+    // @capacity defines the maximum number of objects, used by SharedMode::Create only.
+    SharedMultiIndexTable(const char* name, SharedMode mode, size_t capacity, P&& ...predicates) noexcept;
+
+    // false if the segment can't be created, opened, or was created for other T or predicates
+    bool IsValid() const noexcept { return m_header != nullptr; }
+    // Insert the new object and update all indices, false if the table is full or opened read only.
+    bool Insert(T&& obj) noexcept;
+    // Bulk load - stores @objects and sorts the ordered indices once,
+    // returns the number of the loaded objects, less than the size of @objects if the table gets full.
+    size_t Load(ObjectContainer&& objects) noexcept;
+    // Update affected objects by index and update all indices
+    template<size_t I>
+    bool Update(const T& where, T&& what) noexcept;
+    // Delete affected objects by index and update all indices
+    template<size_t I>
+    size_t Delete(const T& where) noexcept;
+    // Search by index, finds the first object by index or not
+    // that matches @what.
+    template<size_t I>
+    std::optional<T> FindFirst(const T& what) const noexcept;
+    // Finds the set of objects that matches @what by index.
+    template<size_t I>
+    ObjectContainer FindAll(const T& what) const noexcept;
+    // Number of objects in the table.
+    size_t Size() const noexcept;
+    // delete all content from storage and indices.
+    void Clear() noexcept;
+
+private:
+    static uint64_t LayoutId() noexcept;
+    static Layout MakeLayout(size_t capacity) noexcept;
+
+    template<size_t I>
+    static constexpr bool IsHashed() noexcept {
+        return IndexKindOf<std::tuple_element_t<I, std::tuple<P...>>>() != IndexKind::Ordered;
+    }
+
+    uint32_t* Array(size_t offset) const noexcept {
+        return reinterpret_cast<uint32_t*>(static_cast<char*>(m_segment.Address()) + offset);
+    }
+
+    // a repeated lookup may see any slot number, its result is discarded anyway
+    const T& ObjectAt(uint32_t slot) const noexcept {
+        return m_slots[slot < m_header->m_capacity ? slot : 0].m_object;
+    }
+
+    template<size_t I>
+    size_t Bucket(const T& key) const noexcept;
+    template<size_t I>
+    bool Less(const T& first, const T& second) const noexcept;
+    template<size_t I>
+    bool Equal(const T& first, const T& second) const noexcept;
+
+    // calls @visitor(slot) for the slots matching @what by index I while it returns true
+    template<size_t I, typename F>
+    void Visit(const T& what, F&& visitor) const noexcept;
+
+    // index maintenance, the ordered indices take the number of objects before the change from the header.
+    // @append puts the slot at the end of the sorted slots, SortTail merges the appended ones.
+    template<size_t I>
+    void Link(uint32_t slot, bool append) noexcept;
+    template<size_t I>
+    void Unlink(uint32_t slot) noexcept;
+    template<size_t I>
+    void SortTail(uint32_t from) noexcept;
+    template<size_t... I>
+    void LinkAll(uint32_t slot, bool append, std::index_sequence<I...>) noexcept;
+    template<size_t... I>
+    void UnlinkAll(uint32_t slot, std::index_sequence<I...>) noexcept;
+    template<size_t... I>
+    void SortAll(uint32_t from, std::index_sequence<I...>) noexcept;
+
+    uint32_t Allocate() noexcept;
+    void Release(uint32_t slot) noexcept;
+
+    // seqlock, repeats @read until it doesn't overlap a write
+    template<typename F>
+    void Read(F&& read) const noexcept;
+    // runs @write under the writer mutex with the odd sequence
+    template<typename F>
+    auto Write(F&& write) noexcept;
+};
+
+#include "SharedMultiIndex.hpp"
@@ -0,0 +1,524 @@
+//
+//  SharedMultiIndex.hpp
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+//////////////////////////////
+inline SharedSegment::SharedSegment(const char* name, size_t size, SharedMode mode) noexcept :
+    m_name(name), m_owner(mode == SharedMode::Create) {
+#if defined(_WIN32)
+    if (m_owner) {
+        if (size == 0) {
+            return;
+        }
+
+        m_mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                       DWORD(uint64_t(size) >> 32), DWORD(size), m_name.c_str());
+        // the mapping of the other process can't be replaced
+        if (m_mapping != nullptr && GetLastError() != ERROR_ALREADY_EXISTS) {
+            m_address = MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+        }
+    } else {
+        m_mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, m_name.c_str());
+        if (m_mapping != nullptr) {
+            m_address = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+            MEMORY_BASIC_INFORMATION info;
+            if (m_address != nullptr && VirtualQuery(m_address, &info, sizeof(info)) != 0) {
+                size = info.RegionSize;
+            }
+        }
+    }
+
+    if (m_address != nullptr) {
+        m_size = size;
+    } else if (m_mapping != nullptr) {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+#else
+    // POSIX names start with a slash
+    if (m_name.empty() || m_name[0] != '/') {
+        m_name.insert(0, 1, '/');
+    }
+
+    if (m_owner) {
+        if (size == 0) {
+            return;
+        }
+
+        shm_unlink(m_name.c_str());
+        int fd = shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0) {
+            return;
+        }
+
+        if (ftruncate(fd, off_t(size)) == 0) {
+            void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (address != MAP_FAILED) {
+                m_address = address;
+                m_size = size;
+            }
+        }
+
+        close(fd);
+        if (m_address == nullptr) {
+            shm_unlink(m_name.c_str());
+        }
+    } else {
+        int fd = shm_open(m_name.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            return;
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* address = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+            if (address != MAP_FAILED) {
+                m_address = address;
+                m_size = size_t(info.st_size);
+            }
+        }
+
+        close(fd);
+    }
+#endif
+}
+
+inline SharedSegment::~SharedSegment() noexcept {
+#if defined(_WIN32)
+    // the system removes the mapping with its last handle
+    if (m_address != nullptr) {
+        UnmapViewOfFile(m_address);
+    }
+
+    if (m_mapping != nullptr) {
+        CloseHandle(m_mapping);
+    }
+#else
+    if (m_address != nullptr) {
+        munmap(m_address, m_size);
+        if (m_owner) {
+            shm_unlink(m_name.c_str());
+        }
+    }
+#endif
+}
+
+//////////////////////////////
+template<typename T, typename... P>
+SharedMultiIndexTable<T, P...>::SharedMultiIndexTable(const char* name, SharedMode mode, size_t capacity, P&& ...predicates) noexcept :
+    m_predicates(std::forward<P>(predicates)...),
+    m_segment(name, capacity != 0 && capacity < kNull ? MakeLayout(capacity).m_bytes : 0, mode),
+    m_owner(mode == SharedMode::Create) {
+    auto header = static_cast<Header*>(m_segment.Address());
+    if (header == nullptr) {
+        return;
+    }
+
+    if (m_owner) {
+        m_layout = MakeLayout(capacity);
+        header = new (header) Header();
+        header->m_layout = LayoutId();
+        header->m_bytes = m_layout.m_bytes;
+        header->m_capacity = uint32_t(capacity);
+        header->m_buckets = uint32_t(capacity);
+        m_header = header;
+        m_slots = reinterpret_cast<Slot*>(Array(m_layout.m_slots));
+        Clear();
+        // the readers accept the segment from now on
+        std::atomic_thread_fence(std::memory_order_release);
+        header->m_magic = kMagic;
+    } else {
+        if (m_segment.Size() < sizeof(Header) || header->m_magic != kMagic || header->m_layout != LayoutId()) {
+            return;
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        m_layout = MakeLayout(header->m_capacity);
+        if (m_layout.m_bytes != header->m_bytes || m_layout.m_bytes > m_segment.Size()) {
+            return;
+        }
+
+        m_header = header;
+        m_slots = reinterpret_cast<Slot*>(Array(m_layout.m_slots));
+    }
+}
+
+template<typename T, typename... P>
+bool SharedMultiIndexTable<T, P...>::Insert(T&& obj) noexcept {
+    if (!m_owner || m_header == nullptr) {
+        return false;
+    }
+
+    return Write([this, &obj] {
+        uint32_t slot = Allocate();
+        if (slot == kNull) {
+            return false;
+        }
+
+        memcpy(&m_slots[slot].m_object, &obj, sizeof(T));
+        LinkAll(slot, false, std::index_sequence_for<P...>{});
+        ++m_header->m_size;
+        return true;
+    });
+}
+
+template<typename T, typename... P>
+size_t SharedMultiIndexTable<T, P...>::Load(ObjectContainer&& objects) noexcept {
+    if (!m_owner || m_header == nullptr) {
+        return 0;
+    }
+
+    size_t loaded = Write([this, &objects] {
+        const uint32_t from = m_header->m_size;
+        size_t count = 0;
+        for (const auto& obj : objects) {
+            uint32_t slot = Allocate();
+            if (slot == kNull) {
+                break;
+            }
+
+            memcpy(&m_slots[slot].m_object, &obj, sizeof(T));
+            LinkAll(slot, true, std::index_sequence_for<P...>{});
+            ++m_header->m_size;
+            ++count;
+        }
+
+        SortAll(from, std::index_sequence_for<P...>{});
+        return count;
+    });
+
+    objects.clear();
+    return loaded;
+}
+
+template<typename T, typename... P>
+template<size_t I>
+bool SharedMultiIndexTable<T, P...>::Update(const T& where, T&& what) noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    if (!m_owner || m_header == nullptr) {
+        return false;
+    }
+
+    return Write([this, &where, &what] {
+        std::vector<uint32_t> slots;
+        Visit<I>(where, [&slots](uint32_t slot) { slots.push_back(slot); return true; });
+        for (auto slot : slots) {
+            UnlinkAll(slot, std::index_sequence_for<P...>{});
+            --m_header->m_size;
+            memcpy(&m_slots[slot].m_object, &what, sizeof(T));
+            LinkAll(slot, false, std::index_sequence_for<P...>{});
+            ++m_header->m_size;
+        }
+
+        return !slots.empty();
+    });
+}
+
+template<typename T, typename... P>
+template<size_t I>
+size_t SharedMultiIndexTable<T, P...>::Delete(const T& where) noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    if (!m_owner || m_header == nullptr) {
+        return 0;
+    }
+
+    return Write([this, &where] {
+        std::vector<uint32_t> slots;
+        Visit<I>(where, [&slots](uint32_t slot) { slots.push_back(slot); return true; });
+        for (auto slot : slots) {
+            UnlinkAll(slot, std::index_sequence_for<P...>{});
+            --m_header->m_size;
+            Release(slot);
+        }
+
+        return slots.size();
+    });
+}
+
+template<typename T, typename... P>
+template<size_t I>
+std::optional<T> SharedMultiIndexTable<T, P...>::FindFirst(const T& what) const noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    std::optional<T> result;
+    if (m_header != nullptr) {
+        Read([this, &what, &result] {
+            result.reset();
+            Visit<I>(what, [this, &result](uint32_t slot) { result = ObjectAt(slot); return false; });
+        });
+    }
+
+    return result;
+}
+
+template<typename T, typename... P>
+template<size_t I>
+typename SharedMultiIndexTable<T, P...>::ObjectContainer SharedMultiIndexTable<T, P...>::FindAll(const T& what) const noexcept {
+    // check the index existance
+    static_assert(I < sizeof...(P), "Index is out of range");
+    ObjectContainer result;
+    if (m_header != nullptr) {
+        Read([this, &what, &result] {
+            result.clear();
+            Visit<I>(what, [this, &result](uint32_t slot) { result.push_back(ObjectAt(slot)); return true; });
+        });
+    }
+
+    return result;
+}
+
+template<typename T, typename... P>
+size_t SharedMultiIndexTable<T, P...>::Size() const noexcept {
+    size_t size = 0;
+    if (m_header != nullptr) {
+        Read([this, &size] { size = m_header->m_size; });
+    }
+
+    return size;
+}
+
+template<typename T, typename... P>
+void SharedMultiIndexTable<T, P...>::Clear() noexcept {
+    if (!m_owner || m_header == nullptr) {
+        return;
+    }
+
+    Write([this] {
+        m_header->m_size = 0;
+        m_header->m_used = 0;
+        m_header->m_free = kNull;
+        for (size_t i = 0; i < sizeof...(P); ++i) {
+            if (m_layout.m_links[i] != 0) { // hashed index, empty buckets
+                memset(Array(m_layout.m_heads[i]), 0xff, sizeof(uint32_t) * m_header->m_buckets);
+            }
+        }
+    });
+}
+
+//////////////////////////////
+template<typename T, typename... P>
+/*static*/
+uint64_t SharedMultiIndexTable<T, P...>::LayoutId() noexcept {
+    uint64_t id = uint64_t(sizeof(Slot)) << 32 | alignof(T);
+    ((id = id * 31 + uint64_t(IndexKindOf<P>())), ...);
+    return id;
+}
+
+template<typename T, typename... P>
+/*static*/
+typename SharedMultiIndexTable<T, P...>::Layout SharedMultiIndexTable<T, P...>::MakeLayout(size_t capacity) noexcept {
+    constexpr std::array<bool, sizeof...(P)> hashed = {(IndexKindOf<P>() != IndexKind::Ordered)...};
+    auto align = [](size_t offset, size_t alignment) { return (offset + alignment - 1) / alignment * alignment; };
+
+    Layout layout;
+    layout.m_slots = align(sizeof(Header), 64);
+    size_t offset = align(layout.m_slots + sizeof(Slot) * capacity, 64);
+    for (size_t i = 0; i < sizeof...(P); ++i) {
+        // the bucket heads or the sorted slots
+        layout.m_heads[i] = offset;
+        offset += sizeof(uint32_t) * capacity;
+        if (hashed[i]) {
+            layout.m_links[i] = offset;
+            offset += sizeof(uint32_t) * capacity;
+        }
+    }
+
+    layout.m_bytes = offset;
+    return layout;
+}
+
+template<typename T, typename... P>
+template<size_t I>
+size_t SharedMultiIndexTable<T, P...>::Bucket(const T& key) const noexcept {
+    return std::get<I>(m_predicates)(key) % m_header->m_buckets;
+}
+
+template<typename T, typename... P>
+template<size_t I>
+bool SharedMultiIndexTable<T, P...>::Less(const T& first, const T& second) const noexcept {
+    return std::get<I>(m_predicates)(first, second);
+}
+
+template<typename T, typename... P>
+template<size_t I>
+bool SharedMultiIndexTable<T, P...>::Equal(const T& first, const T& second) const noexcept {
+    const auto& pred = std::get<I>(m_predicates);
+    if constexpr (IndexKindOf<std::tuple_element_t<I, std::tuple<P...>>>() == IndexKind::UnOrdered) {
+        return pred(first, second);
+    } else {
+        return !pred(first, second) && !pred(second, first);
+    }
+}
+
+template<typename T, typename... P>
+template<size_t I, typename F>
+void SharedMultiIndexTable<T, P...>::Visit(const T& what, F&& visitor) const noexcept {
+    const uint32_t capacity = m_header->m_capacity;
+    if constexpr (IsHashed<I>()) {
+        const uint32_t* heads = Array(m_layout.m_heads[I]);
+        const uint32_t* links = Array(m_layout.m_links[I]);
+        // a repeated lookup may see a broken chain, the steps are bounded by the capacity
+        uint32_t slot = heads[Bucket<I>(what)];
+        for (uint32_t steps = 0; slot < capacity && steps < capacity; ++steps, slot = links[slot]) {
+            if (Equal<I>(m_slots[slot].m_object, what) && !visitor(slot)) {
+                return;
+            }
+        }
+    } else {
+        const uint32_t* sorted = Array(m_layout.m_heads[I]);
+        const uint32_t size = m_header->m_size < capacity ? m_header->m_size : capacity;
+        auto it = std::lower_bound(sorted, sorted + size, what, [this](uint32_t slot, const T& key) {
+            return Less<I>(ObjectAt(slot), key);
+        });
+
+        for (; it != sorted + size && !Less<I>(what, ObjectAt(*it)); ++it) {
+            if (!visitor(*it)) {
+                return;
+            }
+        }
+    }
+}
+
+template<typename T, typename... P>
+template<size_t I>
+void SharedMultiIndexTable<T, P...>::Link(uint32_t slot, bool append) noexcept {
+    uint32_t* heads = Array(m_layout.m_heads[I]);
+    if constexpr (IsHashed<I>()) {
+        uint32_t* links = Array(m_layout.m_links[I]);
+        size_t bucket = Bucket<I>(m_slots[slot].m_object);
+        links[slot] = heads[bucket];
+        heads[bucket] = slot;
+    } else {
+        uint32_t* end = heads + m_header->m_size;
+        if (append) {
+            *end = slot;
+            return;
+        }
+
+        // after the equal objects
+        auto it = std::upper_bound(heads, end, slot, [this](uint32_t value, uint32_t item) {
+            return Less<I>(m_slots[value].m_object, m_slots[item].m_object);
+        });
+
+        memmove(it + 1, it, sizeof(uint32_t) * (end - it));
+        *it = slot;
+    }
+}
+
+template<typename T, typename... P>
+template<size_t I>
+void SharedMultiIndexTable<T, P...>::Unlink(uint32_t slot) noexcept {
+    uint32_t* heads = Array(m_layout.m_heads[I]);
+    if constexpr (IsHashed<I>()) {
+        uint32_t* links = Array(m_layout.m_links[I]);
+        uint32_t* link = &heads[Bucket<I>(m_slots[slot].m_object)];
+        while (*link != slot) {
+            link = &links[*link];
+        }
+
+        *link = links[slot];
+    } else {
+        uint32_t* end = heads + m_header->m_size;
+        auto it = std::lower_bound(heads, end, slot, [this](uint32_t item, uint32_t value) {
+            return Less<I>(m_slots[item].m_object, m_slots[value].m_object);
+        });
+
+        // among the equal objects
+        while (*it != slot) {
+            ++it;
+        }
+
+        memmove(it, it + 1, sizeof(uint32_t) * (end - it - 1));
+    }
+}
+
+template<typename T, typename... P>
+template<size_t I>
+void SharedMultiIndexTable<T, P...>::SortTail(uint32_t from) noexcept {
+    if constexpr (!IsHashed<I>()) {
+        uint32_t* heads = Array(m_layout.m_heads[I]);
+        uint32_t* end = heads + m_header->m_size;
+        auto less = [this](uint32_t first, uint32_t second) {
+            return Less<I>(m_slots[first].m_object, m_slots[second].m_object);
+        };
+
+        std::stable_sort(heads + from, end, less);
+        std::inplace_merge(heads, heads + from, end, less);
+    }
+}
+
+template<typename T, typename... P>
+template<size_t... I>
+void SharedMultiIndexTable<T, P...>::LinkAll(uint32_t slot, bool append, std::index_sequence<I...>) noexcept {
+    (Link<I>(slot, append), ...);
+}
+
+template<typename T, typename... P>
+template<size_t... I>
+void SharedMultiIndexTable<T, P...>::UnlinkAll(uint32_t slot, std::index_sequence<I...>) noexcept {
+    (Unlink<I>(slot), ...);
+}
+
+template<typename T, typename... P>
+template<size_t... I>
+void SharedMultiIndexTable<T, P...>::SortAll(uint32_t from, std::index_sequence<I...>) noexcept {
+    (SortTail<I>(from), ...);
+}
+
+template<typename T, typename... P>
+uint32_t SharedMultiIndexTable<T, P...>::Allocate() noexcept {
+    uint32_t slot = m_header->m_free;
+    if (slot != kNull) {
+        m_header->m_free = m_slots[slot].m_next;
+    } else if (m_header->m_used < m_header->m_capacity) {
+        slot = m_header->m_used++;
+    }
+
+    return slot;
+}
+
+template<typename T, typename... P>
+void SharedMultiIndexTable<T, P...>::Release(uint32_t slot) noexcept {
+    m_slots[slot].m_next = m_header->m_free;
+    m_header->m_free = slot;
+}
+
+template<typename T, typename... P>
+template<typename F>
+void SharedMultiIndexTable<T, P...>::Read(F&& read) const noexcept {
+    const auto& sequence = m_header->m_sequence;
+    for (;;) {
+        const uint64_t before = sequence.load(std::memory_order_acquire);
+        if ((before & 1) == 0) {
+            read();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before) {
+                return;
+            }
+        }
+
+        std::this_thread::yield();
+    }
+}
+
+template<typename T, typename... P>
+template<typename F>
+auto SharedMultiIndexTable<T, P...>::Write(F&& write) noexcept {
+    // even sequence again on the way out, after the result is computed
+    struct Sequence {
+        std::atomic<uint64_t>& m_sequence;
+        const uint64_t m_before;
+        ~Sequence() { m_sequence.store(m_before + 2, std::memory_order_release); }
+    };
+
+    std::lock_guard<std::mutex> locker(m_mutex);
+    Sequence sequence{m_header->m_sequence, m_header->m_sequence.load(std::memory_order_relaxed)};
+    sequence.m_sequence.store(sequence.m_before + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return write();
+}
@@ -0,0 +1,243 @@
+//
+//  SpatialMultiSet.h
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <type_traits>
+#include <vector>
+
+#include "Instrumentation.h"
+
+// Point of the spatial index, @D coordinates
+template<size_t D>
+using SpatialPoint = std::array<double, D>;
+
+// Axis aligned bounding box of the spatial index, a point is the box with m_min equal to m_max
+template<size_t D>
+struct SpatialBox {
+    SpatialPoint<D> m_min;
+    SpatialPoint<D> m_max;
+};
+
+// R*-tree of the object bounding boxes.
+// [root] -> [box][box]...[box] - inner nodes, every box covers the child node
+// [leaf] -> [box][box]...[box] - the object boxes
+// The node holds up to Capacity entries (at least 4) and at least 40% of them, except the root.
+// An insert descends by the least overlap (the last inner level) or area enlargement, the first overflow
+// of a level reinserts 30% of the node entries farthest from its center, the next one splits the node
+// by the axis of the least margin and the distribution of the least overlap.
+// An erase reinserts the entries of the underfilled nodes.
+// Freeze packs the tree bottom up by sort tile recursive (STR) tiling with the full nodes.
+template <uint32_t Capacity, typename Iter, typename Pred>
+class SpatialMultiSet {
+    using Value = std::remove_reference_t<decltype(*std::declval<Iter>())>;
+    static constexpr size_t D = Pred::Dimensions;
+    static_assert(D > 0, "Spatial index requires at least one dimension");
+    using Box = SpatialBox<D>;
+    using Point = SpatialPoint<D>;
+
+    static constexpr uint32_t kMaxEntries = Capacity < 4 ? 4 : Capacity;
+    static constexpr uint32_t kMinEntries = kMaxEntries * 2 / 5 < 2 ? 2 : kMaxEntries * 2 / 5;
+    static constexpr uint32_t kReinsert = kMaxEntries * 3 / 10 < 1 ? 1 : kMaxEntries * 3 / 10;
+    static constexpr size_t kMaxLevels = 32; // 2^32 items with at least 2 entries per node
+
+    struct Node {
+        uint32_t m_level{0}; // 0 - leaf, the entries are the items
+        uint32_t m_count{0};
+        Box m_boxes[kMaxEntries + 1]; // one more for the overflow before the split
+    };
+
+    template <typename S>
+    struct NodeOf : Node {
+        S m_slots[kMaxEntries + 1];
+    };
+    using Leaf = NodeOf<Iter>;
+    using Inner = NodeOf<Node*>;
+
+    // entry waiting for the (re)insert into a node of @m_level
+    struct Entry {
+        Box m_box;
+        uint32_t m_level{0};
+        Node* m_child{nullptr};
+        Iter m_item;
+    };
+
+    // not publicaly exposed, no need to follow std iterator interface,
+    // walks the leaf entries equal to the key or all of them
+    class iterator {
+        struct Frame {
+            const Node* m_node;
+            uint32_t m_index;
+        };
+
+        Frame m_path[kMaxLevels];
+        uint32_t m_depth{0}; // 0 - end
+        Box m_key{};
+        bool m_any{true};
+
+        // true if the entry may lead to or is a match
+        bool Match(const Node* node, const Box& box) const noexcept {
+            return m_any || (node->m_level == 0 ? Equal(box, m_key) : Contains(box, m_key));
+        }
+
+        // moves to the first match from the current position
+        void Seek() noexcept;
+
+    public:
+        iterator() noexcept = default;
+        iterator(const Node* root, const Box* key) noexcept;
+
+        iterator& operator++() noexcept {
+            ++m_path[m_depth - 1].m_index;
+            Seek();
+            return *this;
+        }
+
+        inline Iter& operator*() const noexcept {
+            const Frame& frame = m_path[m_depth - 1];
+            return const_cast<Leaf*>(static_cast<const Leaf*>(frame.m_node))->m_slots[frame.m_index];
+        }
+
+        inline bool operator==(const iterator& right) const noexcept {
+            return m_depth == right.m_depth && (m_depth == 0 ||
+                (m_path[m_depth - 1].m_node == right.m_path[m_depth - 1].m_node && m_path[m_depth - 1].m_index == right.m_path[m_depth - 1].m_index));
+        }
+
+        inline bool operator!=(const iterator& right) const noexcept {
+            return !(*this == right);
+        }
+    };
+
+    // box geometry
+    static bool Equal(const Box& first, const Box& second) noexcept;
+    static bool Contains(const Box& outer, const Box& inner) noexcept;
+    static bool Intersects(const Box& first, const Box& second) noexcept;
+    static void Extend(Box& box, const Box& other) noexcept;
+    static double Area(const Box& box) noexcept;
+    static double Margin(const Box& box) noexcept;
+    static double Overlap(const Box& first, const Box& second) noexcept;
+    static double Center(const Box& box, size_t axis) noexcept { return (box.m_min[axis] + box.m_max[axis]) / 2; }
+    // squared distance from @point to the nearest point of @box
+    static double Distance(const Point& point, const Box& box) noexcept;
+    static Box Cover(const Node* node) noexcept;
+
+    static void Add(Node* node, const Entry& entry) noexcept;
+    static void RemoveAt(Node* node, uint32_t index) noexcept;
+    static void DeleteNode(Node* node) noexcept;
+    static void Destroy(Node* node) noexcept;
+
+    // the child of @node to insert @box into
+    static uint32_t ChooseSubtree(const Inner* node, const Box& box) noexcept;
+    // inserts @entry into the subtree, returns the new sibling of @node if it was split
+    Node* Insert(Node* node, const Entry& entry, uint32_t& reinserted, std::vector<Entry>& pending) noexcept;
+    // inserts @entry and the entries it pushes out for the reinsert, grows the tree
+    void InsertEntry(const Entry& entry) noexcept;
+    // moves the entries farthest from the node center to @pending
+    static void TakeFarthest(Node* node, std::vector<Entry>& pending) noexcept;
+    template <typename S>
+    static NodeOf<S>* Split(NodeOf<S>* node) noexcept;
+    // removes @item with @box from the subtree, the underfilled nodes go to @orphans
+    static bool Remove(Node* node, const Box& box, const Iter& item, std::vector<Node*>& orphans) noexcept;
+    // visits the items of the subtree with the boxes intersecting @box
+    template <typename F>
+    static void Search(const Node* node, const Box& box, F& visitor) noexcept;
+    // visits the nodes of the subtree, the parents first
+    template <typename F>
+    static void VisitNodes(const Node* node, F& visitor) noexcept;
+    // sort tile recursive order of @entries on the axes from @axis
+    static void Tile(std::vector<Entry>& entries, size_t first, size_t last, size_t axis) noexcept;
+    // builds the tree of @entries bottom up, the nodes are full
+    void Pack(std::vector<Entry>& entries) noexcept;
+
+    Box Encode(const Value& object) const noexcept;
+
+private:
+    const Pred m_encoder; // bounding box operator
+    Node* m_root{nullptr};
+    size_t m_totalItems{0}; // keeps track of total number of items.
+#if defined(MULTIINDEX_INSTRUMENTATION)
+    mutable IndexEvents m_events;
+#endif
+
+    SpatialMultiSet(const SpatialMultiSet& src) noexcept = delete;
+    SpatialMultiSet(SpatialMultiSet&& src) noexcept = delete;
+
+protected:
+    explicit SpatialMultiSet(TupleParams<Pred>&& params) noexcept;
+    ~SpatialMultiSet() noexcept;
+
+    // the objects are equal if their boxes are
+    bool is_equal(const Value& first, const Value& second) const noexcept { return Equal(Encode(first), Encode(second)); }
+    // the boxes by the lower then the upper corner
+    bool is_less(const Value& first, const Value& second) const noexcept;
+
+    // insert
+    bool insert(bool, const Iter& key) noexcept;
+
+    // erase
+    size_t erase(Iter key) noexcept;
+
+    // erases the items @doomed returns true for, the rest is packed again
+    template <typename F>
+    size_t erase_if(F&& doomed) noexcept;
+
+    // nothing to preallocate, nodes are allocated on demand
+    void reserve(size_t) noexcept {}
+
+    size_t size() const noexcept { return m_totalItems; }
+#if defined(MULTIINDEX_INSTRUMENTATION)
+    IndexEvents& events() const noexcept { return m_events; }
+#endif
+
+    // the nodes are kept at least 40% full by the splits and the erases, nothing to compact
+    bool compact(size_t, float) noexcept { return true; }
+
+    // the node fan-out is fixed by Capacity
+    void set_capacity(uint32_t) noexcept {}
+
+    // structure statistics, the nodes are reported as buckets
+    IndexStats stats(size_t reads, size_t writes) const noexcept;
+
+    // sorts @keys by the lower corner of their boxes, the batched inserts and erases go to the close nodes
+    void sort_keys(std::vector<Iter>& keys) const noexcept;
+
+    // packs the empty set of @items with the full nodes
+    void freeze(std::vector<Iter>& items) noexcept;
+
+    // the items with the box equal to the key box
+    std::pair<iterator, iterator> equal_range(const Value& key) const noexcept;
+
+    // find the first item by the key box.
+    iterator find(const Value& key) const noexcept;
+
+    // visits the items with the boxes intersecting @box
+    template <typename F>
+    void search(const Box& box, F&& visitor) const noexcept;
+
+    // visits the items by the distance from @point to their boxes, the nearest first,
+    // until @visitor returns false
+    template <typename F>
+    void nearest(const Point& point, F&& visitor) const noexcept;
+
+    iterator begin() const noexcept { return iterator(m_root, nullptr); }
+
+    iterator end() const noexcept { return iterator(); }
+
+    // clear
+    void clear() noexcept;
+
+    // traverse
+    void traverse() const noexcept;
+};
+
+#include "SpatialMultiSet.hpp"
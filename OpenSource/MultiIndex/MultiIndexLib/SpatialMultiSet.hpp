@@ -0,0 +1,776 @@
+//
+//  SpatialMultiSet.hpp
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+SpatialMultiSet<Capacity, Iter, Pred>::iterator::iterator(const Node* root, const Box* key) noexcept {
+    if (key != nullptr) {
+        m_key = *key;
+        m_any = false;
+    }
+
+    if (root != nullptr) {
+        m_path[0] = Frame{root, 0};
+        m_depth = 1;
+        Seek();
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+void SpatialMultiSet<Capacity, Iter, Pred>::iterator::Seek() noexcept {
+    while (m_depth != 0) {
+        Frame& frame = m_path[m_depth - 1];
+        const Node* node = frame.m_node;
+        if (frame.m_index >= node->m_count) { // the node is done, next entry of the parent
+            if (--m_depth != 0) {
+                ++m_path[m_depth - 1].m_index;
+            }
+            continue;
+        }
+
+        if (!Match(node, node->m_boxes[frame.m_index])) {
+            ++frame.m_index;
+            continue;
+        }
+
+        if (node->m_level == 0) {
+            return;
+        }
+
+        m_path[m_depth++] = Frame{static_cast<const Inner*>(node)->m_slots[frame.m_index], 0};
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+SpatialMultiSet<Capacity, Iter, Pred>::SpatialMultiSet(TupleParams<Pred>&& params) noexcept :
+    m_encoder(std::move(std::get<2>(params))) {
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+SpatialMultiSet<Capacity, Iter, Pred>::~SpatialMultiSet() noexcept {
+    Destroy(m_root);
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+typename SpatialMultiSet<Capacity, Iter, Pred>::Box SpatialMultiSet<Capacity, Iter, Pred>::Encode(const Value& object) const noexcept {
+    Box box;
+    m_encoder(object, box);
+    return box;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+/*static*/
+bool SpatialMultiSet<Capacity, Iter, Pred>::Equal(const Box& first, const Box& second) noexcept {
+    return first.m_min == second.m_min && first.m_max == second.m_max;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+/*static*/
+bool SpatialMultiSet<Capacity, Iter, Pred>::Contains(const Box& outer, const Box& inner) noexcept {
+    for (size_t axis = 0; axis < D; ++axis) {
+        if (inner.m_min[axis] < outer.m_min[axis] || outer.m_max[axis] < inner.m_max[axis]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+/*static*/
+bool SpatialMultiSet<Capacity, Iter, Pred>::Intersects(const Box& first, const Box& second) noexcept {
+    for (size_t axis = 0; axis < D; ++axis) {
+        if (first.m_max[axis] < second.m_min[axis] || second.m_max[axis] < first.m_min[axis]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+/*static*/
+void SpatialMultiSet<Capacity, Iter, Pred>::Extend(Box& box, const Box& other) noexcept {
+    for (size_t axis = 0; axis < D; ++axis) {
+        box.m_min[axis] = std::min(box.m_min[axis], other.m_min[axis]);
+        box.m_max[axis] = std::max(box.m_max[axis], other.m_max[axis]);
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+/*static*/
+double SpatialMultiSet<Capacity, Iter, Pred>::Area(const Box& box) noexcept {
+    double area = 1;
+    for (size_t axis = 0; axis < D; ++axis) {
+        area *= box.m_max[axis] - box.m_min[axis];
+    }
+    return area;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+/*static*/
+double SpatialMultiSet<Capacity, Iter, Pred>::Margin(const Box& box) noexcept {
+    double margin = 0;
+    for (size_t axis = 0; axis < D; ++axis) {
+        margin += box.m_max[axis] - box.m_min[axis];
+    }
+    return margin;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+/*static*/
+double SpatialMultiSet<Capacity, Iter, Pred>::Overlap(const Box& first, const Box& second) noexcept {
+    double area = 1;
+    for (size_t axis = 0; axis < D; ++axis) {
+        const double extent = std::min(first.m_max[axis], second.m_max[axis]) - std::max(first.m_min[axis], second.m_min[axis]);
+        if (extent <= 0) {
+            return 0;
+        }
+        area *= extent;
+    }
+    return area;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+/*static*/
+double SpatialMultiSet<Capacity, Iter, Pred>::Distance(const Point& point, const Box& box) noexcept {
+    double distance = 0;
+    for (size_t axis = 0; axis < D; ++axis) {
+        const double delta = std::max({box.m_min[axis] - point[axis], 0., point[axis] - box.m_max[axis]});
+        distance += delta * delta;
+    }
+    return distance;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+/*static*/
+typename SpatialMultiSet<Capacity, Iter, Pred>::Box SpatialMultiSet<Capacity, Iter, Pred>::Cover(const Node* node) noexcept {
+    Box box = node->m_boxes[0];
+    for (uint32_t i = 1; i < node->m_count; ++i) {
+        Extend(box, node->m_boxes[i]);
+    }
+    return box;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+/*static*/
+void SpatialMultiSet<Capacity, Iter, Pred>::Add(Node* node, const Entry& entry) noexcept {
+    if (node->m_level == 0) {
+        static_cast<Leaf*>(node)->m_slots[node->m_count] = entry.m_item;
+    } else {
+        static_cast<Inner*>(node)->m_slots[node->m_count] = entry.m_child;
+    }
+    node->m_boxes[node->m_count++] = entry.m_box;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+/*static*/
+void SpatialMultiSet<Capacity, Iter, Pred>::RemoveAt(Node* node, uint32_t index) noexcept {
+    // the entries are not ordered, the last one takes the place
+    const uint32_t last = --node->m_count;
+    if (index == last) {
+        return;
+    }
+
+    node->m_boxes[index] = node->m_boxes[last];
+    if (node->m_level == 0) {
+        Leaf* leaf = static_cast<Leaf*>(node);
+        leaf->m_slots[index] = leaf->m_slots[last];
+    } else {
+        Inner* inner = static_cast<Inner*>(node);
+        inner->m_slots[index] = inner->m_slots[last];
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+/*static*/
+void SpatialMultiSet<Capacity, Iter, Pred>::DeleteNode(Node* node) noexcept {
+    if (node->m_level == 0) {
+        delete static_cast<Leaf*>(node);
+    } else {
+        delete static_cast<Inner*>(node);
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+/*static*/
+void SpatialMultiSet<Capacity, Iter, Pred>::Destroy(Node* node) noexcept {
+    if (node == nullptr) {
+        return;
+    }
+
+    if (node->m_level != 0) {
+        Inner* inner = static_cast<Inner*>(node);
+        for (uint32_t i = 0; i < inner->m_count; ++i) {
+            Destroy(inner->m_slots[i]);
+        }
+    }
+    DeleteNode(node);
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+/*static*/
+uint32_t SpatialMultiSet<Capacity, Iter, Pred>::ChooseSubtree(const Inner* node, const Box& box) noexcept {
+    // the overlap with the siblings decides above the leaves only, it costs O(entries^2),
+    // then the area enlargement, the margin enlargement (the flat boxes) and the area
+    const bool leaves = node->m_level == 1;
+    uint32_t best = 0;
+    std::array<double, 4> bestCost;
+    bestCost.fill(std::numeric_limits<double>::infinity());
+    for (uint32_t i = 0; i < node->m_count; ++i) {
+        const Box& current = node->m_boxes[i];
+        Box grown = current;
+        Extend(grown, box);
+        double overlap = 0;
+        if (leaves) {
+            for (uint32_t j = 0; j < node->m_count; ++j) {
+                if (j != i) {
+                    overlap += Overlap(grown, node->m_boxes[j]) - Overlap(current, node->m_boxes[j]);
+                }
+            }
+        }
+
+        const double area = Area(current);
+        const std::array<double, 4> cost = {overlap, Area(grown) - area, Margin(grown) - Margin(current), area};
+        if (cost < bestCost) {
+            bestCost = cost;
+            best = i;
+        }
+    }
+    return best;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+typename SpatialMultiSet<Capacity, Iter, Pred>::Node*
+SpatialMultiSet<Capacity, Iter, Pred>::Insert(Node* node, const Entry& entry, uint32_t& reinserted, std::vector<Entry>& pending) noexcept {
+    if (node->m_level == entry.m_level) {
+        Add(node, entry);
+    } else {
+        Inner* inner = static_cast<Inner*>(node);
+        const uint32_t i = ChooseSubtree(inner, entry.m_box);
+        Node* sibling = Insert(inner->m_slots[i], entry, reinserted, pending);
+        inner->m_boxes[i] = Cover(inner->m_slots[i]);
+        if (sibling != nullptr) {
+            Entry split;
+            split.m_box = Cover(sibling);
+            split.m_level = node->m_level;
+            split.m_child = sibling;
+            Add(node, split);
+        }
+    }
+
+    if (node->m_count <= kMaxEntries) {
+        return nullptr;
+    }
+
+    // the first overflow of the level reinserts, the root is split right away
+    if (node != m_root && (reinserted & (1u << node->m_level)) == 0) {
+        reinserted |= 1u << node->m_level;
+        TakeFarthest(node, pending);
+        return nullptr;
+    }
+
+    MULTIINDEX_COUNT(m_events.splits);
+    if (node->m_level == 0) {
+        return Split(static_cast<Leaf*>(node));
+    }
+    return Split(static_cast<Inner*>(node));
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+void SpatialMultiSet<Capacity, Iter, Pred>::InsertEntry(const Entry& entry) noexcept {
+    uint32_t reinserted = 0; // levels which had the reinsert already
+    std::vector<Entry> pending;
+    Entry next = entry;
+    for (;;) {
+        if (m_root == nullptr) {
+            m_root = new Leaf;
+        }
+
+        if (Node* sibling = Insert(m_root, next, reinserted, pending)) { // the root is split, grow the tree
+            Inner* root = new Inner;
+            root->m_level = m_root->m_level + 1;
+            Entry child;
+            child.m_level = root->m_level;
+            child.m_box = Cover(m_root);
+            child.m_child = m_root;
+            Add(root, child);
+            child.m_box = Cover(sibling);
+            child.m_child = sibling;
+            Add(root, child);
+            m_root = root;
+        }
+
+        if (pending.empty()) {
+            break;
+        }
+
+        next = pending.back();
+        pending.pop_back();
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+/*static*/
+void SpatialMultiSet<Capacity, Iter, Pred>::TakeFarthest(Node* node, std::vector<Entry>& pending) noexcept {
+    const Box cover = Cover(node);
+    double distances[kMaxEntries + 1];
+    uint32_t order[kMaxEntries + 1] = {}; // GCC can't see that the node holds more than kReinsert entries
+    for (uint32_t i = 0; i < node->m_count; ++i) {
+        distances[i] = 0;
+        for (size_t axis = 0; axis < D; ++axis) {
+            const double delta = Center(node->m_boxes[i], axis) - Center(cover, axis);
+            distances[i] += delta * delta;
+        }
+        order[i] = i;
+    }
+
+    // the farthest first
+    std::partial_sort(order, order + kReinsert, order + node->m_count,
+                      [&distances](uint32_t first, uint32_t second) -> bool { return distances[first] > distances[second]; });
+
+    // pending is a stack, the closest of them is reinserted first
+    for (uint32_t k = 0; k < kReinsert; ++k) {
+        const uint32_t i = order[k];
+        Entry entry;
+        entry.m_box = node->m_boxes[i];
+        entry.m_level = node->m_level;
+        if (node->m_level == 0) {
+            entry.m_item = static_cast<Leaf*>(node)->m_slots[i];
+        } else {
+            entry.m_child = static_cast<Inner*>(node)->m_slots[i];
+        }
+        pending.push_back(entry);
+    }
+
+    // the last entry takes the removed place, remove from the end
+    std::sort(order, order + kReinsert, std::greater<uint32_t>());
+    for (uint32_t k = 0; k < kReinsert; ++k) {
+        RemoveAt(node, order[k]);
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+template <typename S>
+/*static*/
+typename SpatialMultiSet<Capacity, Iter, Pred>::template NodeOf<S>*
+SpatialMultiSet<Capacity, Iter, Pred>::Split(NodeOf<S>* node) noexcept {
+    const uint32_t count = node->m_count;
+    uint32_t order[kMaxEntries + 1] = {}; // GCC can't see that the node holds more than kReinsert entries
+    Box prefix[kMaxEntries + 1]; // covers of the first k + 1 entries
+    Box suffix[kMaxEntries + 1]; // covers of the entries from k
+
+    // sorts the entries by the lower (@upper is false) or upper box side on @axis, covers the prefixes and suffixes
+    auto distribute = [&](size_t axis, bool upper) {
+        for (uint32_t i = 0; i < count; ++i) {
+            order[i] = i;
+        }
+        std::sort(order, order + count, [node, axis, upper](uint32_t first, uint32_t second) -> bool {
+            const Box& left = node->m_boxes[first];
+            const Box& right = node->m_boxes[second];
+            return upper ? (left.m_max[axis] < right.m_max[axis] || (left.m_max[axis] == right.m_max[axis] && left.m_min[axis] < right.m_min[axis]))
+                         : (left.m_min[axis] < right.m_min[axis] || (left.m_min[axis] == right.m_min[axis] && left.m_max[axis] < right.m_max[axis]));
+        });
+
+        prefix[0] = node->m_boxes[order[0]];
+        for (uint32_t i = 1; i < count; ++i) {
+            prefix[i] = prefix[i - 1];
+            Extend(prefix[i], node->m_boxes[order[i]]);
+        }
+        suffix[count - 1] = node->m_boxes[order[count - 1]];
+        for (uint32_t i = count - 1; i-- > 0;) {
+            suffix[i] = suffix[i + 1];
+            Extend(suffix[i], node->m_boxes[order[i]]);
+        }
+    };
+
+    // the axis with the least margin of all distributions
+    size_t bestAxis = 0;
+    double bestMargin = std::numeric_limits<double>::infinity();
+    for (size_t axis = 0; axis < D; ++axis) {
+        double margin = 0;
+        for (bool upper : {false, true}) {
+            distribute(axis, upper);
+            for (uint32_t k = kMinEntries; k <= count - kMinEntries; ++k) {
+                margin += Margin(prefix[k - 1]) + Margin(suffix[k]);
+            }
+        }
+
+        if (margin < bestMargin) {
+            bestMargin = margin;
+            bestAxis = axis;
+        }
+    }
+
+    // the distribution with the least overlap, then the least area
+    bool bestUpper = false;
+    uint32_t bestSplit = kMinEntries;
+    std::pair<double, double> bestCost(std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity());
+    for (bool upper : {false, true}) {
+        distribute(bestAxis, upper);
+        for (uint32_t k = kMinEntries; k <= count - kMinEntries; ++k) {
+            const std::pair<double, double> cost(Overlap(prefix[k - 1], suffix[k]), Area(prefix[k - 1]) + Area(suffix[k]));
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestUpper = upper;
+                bestSplit = k;
+            }
+        }
+    }
+
+    distribute(bestAxis, bestUpper);
+    Box boxes[kMaxEntries + 1];
+    S slots[kMaxEntries + 1];
+    for (uint32_t i = 0; i < count; ++i) {
+        boxes[i] = node->m_boxes[order[i]];
+        slots[i] = node->m_slots[order[i]];
+    }
+
+    NodeOf<S>* sibling = new NodeOf<S>;
+    sibling->m_level = node->m_level;
+    node->m_count = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        NodeOf<S>* target = i < bestSplit ? node : sibling;
+        target->m_boxes[target->m_count] = boxes[i];
+        target->m_slots[target->m_count++] = slots[i];
+    }
+    return sibling;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+/*static*/
+bool SpatialMultiSet<Capacity, Iter, Pred>::Remove(Node* node, const Box& box, const Iter& item, std::vector<Node*>& orphans) noexcept {
+    if (node->m_level == 0) {
+        Leaf* leaf = static_cast<Leaf*>(node);
+        for (uint32_t i = 0; i < leaf->m_count; ++i) {
+            if (leaf->m_slots[i] == item) {
+                RemoveAt(leaf, i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Inner* inner = static_cast<Inner*>(node);
+    for (uint32_t i = 0; i < inner->m_count; ++i) {
+        if (!Contains(inner->m_boxes[i], box)) {
+            continue;
+        }
+
+        Node* child = inner->m_slots[i];
+        if (!Remove(child, box, item, orphans)) {
+            continue;
+        }
+
+        if (child->m_count < kMinEntries) { // underfilled, the entries are reinserted
+            orphans.push_back(child);
+            RemoveAt(inner, i);
+        } else {
+            inner->m_boxes[i] = Cover(child);
+        }
+        return true;
+    }
+    return false;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+template <typename F>
+/*static*/
+void SpatialMultiSet<Capacity, Iter, Pred>::Search(const Node* node, const Box& box, F& visitor) noexcept {
+    for (uint32_t i = 0; i < node->m_count; ++i) {
+        if (!Intersects(node->m_boxes[i], box)) {
+            continue;
+        }
+
+        if (node->m_level == 0) {
+            visitor(static_cast<const Leaf*>(node)->m_slots[i]);
+        } else {
+            Search(static_cast<const Inner*>(node)->m_slots[i], box, visitor);
+        }
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+template <typename F>
+/*static*/
+void SpatialMultiSet<Capacity, Iter, Pred>::VisitNodes(const Node* node, F& visitor) noexcept {
+    visitor(node);
+    if (node->m_level != 0) {
+        const Inner* inner = static_cast<const Inner*>(node);
+        for (uint32_t i = 0; i < inner->m_count; ++i) {
+            VisitNodes(inner->m_slots[i], visitor);
+        }
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+/*static*/
+void SpatialMultiSet<Capacity, Iter, Pred>::Tile(std::vector<Entry>& entries, size_t first, size_t last, size_t axis) noexcept {
+    std::sort(entries.begin() + first, entries.begin() + last, [axis](const Entry& left, const Entry& right) -> bool {
+        return Center(left.m_box, axis) < Center(right.m_box, axis);
+    });
+
+    if (axis + 1 == D) {
+        return;
+    }
+
+    // slabs of whole nodes along the axis, every slab is tiled along the next axes
+    const size_t nodes = (last - first + kMaxEntries - 1) / kMaxEntries;
+    const size_t slabs = size_t(std::ceil(std::pow(double(nodes), 1. / double(D - axis))));
+    const size_t slab = kMaxEntries * ((nodes + slabs - 1) / slabs);
+    for (size_t from = first; from < last; from += slab) {
+        Tile(entries, from, std::min(from + slab, last), axis + 1);
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+void SpatialMultiSet<Capacity, Iter, Pred>::Pack(std::vector<Entry>& entries) noexcept {
+    if (entries.empty()) {
+        return;
+    }
+
+    std::vector<Entry> parents;
+    for (uint32_t level = 0; ; ++level) {
+        Tile(entries, 0, entries.size(), 0);
+        parents.clear();
+        for (size_t first = 0; first < entries.size(); first += kMaxEntries) {
+            Node* node = level == 0 ? static_cast<Node*>(new Leaf) : static_cast<Node*>(new Inner);
+            node->m_level = level;
+            for (size_t i = first; i < std::min(first + kMaxEntries, entries.size()); ++i) {
+                Add(node, entries[i]);
+            }
+
+            Entry parent;
+            parent.m_box = Cover(node);
+            parent.m_level = level + 1;
+            parent.m_child = node;
+            parents.push_back(parent);
+        }
+
+        if (parents.size() == 1) {
+            m_root = parents[0].m_child;
+            return;
+        }
+        entries.swap(parents);
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+bool SpatialMultiSet<Capacity, Iter, Pred>::is_less(const Value& first, const Value& second) const noexcept {
+    const Box left = Encode(first);
+    const Box right = Encode(second);
+    return left.m_min < right.m_min || (left.m_min == right.m_min && left.m_max < right.m_max);
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+bool SpatialMultiSet<Capacity, Iter, Pred>::insert(bool, const Iter& key) noexcept {
+    Entry entry;
+    entry.m_box = Encode(*key);
+    entry.m_item = key;
+    InsertEntry(entry);
+    ++m_totalItems;
+    return true;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+size_t SpatialMultiSet<Capacity, Iter, Pred>::erase(Iter key) noexcept {
+    if (m_root == nullptr) {
+        return 0;
+    }
+
+    std::vector<Node*> orphans;
+    if (!Remove(m_root, Encode(*key), key, orphans)) {
+        return 0;
+    }
+
+    --m_totalItems;
+    // the inner root loses one child at most, so it keeps one at least
+    for (Node* orphan : orphans) {
+        for (uint32_t i = 0; i < orphan->m_count; ++i) {
+            Entry entry;
+            entry.m_box = orphan->m_boxes[i];
+            entry.m_level = orphan->m_level;
+            if (orphan->m_level == 0) {
+                entry.m_item = static_cast<Leaf*>(orphan)->m_slots[i];
+            } else {
+                entry.m_child = static_cast<Inner*>(orphan)->m_slots[i];
+            }
+            InsertEntry(entry);
+        }
+        DeleteNode(orphan);
+    }
+
+    // shrink the tree
+    while (m_root->m_level != 0 && m_root->m_count == 1) {
+        Node* child = static_cast<Inner*>(m_root)->m_slots[0];
+        DeleteNode(m_root);
+        m_root = child;
+    }
+
+    if (m_root->m_count == 0) {
+        DeleteNode(m_root);
+        m_root = nullptr;
+    }
+    return 1;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+template <typename F>
+size_t SpatialMultiSet<Capacity, Iter, Pred>::erase_if(F&& doomed) noexcept {
+    std::vector<Entry> kept;
+    kept.reserve(m_totalItems);
+    size_t erased = 0;
+    auto collect = [&](const Node* node) {
+        if (node->m_level != 0) {
+            return;
+        }
+
+        const Leaf* leaf = static_cast<const Leaf*>(node);
+        for (uint32_t i = 0; i < leaf->m_count; ++i) {
+            if (doomed(leaf->m_slots[i])) {
+                ++erased;
+                continue;
+            }
+
+            Entry entry;
+            entry.m_box = leaf->m_boxes[i];
+            entry.m_item = leaf->m_slots[i];
+            kept.push_back(entry);
+        }
+    };
+
+    if (m_root != nullptr) {
+        VisitNodes(m_root, collect);
+    }
+
+    if (erased != 0) {
+        clear();
+        m_totalItems = kept.size();
+        Pack(kept);
+    }
+    return erased;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+IndexStats SpatialMultiSet<Capacity, Iter, Pred>::stats(size_t reads, size_t writes) const noexcept {
+    IndexStats stats;
+    stats.items = m_totalItems;
+    stats.capacity = kMaxEntries;
+    stats.recommended = kMaxEntries;
+    stats.reads = reads;
+    stats.writes = writes;
+    auto count = [&stats](const Node*) { ++stats.buckets; };
+    if (m_root != nullptr) {
+        VisitNodes(m_root, count);
+    }
+    stats.slots = stats.buckets * kMaxEntries;
+    return stats;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+void SpatialMultiSet<Capacity, Iter, Pred>::sort_keys(std::vector<Iter>& keys) const noexcept {
+    // encoded once, stable, equal boxes keep the batch order
+    std::vector<std::pair<Point, Iter>> encoded;
+    encoded.reserve(keys.size());
+    for (const Iter& key : keys) {
+        encoded.emplace_back(Encode(*key).m_min, key);
+    }
+
+    std::stable_sort(encoded.begin(), encoded.end(), [](const auto& first, const auto& second) -> bool { return first.first < second.first; });
+    for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = encoded[i].second;
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+void SpatialMultiSet<Capacity, Iter, Pred>::freeze(std::vector<Iter>& items) noexcept {
+    if (m_totalItems != 0) {
+        return;
+    }
+
+    std::vector<Entry> entries(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        entries[i].m_box = Encode(*items[i]);
+        entries[i].m_item = items[i];
+    }
+    m_totalItems = entries.size();
+    Pack(entries);
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+std::pair<typename SpatialMultiSet<Capacity, Iter, Pred>::iterator, typename SpatialMultiSet<Capacity, Iter, Pred>::iterator>
+SpatialMultiSet<Capacity, Iter, Pred>::equal_range(const Value& key) const noexcept {
+    const Box box = Encode(key);
+    return std::make_pair(iterator(m_root, &box), iterator());
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+typename SpatialMultiSet<Capacity, Iter, Pred>::iterator SpatialMultiSet<Capacity, Iter, Pred>::find(const Value& key) const noexcept {
+    const Box box = Encode(key);
+    return iterator(m_root, &box);
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+template <typename F>
+void SpatialMultiSet<Capacity, Iter, Pred>::search(const Box& box, F&& visitor) const noexcept {
+    if (m_root != nullptr) {
+        Search(m_root, box, visitor);
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+template <typename F>
+void SpatialMultiSet<Capacity, Iter, Pred>::nearest(const Point& point, F&& visitor) const noexcept {
+    if (m_root == nullptr) {
+        return;
+    }
+
+    // best first, a node is opened when it is closer than any item left,
+    // m_index is the item position in the leaf or kNode
+    static constexpr uint32_t kNode = std::numeric_limits<uint32_t>::max();
+    struct Candidate {
+        double m_distance;
+        const Node* m_node;
+        uint32_t m_index;
+    };
+    auto farther = [](const Candidate& first, const Candidate& second) -> bool { return first.m_distance > second.m_distance; };
+    std::priority_queue<Candidate, std::vector<Candidate>, decltype(farther)> queue(farther);
+    queue.push(Candidate{0, m_root, kNode});
+    while (!queue.empty()) {
+        const Candidate candidate = queue.top();
+        queue.pop();
+        const Node* node = candidate.m_node;
+        if (candidate.m_index != kNode) {
+            if (!visitor(static_cast<const Leaf*>(node)->m_slots[candidate.m_index])) {
+                return;
+            }
+            continue;
+        }
+
+        for (uint32_t i = 0; i < node->m_count; ++i) {
+            const double distance = Distance(point, node->m_boxes[i]);
+            if (node->m_level == 0) {
+                queue.push(Candidate{distance, node, i});
+            } else {
+                queue.push(Candidate{distance, static_cast<const Inner*>(node)->m_slots[i], kNode});
+            }
+        }
+    }
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+void SpatialMultiSet<Capacity, Iter, Pred>::clear() noexcept {
+    Destroy(m_root);
+    m_root = nullptr;
+    m_totalItems = 0;
+}
+
+template <uint32_t Capacity, typename Iter, typename Pred>
+void SpatialMultiSet<Capacity, Iter, Pred>::traverse() const noexcept {
+    // direct
+    for (auto bDirIt = begin(), eDirIt = end(); bDirIt != eDirIt; ++bDirIt) {
+        printf("Item(spatial): %d\n", (*bDirIt)->i);
+    }
+    printf("_______________________\n");
+}
@@ -0,0 +1,23 @@
+//
+//  TableObserver.h
+//  MultiIndex
+//
+//  Created by Yuri Putivsky on 10/18/26.
+//
+
+#pragma once
+
+// Observer of the table content, see MultiIndexTable::Attach.
+// The table calls it for every stored and erased object while its write lock is held,
+// an update is reported as the erase of the old object followed by the insert of the new one.
+// Implementations must not call back into the table.
+template<typename T>
+class TableObserver {
+public:
+    virtual ~TableObserver() = default;
+
+    virtual void OnInsert(const T& object) noexcept = 0;
+    virtual void OnErase(const T& object) noexcept = 0;
+    // the table was cleared
+    virtual void OnClear() noexcept = 0;
+};
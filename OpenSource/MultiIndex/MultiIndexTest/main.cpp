@@ -6,9 +6,15 @@
 //
 
 #include "MultiIndex.h"
+#include "AggregateView.h"
+#include "SharedMultiIndex.h"
 #include <stdio.h>
+#include <algorithm>
 #include <string>
 #include <compare>
+#include <cstdlib>
+#include <thread>
+#include <vector>
 
 #if defined(_WIN32)
 #include<windows.h>
@@ -112,7 +118,1221 @@ struct IndexOrderedPredicate : OrderedTraits {
     }
 };
 
+// equal keys, the objects of the same i
+struct IndexKeyUnOrderedPredicate : UnOrderedTraits {
+    inline size_t operator()(const Object& o) const noexcept {
+        return std::hash<int>{}(o.i);
+    }
+    
+    inline bool operator()(const Object& x, const Object& y) const noexcept {
+        return x.i == y.i;
+    }
+};
+
+struct IndexKeyOrderedPredicate : OrderedTraits {
+    inline bool operator()(const Object& x, const Object& y) const noexcept {
+        return x.i < y.i;
+    }
+};
+
+// the own bucket capacities override the table Capacity
+struct IndexWideOrderedPredicate : IndexKeyOrderedPredicate {
+    static constexpr uint32_t Capacity = 32;
+};
+
+struct IndexNarrowUnOrderedPredicate : IndexUnOrderedPredicate {
+    static constexpr uint32_t Capacity = 2;
+};
+
+// order statistics by i
+struct IndexKeyRankedPredicate : RankedOrderedTraits {
+    inline bool operator()(const Object& x, const Object& y) const noexcept {
+        return x.i < y.i;
+    }
+};
+
+struct IndexConcurrentUnOrderedPredicate : ConcurrentUnOrderedTraits {
+    inline size_t operator()(const Object& o) const noexcept {
+        return o();
+    }
+    
+    inline bool operator()(const Object& x, const Object& y) const noexcept {
+        return x == y;
+    }
+};
+
+struct IndexKeyConcurrentUnOrderedPredicate : ConcurrentUnOrderedTraits {
+    inline size_t operator()(const Object& o) const noexcept {
+        return std::hash<int>{}(o.i);
+    }
+    
+    inline bool operator()(const Object& x, const Object& y) const noexcept {
+        return x.i == y.i;
+    }
+};
+
+struct IndexKeyConcurrentOrderedPredicate : ConcurrentOrderedTraits {
+    inline bool operator()(const Object& x, const Object& y) const noexcept {
+        return x.i < y.i;
+    }
+};
+
+struct IndexNameRadixPredicate : RadixTraits {
+    inline void operator()(const Object& o, RadixKey& key) const noexcept {
+        RadixAppend(key, o.s);
+    }
+};
+
+// the objects of the spatial test are the points of a 100 x 100 grid
+struct IndexGridSpatialPredicate : SpatialTraits {
+    static constexpr size_t Dimensions = 2;
+    
+    inline void operator()(const Object& o, SpatialBox<2>& box) const noexcept {
+        box.m_min = {double(o.i % 100), double(o.i / 100)};
+        box.m_max = box.m_min;
+    }
+};
+
+struct IndexNameUnOrderedPredicate : UnOrderedTraits {
+    inline size_t operator()(const Object& o) const noexcept {
+        return std::hash<std::string>{}(o.s);
+    }
+    
+    inline bool operator()(const Object& x, const Object& y) const noexcept {
+        return x.s == y.s;
+    }
+};
+
+// the grouped indices keep every distinct i once with the posting list of its objects
+struct IndexKeyGroupedUnOrderedPredicate : GroupedUnOrderedTraits {
+    inline size_t operator()(const Object& o) const noexcept {
+        return std::hash<int>{}(o.i);
+    }
+    
+    inline bool operator()(const Object& x, const Object& y) const noexcept {
+        return x.i == y.i;
+    }
+};
+
+struct IndexKeyGroupedHashedOrderedPredicate : GroupedHashedOrderedTraits {
+    inline size_t operator()(const Object& o) const noexcept {
+        return std::hash<int>{}(o.i % 7);
+    }
+    
+    inline bool operator()(const Object& x, const Object& y) const noexcept {
+        return x.i < y.i;
+    }
+};
+
+// the low cardinality keys of the bitmap test, i % 8 and i % 5
+struct IndexColorBitmapPredicate : BitmapTraits {
+    inline size_t operator()(const Object& o) const noexcept {
+        return std::hash<int>{}(o.i % 8);
+    }
+    
+    inline bool operator()(const Object& x, const Object& y) const noexcept {
+        return x.i % 8 == y.i % 8;
+    }
+};
+
+struct IndexSizeBitmapPredicate : BitmapTraits {
+    inline size_t operator()(const Object& o) const noexcept {
+        return std::hash<int>{}(o.i % 5);
+    }
+    
+    inline bool operator()(const Object& x, const Object& y) const noexcept {
+        return x.i % 5 == y.i % 5;
+    }
+};
+
+struct GroupOf {
+    inline int operator()(const Object& o) const noexcept {
+        return o.i % 10;
+    }
+};
+
+struct ValueOf {
+    inline long operator()(const Object& o) const noexcept {
+        return o.i;
+    }
+};
+
+// trivially copyable object of the shared memory table
+struct Quote {
+    int id;
+    int price;
+};
+
+struct QuoteIdPredicate : UnOrderedTraits {
+    inline size_t operator()(const Quote& q) const noexcept {
+        return std::hash<int>{}(q.id);
+    }
+    
+    inline bool operator()(const Quote& x, const Quote& y) const noexcept {
+        return x.id == y.id;
+    }
+};
+
+struct QuotePricePredicate : OrderedTraits {
+    inline bool operator()(const Quote& x, const Quote& y) const noexcept {
+        return x.price < y.price;
+    }
+};
+
+// holds the writer that inserts the object with key -1 inside the table until released
+struct HoldingObserver : TableObserver<Object> {
+    std::atomic<bool> held{false};
+    std::atomic<bool> released{false};
+
+    void OnInsert(const Object& object) noexcept override {
+        if (object.i == -1) {
+            held = true;
+            while (!released.load()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void OnErase(const Object&) noexcept override {}
+    void OnClear() noexcept override {}
+};
+
+// behavior checks, unlike assert they stay in the release build
+#define EXPECT(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("Failed: %s, line %d\n", #condition, __LINE__); \
+            exit(1); \
+        } \
+    } while (0)
+
+// Clear empties the storage, Rebuild doesn't bring the objects back
+void TestClear() {
+    MultiIndexTable<LockPolicy::Internal, 8, Object, IndexUnOrderedPredicate, IndexOrderedPredicate>
+    table(16, 4.f, IndexUnOrderedPredicate(), IndexOrderedPredicate());
+    for (int i = 0; i < 100; ++i) {
+        table.Insert(Object{i, std::to_string(i)});
+    }
+    
+    table.Clear();
+    EXPECT(table.Size() == 0);
+    table.Rebuild();
+    EXPECT(table.Size() == 0);
+    EXPECT(table.FindAll<0>(Object{1, "1"}).empty());
+    EXPECT(table.FindAll<1>(Object{1, "1"}).empty());
+    
+    table.Insert(Object{1, "1"});
+    EXPECT(table.Size() == 1);
+    EXPECT(table.FindAll<1>(Object{1, "1"}).size() == 1);
+}
+
+// Load into a non-empty table builds every index in parallel, each one sees the old and the loaded objects
+void TestLoad() {
+    MultiIndexTable<LockPolicy::Internal, 8, Object, IndexUnOrderedPredicate, IndexKeyOrderedPredicate, IndexHashedOrderedPredicate>
+    table(16, 4.f, IndexUnOrderedPredicate(), IndexKeyOrderedPredicate(), IndexHashedOrderedPredicate());
+    for (int i = 0; i < 100; ++i) {
+        table.Insert(Object{i, std::to_string(i)});
+    }
+    
+    std::list<Object> objects;
+    for (int i = 100; i < 1100; ++i) {
+        objects.push_back(Object{i, std::to_string(i)});
+    }
+    table.Load(std::move(objects));
+    
+    EXPECT(table.Size() == 1100);
+    for (int i = 0; i < 1100; ++i) {
+        const Object object{i, std::to_string(i)};
+        EXPECT(table.FindAll<0>(object).size() == 1);
+        EXPECT(table.FindAll<1>(object).size() == 1);
+        EXPECT(table.FindAll<2>(object).size() == 1);
+    }
+    
+    auto cursor = table.SeekFirst<1>();
+    auto all = table.Next<1>(cursor, 2000);
+    EXPECT(all.size() == 1100 && all.front().i == 0 && all.back().i == 1099);
+    EXPECT(std::is_sorted(all.begin(), all.end(), [](const Object& x, const Object& y) { return x.i < y.i; }));
+}
+
+// the erased objects wait in the storage for the reclamation, Size counts the live ones
+void TestConcurrentSize() {
+    MultiIndexTable<LockPolicy::Concurrent, 8, Object, IndexConcurrentUnOrderedPredicate>
+    table(16, 4.f, IndexConcurrentUnOrderedPredicate());
+    for (int i = 0; i < 20; ++i) {
+        table.Insert(Object{i, std::to_string(i)});
+    }
+    
+    for (int i = 0; i < 10; ++i) {
+        EXPECT(table.Delete<0>(Object{i, std::to_string(i)}) == 1);
+    }
+    EXPECT(table.Size() == 10);
+}
+
+// Clear runs next to the erases waiting for the reclamation and next to the concurrent writers
+void TestConcurrentClear() {
+    constexpr int kWriters = 4;
+    constexpr int kKeys = 5000;
+    MultiIndexTable<LockPolicy::Concurrent, 8, Object, IndexKeyConcurrentUnOrderedPredicate, IndexKeyConcurrentOrderedPredicate>
+    table(16, 4.f, IndexKeyConcurrentUnOrderedPredicate(), IndexKeyConcurrentOrderedPredicate());
+    for (int i = 0; i < 20; ++i) {
+        table.Insert(Object{i, std::to_string(i)});
+    }
+
+    for (int i = 0; i < 10; ++i) {
+        EXPECT(table.Delete<0>(Object{i, ""}) == 1);
+    }
+    table.Clear();
+    EXPECT(table.Size() == 0);
+    EXPECT(table.FindAll<1>(Object{15, ""}).empty());
+
+    std::list<Object> objects;
+    for (int i = 0; i < 100; ++i) {
+        objects.push_back(Object{i, std::to_string(i)});
+    }
+    table.Load(std::move(objects));
+    EXPECT(table.Size() == 100);
+    EXPECT(table.FindAll<0>(Object{42, ""}).size() == 1 && table.FindAll<1>(Object{99, ""}).size() == 1);
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> writers;
+    for (int w = 0; w < kWriters; ++w) {
+        writers.emplace_back([&table, w]() {
+            for (int i = w * kKeys; i < (w + 1) * kKeys; ++i) {
+                table.Insert(Object{i, std::to_string(i)});
+                if (i % 3 == 0) {
+                    table.Delete<1>(Object{i, ""});
+                } else if (i % 3 == 1) {
+                    table.Update<0>(Object{i, ""}, Object{i, "u"});
+                }
+            }
+        });
+    }
+    std::thread clearer([&]() {
+        while (!stop.load()) {
+            table.Clear();
+        }
+    });
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    stop = true;
+    clearer.join();
+
+    // a survivor of the last Clear is in both indices
+    size_t survivors = 0;
+    for (int i = 0; i < kWriters * kKeys; ++i) {
+        auto found = table.FindAll<0>(Object{i, ""});
+        EXPECT(found.size() <= 1 && table.FindAll<1>(Object{i, ""}).size() == found.size());
+        survivors += found.size();
+    }
+    EXPECT(table.Size() == survivors);
+    table.Clear();
+    EXPECT(table.Size() == 0);
+}
+
+// the writers insert, delete and update their own keys while the readers look them up
+void TestConcurrentTable() {
+    constexpr int kWriters = 4;
+    constexpr int kReaders = 2;
+    constexpr int kKeys = 20000;
+    MultiIndexTable<LockPolicy::Concurrent, 8, Object, IndexKeyConcurrentUnOrderedPredicate, IndexConcurrentUnOrderedPredicate>
+    table(16, 4.f, IndexKeyConcurrentUnOrderedPredicate(), IndexConcurrentUnOrderedPredicate());
+    std::atomic<bool> stop{false};
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < kReaders; ++r) {
+        readers.emplace_back([&]() {
+            while (!stop.load()) {
+                for (int i = 0; i < kWriters * kKeys; i += 7) {
+                    // a found object is the inserted or the updated one
+                    auto found = table.FindFirst<0>(Object{i, ""});
+                    if (found && (found->i != i || (found->s != std::to_string(i) && found->s != "u" + std::to_string(i)))) {
+                        ++mismatches;
+                    }
+                }
+            }
+        });
+    }
+    
+    std::vector<std::thread> writers;
+    for (int w = 0; w < kWriters; ++w) {
+        writers.emplace_back([&table, w]() {
+            for (int i = w * kKeys; i < (w + 1) * kKeys; ++i) {
+                table.Insert(Object{i, std::to_string(i)});
+                if (i % 2 == 1) {
+                    table.Delete<0>(Object{i, ""});
+                } else if (i % 4 == 0) {
+                    table.Update<0>(Object{i, ""}, Object{i, "u" + std::to_string(i)});
+                }
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    stop = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    
+    EXPECT(mismatches == 0);
+    EXPECT(table.Size() == kWriters * kKeys / 2);
+    for (int i = 0; i < kWriters * kKeys; ++i) {
+        auto found = table.FindAll<0>(Object{i, ""});
+        EXPECT(found.size() == (i % 2 == 0 ? 1 : 0));
+        if (i % 4 == 0) {
+            EXPECT(found.front().s == "u" + std::to_string(i));
+            EXPECT(table.FindAll<1>(Object{i, std::to_string(i)}).empty());
+        } else if (i % 2 == 0) {
+            EXPECT(table.FindAll<1>(Object{i, std::to_string(i)}).size() == 1);
+        }
+    }
+}
+
+// the combined writers insert, delete and update their own keys, the writers that find
+// every slot busy while the combiner is held apply their operations under the lock
+void TestFlatCombining() {
+    constexpr int kWriters = 8;
+    constexpr int kKeys = 5000;
+    MultiIndexTable<LockPolicy::FlatCombining, 8, Object, IndexKeyUnOrderedPredicate, IndexKeyOrderedPredicate>
+    table(16, 4.f, IndexKeyUnOrderedPredicate(), IndexKeyOrderedPredicate());
+    std::vector<std::thread> writers;
+    for (int w = 0; w < kWriters; ++w) {
+        writers.emplace_back([&table, w]() {
+            for (int i = w * kKeys; i < (w + 1) * kKeys; ++i) {
+                table.Insert(Object{i, std::to_string(i)});
+                if (i % 2 == 1) {
+                    table.Delete<0>(Object{i, ""});
+                } else if (i % 4 == 0) {
+                    table.Update<1>(Object{i, ""}, Object{i, "u" + std::to_string(i)});
+                }
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+
+    EXPECT(table.Size() == kWriters * kKeys / 2);
+    for (int i = 0; i < kWriters * kKeys; ++i) {
+        auto found = table.FindAll<0>(Object{i, ""});
+        EXPECT(found.size() == (i % 2 == 0 ? 1 : 0));
+        EXPECT(table.FindAll<1>(Object{i, ""}).size() == found.size());
+        if (i % 4 == 0) {
+            EXPECT(found.front().s == "u" + std::to_string(i));
+        }
+    }
+
+    // more writers than slots pile up behind the held combiner
+    constexpr int kPiled = 80;
+    table.Clear();
+    HoldingObserver observer;
+    table.Attach(observer);
+    std::thread holder([&table]() { table.Insert(Object{-1, "held"}); });
+    while (!observer.held.load()) {
+        std::this_thread::yield();
+    }
+
+    writers.clear();
+    for (int w = 0; w < kPiled; ++w) {
+        writers.emplace_back([&table, w]() { table.Insert(Object{w, std::to_string(w)}); });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    observer.released = true;
+    holder.join();
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    table.Detach(observer);
+
+    EXPECT(table.Size() == kPiled + 1);
+    EXPECT(table.FindAll<1>(Object{-1, ""}).size() == 1);
+    for (int w = 0; w < kPiled; ++w) {
+        EXPECT(table.FindAll<0>(Object{w, ""}).size() == 1);
+    }
+}
+
+// the readers page through the skip list in order while the writers insert, delete and update
+void TestConcurrentOrdered() {
+    constexpr int kWriters = 4;
+    constexpr int kReaders = 2;
+    constexpr int kKeys = 10000;
+    MultiIndexTable<LockPolicy::Concurrent, 8, Object, IndexKeyConcurrentUnOrderedPredicate, IndexKeyConcurrentOrderedPredicate>
+    table(16, 4.f, IndexKeyConcurrentUnOrderedPredicate(), IndexKeyConcurrentOrderedPredicate());
+    std::atomic<bool> stop{false};
+    std::atomic<int> unordered{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < kReaders; ++r) {
+        readers.emplace_back([&table, &stop, &unordered, r]() {
+            while (!stop.load()) {
+                auto cursor = table.SeekFirst<1>(r == 1);
+                int last = r == 1 ? std::numeric_limits<int>::max() : -1;
+                for (auto page = table.Next<1>(cursor, 64); !page.empty(); page = table.Next<1>(cursor, 64)) {
+                    for (const auto& object : page) {
+                        if (r == 1 ? object.i > last : object.i < last) {
+                            ++unordered;
+                        }
+                        last = object.i;
+                    }
+                }
+            }
+        });
+    }
+    
+    std::vector<std::thread> writers;
+    for (int w = 0; w < kWriters; ++w) {
+        writers.emplace_back([&table, w]() {
+            for (int i = w; i < kWriters * kKeys; i += kWriters) { // interleaved keys
+                table.Insert(Object{i, std::to_string(i)});
+                if (i % 3 == 0) {
+                    table.Delete<1>(Object{i, ""});
+                } else if (i % 3 == 1) {
+                    table.Update<1>(Object{i, ""}, Object{i, "u"});
+                }
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    stop = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    
+    EXPECT(unordered == 0);
+    auto cursor = table.SeekFirst<1>();
+    auto all = table.Next<1>(cursor, kWriters * kKeys);
+    EXPECT(all.size() == table.Size());
+    int expected = 1;
+    for (const auto& object : all) {
+        EXPECT(object.i == expected);
+        EXPECT(object.s == (expected % 3 == 1 ? "u" : std::to_string(expected)));
+        EXPECT(table.FindAll<0>(object).size() == 1);
+        expected += expected % 3 == 1 ? 1 : 2;
+    }
+    
+    size_t ranged = 0;
+    table.FindRange<1>([&ranged](const Object&) { ++ranged; }, Object{100, ""}, Object{199, ""});
+    EXPECT(ranged == 67);
+}
+
+// a split bucket joins the tree as a leaf, so the red-black rebalancing keeps the height logarithmic
+void TestOrderedSplit() {
+    constexpr int kItems = 200000;
+    MultiIndexTable<LockPolicy::Internal, 8, Object, IndexOrderedPredicate>
+    table(16, 4.f, IndexOrderedPredicate());
+    std::srand(7);
+    for (int i = 0; i < kItems; ++i) {
+        auto v = std::rand() % kItems;
+        table.Insert(Object{v, std::to_string(v)});
+    }
+    
+    auto stats = table.Tune()[0];
+    EXPECT(stats.items == kItems);
+    EXPECT(stats.depth <= size_t(2 * std::log2(double(stats.buckets + 1)) + 1));
+}
+
+// the range delete on a deferred index removes the pending objects in the range too
+void TestDeferredDeleteRange() {
+    MultiIndexTable<LockPolicy::Internal, 8, Object, IndexUnOrderedPredicate, IndexOrderedPredicate>
+    table(16, 4.f, IndexUnOrderedPredicate(), IndexOrderedPredicate());
+    table.SetDeferred<1>(true);
+    for (int i = 0; i < 10; ++i) {
+        table.Insert(Object{i, std::to_string(i)});
+    }
+    
+    EXPECT(table.DeleteRange<1>(Object{2, "2"}, Object{5, "5"}) == 4);
+    EXPECT(table.Size() == 6);
+    EXPECT(table.FindAll<0>(Object{3, "3"}).empty());
+    EXPECT(table.FindAll<1>(Object{3, "3"}).empty());
+    
+    // a part of the range is applied, a part is pending
+    table.Sync<1>();
+    for (int i = 10; i < 20; ++i) {
+        table.Insert(Object{i, std::to_string(i)});
+    }
+    EXPECT(table.DeleteRange<1>(Object{8, "8"}, Object{15, "15"}) == 8);
+    EXPECT(table.Size() == 8);
+    EXPECT(table.FindAll<0>(Object{12, "12"}).empty());
+    EXPECT(table.FindAll<0>(Object{16, "16"}).size() == 1);
+    EXPECT(table.FindAll<1>(Object{16, "16"}).size() == 1);
+    EXPECT(table.FindAll<1>(Object{9, "9"}).empty());
+}
+
+// a lowered capacity reaches the existing buckets on Compact
+void TestTuneCompact() {
+    constexpr int kItems = 20000;
+    MultiIndexTable<LockPolicy::Internal, 256, Object, IndexOrderedPredicate>
+    table(16, 4.f, IndexOrderedPredicate());
+    table.SetTuning(true);
+    for (int i = 0; i < kItems; ++i) { // appended, so the buckets are full
+        table.Insert(Object{i, std::to_string(i)});
+    }
+    
+    auto stats = table.Tune(true)[0];
+    EXPECT(stats.recommended < 256);
+    table.Compact(1.f);
+    stats = table.Tune()[0];
+    EXPECT(stats.items == kItems);
+    EXPECT(stats.buckets >= (kItems + stats.capacity - 1) / stats.capacity);
+    EXPECT(stats.depth <= size_t(2 * std::log2(double(stats.buckets + 1)) + 1));
+    
+    auto cursor = table.SeekFirst<0>();
+    auto page = table.Next<0>(cursor, kItems);
+    EXPECT(page.size() == kItems);
+    int expected = 0;
+    for (const auto& object : page) {
+        EXPECT(object.i == expected++);
+    }
+    EXPECT(table.FindAll<0>(Object{12345, "12345"}).size() == 1);
+}
+
+// the predicate capacities are the compile time and the runtime capacities of their indices,
+// the adopted capacities never exceed them
+void TestIndexCapacity() {
+    constexpr int kItems = 1000;
+    MultiIndexTable<LockPolicy::Internal, 8, Object, IndexNarrowUnOrderedPredicate, IndexWideOrderedPredicate, IndexOrderedPredicate>
+    table(16, 4.f, IndexNarrowUnOrderedPredicate(), IndexWideOrderedPredicate(), IndexOrderedPredicate());
+    table.SetTuning(true);
+    for (int i = 0; i < kItems; ++i) { // appended, so the ordered buckets are full
+        table.Insert(Object{i, std::to_string(i)});
+    }
+    
+    auto stats = table.Tune();
+    EXPECT(stats[0].capacity == 2 && stats[1].capacity == 32 && stats[2].capacity == 8);
+    EXPECT(stats[1].buckets == (kItems + 31) / 32 && stats[2].buckets == (kItems + 7) / 8);
+    EXPECT(stats[0].slots >= kItems);
+    
+    for (int i = 0; i < kItems; ++i) { // a read only workload asks for the largest buckets
+        EXPECT(table.FindFirst<1>(Object{i, ""}).has_value());
+        EXPECT(table.FindFirst<2>(Object{i, std::to_string(i)}).has_value());
+    }
+    stats = table.Tune(true);
+    EXPECT(stats[0].recommended == 2 && stats[1].recommended == 32 && stats[2].recommended == 8);
+    stats = table.Tune();
+    EXPECT(stats[0].capacity == 2 && stats[1].capacity == 32 && stats[2].capacity == 8);
+}
+
+// the objects of the equal keys are erased and updated by their back references
+void TestEqualKeys() {
+    constexpr int kItems = 4000;
+    MultiIndexTable<LockPolicy::Internal, 8, Object, IndexHashedOrderedPredicate, IndexKeyOrderedPredicate, IndexKeyUnOrderedPredicate>
+    table(16, 4.f, IndexHashedOrderedPredicate(), IndexKeyOrderedPredicate(), IndexKeyUnOrderedPredicate());
+    for (int i = 0; i < kItems; ++i) {
+        table.Insert(Object{i % 4, std::to_string(i)});
+    }
+    
+    for (int i = 0; i < kItems; i += 2) {
+        EXPECT(table.Delete<0>(Object{i % 4, std::to_string(i)}) == 1);
+    }
+    EXPECT(table.Size() == kItems / 2);
+    EXPECT(table.FindAll<1>(Object{0, ""}).empty());
+    EXPECT(table.FindAll<2>(Object{2, ""}).empty());
+    EXPECT(table.FindAll<1>(Object{1, ""}).size() == kItems / 4);
+    EXPECT(table.FindAll<2>(Object{3, ""}).size() == kItems / 4);
+    
+    for (int i = 1; i < kItems; i += 4) {
+        EXPECT(table.Update<0>(Object{1, std::to_string(i)}, Object{0, std::to_string(i)}));
+    }
+    EXPECT(table.FindAll<1>(Object{0, ""}).size() == kItems / 4);
+    EXPECT(table.FindAll<2>(Object{0, ""}).size() == kItems / 4);
+    EXPECT(table.FindAll<1>(Object{1, ""}).empty());
+    
+    for (int i = 1; i < kItems; i += 2) {
+        EXPECT(table.Delete<0>(Object{i % 4 == 1 ? 0 : 3, std::to_string(i)}) == 1);
+    }
+    EXPECT(table.Size() == 0);
+    EXPECT(table.FindAll<1>(Object{3, ""}).empty());
+    EXPECT(table.FindAll<2>(Object{0, ""}).empty());
+}
+
+// the compaction resumes past the buckets of the equal keys compacted already
+void TestCompactEqualKeys() {
+    constexpr int kItems = 20000;
+    MultiIndexTable<LockPolicy::Internal, 8, Object, IndexHashedOrderedPredicate, IndexKeyOrderedPredicate>
+    table(16, 4.f, IndexHashedOrderedPredicate(), IndexKeyOrderedPredicate());
+    for (int i = 0; i < kItems; ++i) {
+        table.Insert(Object{i % 2, std::to_string(i)});
+    }
+    for (int i = 0; i < kItems; i += 4) { // underfilled buckets
+        EXPECT(table.Delete<0>(Object{0, std::to_string(i)}) == 1);
+    }
+    
+    table.Compact(1.f);
+    auto stats = table.Tune()[1];
+    EXPECT(stats.items == kItems * 3 / 4);
+    EXPECT(stats.buckets <= (stats.items + stats.capacity - 1) / stats.capacity + 2);
+    EXPECT(table.FindAll<1>(Object{0, ""}).size() == kItems / 4);
+    EXPECT(table.FindAll<1>(Object{1, ""}).size() == kItems / 2);
+}
+
+// Rank, Nth and Count of the ranked index match a sorted copy of the keys after the bucket splits,
+// the deletes, the merges of Compact, Freeze and Thaw
+void TestRanked() {
+    MultiIndexTable<LockPolicy::Internal, 4, Object, IndexNameUnOrderedPredicate, IndexKeyRankedPredicate>
+    table(16, 4.f, IndexNameUnOrderedPredicate(), IndexKeyRankedPredicate());
+    std::vector<Object> objects;
+    std::srand(11);
+    auto check = [&table, &objects]() {
+        std::vector<int> keys;
+        for (const auto& object : objects) {
+            keys.push_back(object.i);
+        }
+        std::sort(keys.begin(), keys.end());
+        EXPECT(table.Size() == keys.size());
+        for (int key = -1; key <= 501; ++key) {
+            const size_t rank = std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+            EXPECT(table.Rank<1>(Object{key, ""}) == rank);
+            const int hi = key + std::rand() % 50 - 10;
+            const size_t count = std::upper_bound(keys.begin(), keys.end(), hi) - keys.begin();
+            EXPECT(table.Count<1>(Object{key, ""}, Object{hi, ""}) == (count > rank ? count - rank : 0));
+        }
+        for (size_t k = 0; k < keys.size(); ++k) {
+            EXPECT(table.Nth<1>(k)->i == keys[k]);
+        }
+        EXPECT(!table.Nth<1>(keys.size()).has_value());
+    };
+    
+    int serial = 0;
+    for (int i = 0; i < 4000; ++i) { // random keys split the buckets
+        objects.push_back(Object{std::rand() % 500, std::to_string(serial++)});
+        table.Insert(Object(objects.back()));
+    }
+    check();
+    
+    for (size_t i = 0; i < objects.size();) { // every third object, the emptied buckets leave the tree
+        if (std::rand() % 3 == 0) {
+            EXPECT(table.Delete<0>(objects[i]) == 1);
+            objects[i] = objects.back();
+            objects.pop_back();
+        } else {
+            ++i;
+        }
+    }
+    check();
+    
+    const size_t buckets = table.Tune()[1].buckets;
+    table.Compact(1.f); // merges the underfilled buckets
+    EXPECT(table.Tune()[1].buckets < buckets);
+    check();
+    
+    table.Freeze(); // rebuilt as a complete tree
+    check();
+    table.Thaw();
+    check();
+    
+    for (int i = 0; i < 1000; ++i) {
+        objects.push_back(Object{std::rand() % 500, std::to_string(serial++)});
+        table.Insert(Object(objects.back()));
+    }
+    for (int i = 0; i < 500; ++i) {
+        EXPECT(table.Delete<0>(objects.back()) == 1);
+        objects.pop_back();
+    }
+    check();
+}
+
+// pages of 3 through the equal keys of index 1, the visited objects are deleted after the first page,
+// the cursor returns every remaining object once in both directions
+template<typename Table>
+void PageEqualKeys(Table& table, const std::vector<Object>& objects) {
+    for (bool reverse : {false, true}) {
+        for (const auto& object : objects) {
+            table.Insert(Object(object));
+        }
+        
+        auto cursor = table.template SeekFirst<1>(reverse);
+        auto page = table.template Next<1>(cursor, 3);
+        std::vector<Object> first(page.begin(), page.end());
+        EXPECT(first.size() == 3);
+        EXPECT(table.template Delete<0>(first[0]) == 1 && table.template Delete<0>(first[2]) == 1);
+        
+        std::vector<Object> seen = {first[1]};
+        for (page = table.template Next<1>(cursor, 3); !page.empty(); page = table.template Next<1>(cursor, 3)) {
+            seen.insert(seen.end(), page.begin(), page.end());
+        }
+        EXPECT(cursor.IsEnd());
+        
+        auto found = table.template FindAll<1>(objects.front());
+        std::vector<Object> survivors(found.begin(), found.end());
+        std::sort(seen.begin(), seen.end());
+        std::sort(survivors.begin(), survivors.end());
+        EXPECT(seen.size() == objects.size() - 2 && seen == survivors);
+        table.Clear();
+    }
+}
+
+// the cursor position is unique among the equal keys of the ordered, radix and concurrent ordered indices
+void TestCursorEqualKeys() {
+    std::vector<Object> keys, names;
+    for (int i = 0; i < 10; ++i) {
+        keys.push_back(Object{5, std::to_string(i)});
+        names.push_back(Object{i, "same"});
+    }
+    
+    MultiIndexTable<LockPolicy::Internal, 4, Object, IndexUnOrderedPredicate, IndexKeyOrderedPredicate>
+    ordered(16, 4.f, IndexUnOrderedPredicate(), IndexKeyOrderedPredicate());
+    PageEqualKeys(ordered, keys);
+    MultiIndexTable<LockPolicy::Internal, 4, Object, IndexUnOrderedPredicate, IndexNameRadixPredicate>
+    radix(16, 4.f, IndexUnOrderedPredicate(), IndexNameRadixPredicate());
+    PageEqualKeys(radix, names);
+    MultiIndexTable<LockPolicy::Concurrent, 4, Object, IndexConcurrentUnOrderedPredicate, IndexKeyConcurrentOrderedPredicate>
+    concurrent(16, 4.f, IndexConcurrentUnOrderedPredicate(), IndexKeyConcurrentOrderedPredicate());
+    PageEqualKeys(concurrent, keys);
+}
+
+// the view follows the inserts, deletes, updates and Clear, an attached view receives the current objects
+void TestAggregateView() {
+    MultiIndexTable<LockPolicy::Internal, 8, Object, IndexKeyUnOrderedPredicate, IndexKeyOrderedPredicate>
+    table(16, 4.f, IndexKeyUnOrderedPredicate(), IndexKeyOrderedPredicate());
+    AggregateView<Object, GroupOf, ValueOf> view;
+    table.Attach(view);
+    for (int i = 0; i < 100; ++i) {
+        table.Insert(Object{i, std::to_string(i)});
+    }
+    
+    EXPECT(view.Groups() == 10);
+    auto three = view.Get(3);
+    EXPECT(three && three->count == 10 && three->sum == 480 && three->min == 3 && three->max == 93);
+    
+    EXPECT(table.Delete<0>(Object{93, ""}) == 1);
+    EXPECT(table.Update<1>(Object{3, ""}, Object{5, "5"}));
+    three = view.Get(3);
+    EXPECT(three && three->count == 8 && three->sum == 384 && three->min == 13 && three->max == 83);
+    auto five = view.Get(5);
+    EXPECT(five && five->count == 11 && five->sum == 505 && five->min == 5 && five->max == 95);
+    
+    AggregateView<Object, GroupOf, ValueOf> late;
+    table.Attach(late);
+    EXPECT(late.Groups() == 10);
+    EXPECT(late.Get(5)->count == 11);
+    table.Detach(late);
+    
+    table.Insert(Object{200, "200"});
+    EXPECT(view.Get(0)->count == 11);
+    EXPECT(late.Get(0)->count == 10);
+    table.Clear();
+    EXPECT(view.Groups() == 0);
+    EXPECT(!view.Get(0));
+}
+
+// the reader mapping of the segment sees the writer mutations and can't mutate itself
+void TestSharedTable() {
+    using SharedTable = SharedMultiIndexTable<Quote, QuoteIdPredicate, QuotePricePredicate>;
+    SharedTable writer("/multiindex_test", SharedMode::Create, 1000, QuoteIdPredicate(), QuotePricePredicate());
+    EXPECT(writer.IsValid());
+    for (int id = 0; id < 1000; ++id) {
+        EXPECT(writer.Insert(Quote{id, id % 50}));
+    }
+    EXPECT(!writer.Insert(Quote{1000, 0})); // full
+    
+    SharedTable reader("/multiindex_test", SharedMode::Open, 0, QuoteIdPredicate(), QuotePricePredicate());
+    EXPECT(reader.IsValid());
+    EXPECT(reader.Size() == 1000);
+    auto quote = reader.FindFirst<0>(Quote{7, 0});
+    EXPECT(quote && quote->price == 7);
+    EXPECT(reader.FindAll<1>(Quote{0, 7}).size() == 20);
+    EXPECT(!reader.Insert(Quote{2000, 0}));
+    
+    EXPECT(writer.Delete<0>(Quote{7, 0}) == 1);
+    EXPECT(writer.Update<0>(Quote{8, 0}, Quote{8, 100}));
+    EXPECT(!reader.FindFirst<0>(Quote{7, 0}));
+    EXPECT(reader.FindAll<1>(Quote{0, 7}).size() == 19);
+    EXPECT(reader.FindAll<1>(Quote{0, 100}).size() == 1);
+    EXPECT(writer.Insert(Quote{1000, 0})); // the deleted slot is reused
+    
+    // other predicates, other layout
+    SharedMultiIndexTable<Quote, QuoteIdPredicate> other("/multiindex_test", SharedMode::Open, 0, QuoteIdPredicate());
+    EXPECT(!other.IsValid());
+    
+    writer.Clear();
+    EXPECT(reader.Size() == 0);
+    EXPECT(!reader.FindFirst<0>(Quote{8, 0}));
+}
+
+// the histogram buckets hold their values, the table metrics count the operations
+// when MULTIINDEX_INSTRUMENTATION is defined and stay zero otherwise
+void TestInstrumentation() {
+    for (uint64_t value = 0; value < 5000; ++value) {
+        const size_t bucket = LatencyHistogram::BucketOf(value);
+        EXPECT(LatencyHistogram::LowerBound(bucket) <= value && value < LatencyHistogram::LowerBound(bucket + 1));
+    }
+    LatencyHistogram histogram;
+    for (uint64_t value = 1; value <= 1000; ++value) {
+        histogram.Record(value);
+    }
+    auto snapshot = histogram.Get();
+    EXPECT(snapshot.count == 1000 && snapshot.max == 1000 && snapshot.Mean() == 500);
+    EXPECT(snapshot.Percentile(50) >= 500 && snapshot.Percentile(50) <= 640);
+    EXPECT(snapshot.Percentile(99) >= 990 && snapshot.Percentile(99) <= 1000);
+    
+    constexpr int kItems = 10000;
+    MultiIndexTable<LockPolicy::Internal, 8, Object, IndexKeyUnOrderedPredicate, IndexKeyOrderedPredicate>
+    table(16, 4.f, IndexKeyUnOrderedPredicate(), IndexKeyOrderedPredicate());
+    // scattered keys, the ascending ones would be appended without the splits
+    for (int i = 0; i < kItems; ++i) {
+        const int key = i * 7919 % kItems;
+        table.Insert(Object{key, std::to_string(key)});
+    }
+    for (int i = 0; i < 100; ++i) {
+        table.FindFirst<0>(Object{i, ""});
+    }
+    for (int i = 0; i < kItems; i += 2) {
+        table.Delete<1>(Object{i, ""});
+    }
+    
+    auto metrics = table.GetMetrics();
+#if defined(MULTIINDEX_INSTRUMENTATION)
+    EXPECT(metrics.operations[size_t(TableOperation::Insert)].count == kItems);
+    EXPECT(metrics.operations[size_t(TableOperation::Find)].count == 100);
+    EXPECT(metrics.operations[size_t(TableOperation::Delete)].count == kItems / 2);
+    EXPECT(metrics.indices[0].latency.count == 100 && metrics.indices[1].latency.count == kItems / 2);
+    EXPECT(metrics.indices[0].rehashes > 0 && metrics.indices[1].rehashes == 0);
+    EXPECT(metrics.indices[1].splits > 0 && metrics.indices[0].splits == 0);
+    table.ResetMetrics();
+    metrics = table.GetMetrics();
+#endif
+    EXPECT(metrics.operations[size_t(TableOperation::Insert)].count == 0);
+    EXPECT(metrics.indices[0].rehashes == 0 && metrics.indices[1].splits == 0);
+}
+
+// the radix index keeps the names in the byte order, the prefix and the range searches
+// and the cursors visit the matches in that order
+void TestRadix() {
+    const std::vector<std::string> names = {"band", "apple", "", "bandana", "apricot", "banana", "band", "cherry"};
+    MultiIndexTable<LockPolicy::Internal, 8, Object, IndexKeyUnOrderedPredicate, IndexNameRadixPredicate>
+    table(16, 4.f, IndexKeyUnOrderedPredicate(), IndexNameRadixPredicate());
+    for (int i = 0; i < int(names.size()); ++i) {
+        table.Insert(Object{i, names[i]});
+    }
+    
+    auto sorted = names;
+    std::sort(sorted.begin(), sorted.end());
+    auto all = table.FindByPrefix<1>("");
+    EXPECT(std::equal(all.begin(), all.end(), sorted.begin(), sorted.end(),
+                      [](const Object& object, const std::string& name) { return object.s == name; }));
+    EXPECT(table.FindByPrefix<1>("ap").size() == 2);
+    EXPECT(table.FindByPrefix<1>("band").size() == 3);
+    EXPECT(table.FindByPrefix<1>("bandanas").empty());
+    EXPECT(table.FindAll<1>(Object{0, "band"}).size() == 2);
+    EXPECT(table.FindAll<1>(Object{0, "ban"}).empty());
+    
+    size_t ranged = 0;
+    table.FindRange<1>([&ranged](const Object& object) { ranged += object.s.compare(0, 2, "ba") == 0; }, Object{0, "b"}, Object{0, "bandana"});
+    EXPECT(ranged == 4);
+    
+    auto cursor = table.SeekFirst<1>(true);
+    std::vector<std::string> reversed;
+    for (auto page = table.Next<1>(cursor, 3); !page.empty(); page = table.Next<1>(cursor, 3)) {
+        for (const auto& object : page) {
+            reversed.push_back(object.s);
+        }
+    }
+    EXPECT(std::equal(reversed.begin(), reversed.end(), sorted.rbegin(), sorted.rend()));
+    
+    auto seek = table.Seek<1>(Object{0, "bananas"});
+    auto next = table.Next<1>(seek, 1);
+    EXPECT(next.size() == 1 && next.front().s == "band");
+    
+    EXPECT(table.Update<0>(Object{1, ""}, Object{1, "bandit"}));
+    EXPECT(table.Delete<0>(Object{0, ""}) == 1);
+    EXPECT(table.FindByPrefix<1>("ap").size() == 1);
+    EXPECT(table.FindByPrefix<1>("band").size() == 3);
+    EXPECT(table.FindByPrefix<1>("bandi").front().i == 1);
+}
+
+// the spatial index finds the grid points inside a box and the nearest ones, the nearest first
+void TestSpatial() {
+    MultiIndexTable<LockPolicy::Internal, 8, Object, IndexKeyUnOrderedPredicate, IndexGridSpatialPredicate>
+    table(16, 4.f, IndexKeyUnOrderedPredicate(), IndexGridSpatialPredicate());
+    for (int i = 0; i < 10000; ++i) {
+        table.Insert(Object{i, std::to_string(i)});
+    }
+    
+    SpatialBox<2> box{{10, 30}, {20, 35}};
+    auto inside = table.FindInBox<1>(box);
+    EXPECT(inside.size() == 11 * 6);
+    for (const auto& object : inside) {
+        EXPECT(object.i % 100 >= 10 && object.i % 100 <= 20 && object.i / 100 >= 30 && object.i / 100 <= 35);
+    }
+    
+    // the squared distances 0.05, 0.65, 0.85 and 1.25
+    auto nearest = table.FindNearest<1>(SpatialPoint<2>{50.2, 49.9}, 4);
+    std::vector<int> expected = {5050, 5051, 4950, 5150};
+    std::vector<int> found;
+    for (const auto& object : nearest) {
+        found.push_back(object.i);
+    }
+    EXPECT(found == expected);
+    
+    EXPECT(table.Delete<0>(Object{3015, ""}) == 1);
+    EXPECT(table.FindInBox<1>(box).size() == 11 * 6 - 1);
+    EXPECT(table.Update<0>(Object{5050, ""}, Object{5050, "moved"}));
+    EXPECT(table.FindNearest<1>(SpatialPoint<2>{50.2, 49.9}, 1).front().s == "moved");
+}
+
+// the roaring bitmaps combine by AND, OR and NOT, the bitmap indices keep them in step with the writes
+void TestBitmap() {
+    RoaringBitmap evens, threes;
+    for (uint32_t value = 0; value < 200000; value += 2) {
+        EXPECT(evens.Add(value));
+    }
+    for (uint32_t value = 0; value < 200000; value += 3) {
+        EXPECT(threes.Add(value));
+    }
+    EXPECT(!evens.Add(4) && evens.Contains(4) && !evens.Contains(5));
+    EXPECT(evens.Cardinality() == 100000 && threes.Cardinality() == 66667);
+    EXPECT((evens & threes).Cardinality() == 33334);
+    EXPECT((evens | threes).Cardinality() == 133333);
+    EXPECT((evens - threes).Cardinality() == 66666);
+    EXPECT(evens.Remove(0) && !evens.Remove(0) && evens.Minimum() == 2);
+    
+    MultiIndexTable<LockPolicy::Internal, 8, Object, IndexKeyUnOrderedPredicate, IndexColorBitmapPredicate, IndexSizeBitmapPredicate>
+    table(16, 4.f, IndexKeyUnOrderedPredicate(), IndexColorBitmapPredicate(), IndexSizeBitmapPredicate());
+    for (int i = 0; i < 4000; ++i) {
+        table.Insert(Object{i, std::to_string(i)});
+    }
+    
+    const Object what{3 + 8 * 4, ""}; // i % 8 == 3, i % 5 == 0
+    auto both = table.FindByBitmap([&what](const auto& b) { return b.template Of<1>(what) & b.template Of<2>(what); });
+    EXPECT(both.size() == 100);
+    for (const auto& object : both) {
+        EXPECT(object.i % 40 == 35);
+    }
+    EXPECT(table.FindByBitmap([&what](const auto& b) { return b.template Of<1>(what) | b.template Of<2>(what); }).size() == 1200);
+    EXPECT(table.FindByBitmap([&what](const auto& b) { return b.All() - b.template Of<1>(what); }).size() == 3500);
+    
+    EXPECT(table.Delete<0>(Object{35, ""}) == 1);
+    EXPECT(table.Update<0>(Object{75, ""}, Object{76, "76"}));
+    both = table.FindByBitmap([&what](const auto& b) { return b.template Of<1>(what) & b.template Of<2>(what); });
+    EXPECT(both.size() == 98);
+    EXPECT(table.FindAll<2>(what).size() == 798);
+}
+
+// the result cache answers the repeated lookups, any write to the index invalidates it
+void TestResultCache() {
+    MultiIndexTable<LockPolicy::Internal, 8, Object, IndexKeyUnOrderedPredicate, IndexKeyOrderedPredicate>
+    table(16, 4.f, IndexKeyUnOrderedPredicate(), IndexKeyOrderedPredicate());
+    for (int i = 0; i < 100; ++i) {
+        table.Insert(Object{i % 10, std::to_string(i)});
+    }
+    table.SetResultCache<0>(4);
+    
+    const Object three{3, ""};
+    EXPECT(table.FindAll<0>(three).size() == 10);
+    EXPECT(table.FindAll<0>(three).size() == 10);
+    EXPECT(table.FindFirst<0>(three)->i == 3);
+    auto stats = table.GetResultCacheStats<0>();
+    EXPECT(stats.misses == 1 && stats.hits == 2 && stats.entries == 4);
+    
+    table.Insert(Object{3, "new"});
+    EXPECT(table.FindAll<0>(three).size() == 11);
+    EXPECT(table.Update<1>(three, Object{4, "moved"}));
+    EXPECT(table.FindAll<0>(three).empty());
+    EXPECT(table.FindAll<0>(Object{4, ""}).size() == 21);
+    stats = table.GetResultCacheStats<0>();
+    EXPECT(stats.misses == 4 && stats.hits == 2);
+    
+    EXPECT(table.GetResultCacheStats<1>().hits == 0 && table.GetResultCacheStats<1>().misses == 0);
+    table.SetResultCache<0>(0);
+    EXPECT(table.FindAll<0>(three).empty());
+    EXPECT(table.GetResultCacheStats<0>().misses == 0);
+}
+
+// the cache mode evicts the objects over the object and byte limits by CLOCK, the objects read since
+// the last pass survive it, the expired objects are hidden from the reads and purged by Expire
+void TestCache() {
+    using Table = MultiIndexTable<LockPolicy::Internal, 8, Object, IndexKeyUnOrderedPredicate, IndexKeyOrderedPredicate>;
+    size_t evicted = 0;
+    {
+        Table table(16, 4.f, IndexKeyUnOrderedPredicate(), IndexKeyOrderedPredicate());
+        Table::CacheOptions options;
+        options.maxObjects = 10;
+        options.onEvict = [&evicted](const Object&) { ++evicted; };
+        table.SetCacheOptions(std::move(options));
+        for (int i = 0; i < 10; ++i) {
+            table.Insert(Object{i, std::to_string(i)});
+        }
+        for (int i = 0; i < 5; ++i) {
+            EXPECT(table.FindFirst<0>(Object{i, ""}).has_value());
+        }
+        
+        for (int i = 10; i < 15; ++i) { // the hand passes over the referenced objects
+            table.Insert(Object{i, std::to_string(i)});
+        }
+        EXPECT(table.Size() == 10 && evicted == 5);
+        for (int i = 0; i < 15; ++i) {
+            EXPECT(table.FindFirst<1>(Object{i, ""}).has_value() == (i < 5 || i >= 10));
+        }
+    }
+    
+    {
+        Table table(16, 4.f, IndexKeyUnOrderedPredicate(), IndexKeyOrderedPredicate());
+        for (int i = 0; i < 20; ++i) {
+            table.Insert(Object{i, std::string(size_t(i % 2 + 1), 'x')});
+        }
+        Table::CacheOptions options;
+        options.maxBytes = 20;
+        options.sizeOf = [](const Object& object) { return object.s.size(); };
+        options.onEvict = [&evicted](const Object&) { ++evicted; };
+        evicted = 0;
+        table.SetCacheOptions(std::move(options)); // applied to the stored objects
+        EXPECT(table.Size() == 13 && evicted == 7);
+        table.Insert(Object{20, "xxxx"});
+        size_t bytes = 0;
+        table.FindRange<1>([&bytes](const Object& object) { bytes += object.s.size(); }, Object{0, ""}, Object{20, ""});
+        EXPECT(bytes <= 20 && table.FindFirst<0>(Object{20, ""}).has_value());
+    }
+    
+    {
+        Table table(16, 4.f, IndexKeyUnOrderedPredicate(), IndexKeyOrderedPredicate());
+        Table::CacheOptions options;
+        options.ttl = std::chrono::milliseconds(20);
+        options.onEvict = [&evicted](const Object&) { ++evicted; };
+        evicted = 0;
+        table.SetCacheOptions(std::move(options));
+        for (int i = 0; i < 10; ++i) {
+            table.Insert(Object{i, std::to_string(i)});
+        }
+        table.Insert(Object{10, "10"}, std::chrono::milliseconds(60000));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        
+        EXPECT(!table.FindFirst<0>(Object{3, ""}).has_value() && table.FindAll<1>(Object{3, ""}).empty());
+        EXPECT(table.FindFirst<0>(Object{10, ""}).has_value());
+        EXPECT(table.Size() == 11); // counted until purged
+        EXPECT(table.Expire() == 10 && evicted == 10);
+        EXPECT(table.Size() == 1 && table.Expire() == 0);
+    }
+}
+
+// the deferred index applies its pending inserts before it is read or written through,
+// the reads see the same objects as without the deferral
+void TestDeferred() {
+    MultiIndexTable<LockPolicy::Internal, 8, Object, IndexKeyUnOrderedPredicate, IndexKeyOrderedPredicate>
+    table(16, 4.f, IndexKeyUnOrderedPredicate(), IndexKeyOrderedPredicate());
+    table.SetDeferred<1>(true);
+    for (int i = 0; i < 1000; ++i) {
+        const int key = i * 7919 % 1000;
+        table.Insert(Object{key, std::to_string(key)});
+    }
+    
+    EXPECT(table.FindFirst<1>(Object{500, ""})->s == "500");
+    size_t ranged = 0;
+    table.FindRange<1>([&ranged](const Object&) { ++ranged; }, Object{100, ""}, Object{199, ""});
+    EXPECT(ranged == 100);
+    
+    // the writes through the other index reach the pending objects without applying the log
+    for (int i = 1000; i < 1100; ++i) {
+        table.Insert(Object{i, std::to_string(i)});
+    }
+    EXPECT(table.Delete<0>(Object{1050, ""}) == 1);
+    EXPECT(table.Update<0>(Object{1060, ""}, Object{5, "moved"}));
+    EXPECT(table.Delete<0>(Object{1099, ""}) == 1 && table.Delete<0>(Object{1000, ""}) == 1);
+    EXPECT(table.Tune()[1].items == 1000);
+    EXPECT(table.FindAll<1>(Object{1099, ""}).empty() && table.FindAll<1>(Object{1000, ""}).empty());
+    EXPECT(table.Tune()[1].items == 1097);
+    table.Insert(Object{1000, "1000"});
+    EXPECT(table.FindAll<1>(Object{1050, ""}).empty() && table.FindAll<1>(Object{1060, ""}).empty());
+    EXPECT(table.FindAll<1>(Object{5, ""}).size() == 2);
+    
+    for (int i = 1100; i < 1200; ++i) {
+        table.Insert(Object{i, std::to_string(i)});
+    }
+    table.Sync<1>();
+    auto cursor = table.SeekFirst<1>();
+    auto all = table.Next<1>(cursor, 2000);
+    EXPECT(all.size() == table.Size() && all.size() == 1198);
+    EXPECT(std::is_sorted(all.begin(), all.end(), [](const Object& x, const Object& y) { return x.i < y.i; }));
+    
+    table.Insert(Object{2000, "2000"});
+    table.SetDeferred<1>(false);
+    EXPECT(table.FindAll<1>(Object{2000, ""}).size() == 1);
+    EXPECT(table.Delete<1>(Object{2000, ""}) == 1);
+    EXPECT(table.Size() == 1198);
+}
+
+// the grouped indices find, delete and move the objects of a key as one posting list,
+// an object leaves the middle of its list without a scan
+void TestGrouped() {
+    MultiIndexTable<LockPolicy::Internal, 8, Object, IndexNameUnOrderedPredicate, IndexKeyGroupedUnOrderedPredicate, IndexKeyGroupedHashedOrderedPredicate>
+    table(16, 4.f, IndexNameUnOrderedPredicate(), IndexKeyGroupedUnOrderedPredicate(), IndexKeyGroupedHashedOrderedPredicate());
+    for (int i = 0; i < 1000; ++i) {
+        table.Insert(Object{i % 10, std::to_string(i)});
+    }
+    EXPECT(table.FindAll<1>(Object{3, ""}).size() == 100 && table.FindAll<2>(Object{3, ""}).size() == 100);
+    
+    // every other object of the key, the posting lists shrink from the middle
+    for (int i = 3; i < 1000; i += 20) {
+        EXPECT(table.Delete<0>(Object{0, std::to_string(i)}) == 1);
+    }
+    EXPECT(table.Update<0>(Object{0, "13"}, Object{4, "13"}));
+    auto threes = table.FindAll<2>(Object{3, ""});
+    EXPECT(threes.size() == 49 && table.FindAll<1>(Object{3, ""}).size() == 49);
+    for (const auto& object : threes) {
+        EXPECT(object.i == 3 && std::stoi(object.s) % 20 == 13 && object.s != "13");
+    }
+    EXPECT(table.FindAll<1>(Object{4, ""}).size() == 101);
+    
+    EXPECT(table.Delete<1>(Object{5, ""}) == 100);
+    EXPECT(table.FindAll<2>(Object{5, ""}).empty() && table.FindAll<0>(Object{0, "15"}).empty());
+    EXPECT(table.Update<2>(Object{6, ""}, Object{7, "moved"}));
+    EXPECT(table.FindAll<1>(Object{6, ""}).empty() && table.FindAll<2>(Object{7, ""}).size() == 200);
+    EXPECT(table.FindFirst<1>(Object{7, ""})->i == 7);
+    EXPECT(table.Size() == 850);
+}
+
+// microseconds the writers take to insert and delete their keys in the table of the policy
+template<LockPolicy L>
+long long WriteContention(int writers, int keys) {
+    MultiIndexTable<L, 8, Object, IndexKeyUnOrderedPredicate, IndexKeyOrderedPredicate>
+    table(1024, 4.f, IndexKeyUnOrderedPredicate(), IndexKeyOrderedPredicate());
+    auto startTime = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> threads;
+    for (int w = 0; w < writers; ++w) {
+        threads.emplace_back([&table, w, keys]() {
+            for (int i = w * keys; i < (w + 1) * keys; ++i) {
+                table.Insert(Object{i, ""});
+                if (i % 2 == 1) {
+                    table.template Delete<0>(Object{i, ""});
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto endTime = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count();
+}
+
 int main() {
+    TestClear();
+    TestLoad();
+    TestConcurrentSize();
+    TestConcurrentClear();
+    TestConcurrentTable();
+    TestFlatCombining();
+    TestConcurrentOrdered();
+    TestOrderedSplit();
+    TestDeferredDeleteRange();
+    TestTuneCompact();
+    TestIndexCapacity();
+    TestEqualKeys();
+    TestCompactEqualKeys();
+    TestRanked();
+    TestCursorEqualKeys();
+    TestAggregateView();
+    TestSharedTable();
+    TestInstrumentation();
+    TestRadix();
+    TestSpatial();
+    TestBitmap();
+    TestResultCache();
+    TestCache();
+    TestDeferred();
+    TestGrouped();
+    
     constexpr int kRounds = 1024*1024;
     constexpr int kBuckets = 32;
     
@@ -159,6 +1379,26 @@ int main() {
     "Done with Terimber: %lld mem: %llu\n"
 #endif
            , delta.count(), tMem - iMem);
+
+    startTime = std::chrono::high_resolution_clock::now();
+    table.Rebuild();
+    endTime = std::chrono::high_resolution_clock::now();
+    delta = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
+    printf(
+#if defined (__linux__)
+    "Rebuild: %ld\n"
+#else
+    "Rebuild: %lld\n"
+#endif
+           , delta.count());
+
+    // the same writes from one and from many threads, combined writers should lose less to the contention
+    constexpr int kWriteKeys = 1 << 17;
+    const int writers = std::max(2, (int)std::thread::hardware_concurrency());
+    printf("Write contention, %d writers: Internal %lld/%lld FlatCombining %lld/%lld\n", writers,
+           WriteContention<LockPolicy::Internal>(1, kWriteKeys), WriteContention<LockPolicy::Internal>(writers, kWriteKeys / writers),
+           WriteContention<LockPolicy::FlatCombining>(1, kWriteKeys), WriteContention<LockPolicy::FlatCombining>(writers, kWriteKeys / writers));
+
     auto resRange1 = table.FindAll<0>(o1);
     auto resRange2 = table.FindAll<1>(o1);
     auto resRange3 = table.FindAll<2>(o1);
@@ -173,7 +1413,24 @@ int main() {
     table.FindBySelector<0>([&resRange1](const Object& item) { resRange1.push_back(item); }, o1);
     table.FindBySelector<1>([&resRange2](const Object& item) { resRange2.push_back(item); }, o1);
     table.FindBySelector<2>([&resRange3](const Object& item) { resRange3.push_back(item); }, o1);
+    // matches by all three keys
+    resRange1 = table.FindAllOf<0, 1, 2>(o1);
+    EXPECT(resRange1.size() == resRange2.size());
+    EXPECT(std::all_of(resRange1.begin(), resRange1.end(), [&o1](const Object& item) { return item == o1; }));
+
 
+    // ordered pages, forward and backward
+    auto cursor = table.SeekFirst<1>();
+    auto page = table.Next<1>(cursor, 100);
+    EXPECT(page.size() == 100);
+    EXPECT(std::is_sorted(page.begin(), page.end()));
+    auto nextPage = table.Next<1>(cursor, 100);
+    EXPECT(nextPage.size() == 100);
+    EXPECT(!(nextPage.front() < page.back()));
+    cursor = table.Seek<1>(o2, true);
+    page = table.Next<1>(cursor, 100);
+    EXPECT(std::is_sorted(page.rbegin(), page.rend()));
+    EXPECT(page.empty() || !(o2 < page.front()));
     
     table.Update<1>(o2, std::move(o1copy1));
     resRange1 = table.FindAll<0>(o1);
@@ -194,6 +1451,19 @@ int main() {
     auto res1 = table.FindFirst<0>(o1);
     auto res2 = table.FindFirst<1>(o2);
     auto res3 = table.FindFirst<2>(o2);
+    auto resBatch = table.FindFirstBatch<0>({o1, o2});
+    EXPECT(resBatch.size() == 2);
+    EXPECT(resBatch[0] == res1);
+    EXPECT(resBatch[1] == table.FindFirst<0>(o2));
+    std::vector<Object> keys;
+    for (int v = 0; v < 100; ++v) {
+        keys.push_back(Object{v, std::to_string(v)});
+    }
+    resBatch = table.FindFirstBatch<0>(keys);
+    EXPECT(resBatch.size() == keys.size());
+    for (size_t k = 0; k < keys.size(); ++k) {
+        EXPECT(resBatch[k] == table.FindFirst<0>(keys[k]));
+    }
     resRange1 = table.FindAll<0>(o1);
     resRange2 = table.FindAll<1>(o1);
     resRange3 = table.FindAll<2>(o1);
@@ -211,6 +1481,69 @@ int main() {
     resRange2 = table.FindAll<1>(o2);
     resRange3 = table.FindAll<2>(o1);
 
+    // mixed mutations under one lock
+    decltype(table)::Batch batch;
+    batch.Insert(Object(o1));
+    batch.Update<0>(o1, Object(o2));
+    batch.Delete<2>(o2);
+    const size_t sizeBefore = table.Size();
+    EXPECT(table.ApplyBatch(std::move(batch)) == 3);
+    EXPECT(table.Size() == sizeBefore);
+    EXPECT(table.FindAll<0>(o1).empty());
+    EXPECT(table.FindAll<1>(o2).empty());
+
+    // bulk deletes, whole buckets at once
+    auto countRange = [&table, &o1, &o2]() {
+        size_t count = 0;
+        auto rangeCursor = table.Seek<1>(o1);
+        table.Next<1>([&count, &o2](const Object& item) { count += o2 < item ? 0 : 1; }, rangeCursor, table.Size());
+        return count;
+    };
+    const size_t inRange = countRange();
+    size_t sizeBulk = table.Size();
+    EXPECT(table.DeleteRange<1>(o1, o2) == inRange);
+    EXPECT(table.Size() == sizeBulk - inRange);
+    EXPECT(countRange() == 0);
+    EXPECT(table.FindAll<0>(o2).empty());
+    
+    const size_t zeros = table.FindAll<0>(Object{0, "0"}).size();
+    sizeBulk = table.Size();
+    EXPECT(table.DeleteWhere([](const Object& obj) { return obj.i == 0; }) == zeros);
+    EXPECT(table.Size() == sizeBulk - zeros);
+    EXPECT(table.FindAll<2>(Object{0, "0"}).empty());
+
+    // repack the buckets left underfilled by the deletes
+    const size_t size = table.Size();
+    const size_t sevens = table.FindAll<1>(Object{7, "7"}).size();
+    table.Compact();
+    EXPECT(table.Size() == size);
+    EXPECT(table.FindAll<1>(Object{7, "7"}).size() == sevens);
+    EXPECT(table.FindAll<2>(Object{7, "7"}).size() == sevens);
+    cursor = table.SeekFirst<1>();
+    page = table.Next<1>(cursor, size);
+    EXPECT(page.size() == size);
+    EXPECT(std::is_sorted(page.begin(), page.end()));
+
+    // read only flat layout for the read mostly phase
+    table.Freeze();
+    EXPECT(table.IsFrozen());
+    EXPECT(table.Size() == size);
+    EXPECT(table.FindAll<0>(Object{7, "7"}).size() == sevens);
+    EXPECT(table.FindAll<1>(Object{7, "7"}).size() == sevens);
+    EXPECT(table.FindAll<2>(Object{7, "7"}).size() == sevens);
+    EXPECT(table.FindFirst<0>(Object{7, "7"}).has_value() == (sevens != 0));
+    cursor = table.SeekFirst<1>();
+    page = table.Next<1>(cursor, size);
+    EXPECT(page.size() == size);
+    EXPECT(std::is_sorted(page.begin(), page.end()));
+    // the mutations are rejected until Thaw
+    EXPECT(table.Delete<0>(Object{7, "7"}) == 0);
+    EXPECT(table.Size() == size);
+    table.Thaw();
+    EXPECT(!table.IsFrozen());
+    EXPECT(table.Delete<0>(Object{7, "7"}) == sevens);
+    EXPECT(table.FindAll<1>(Object{7, "7"}).empty());
+
     table.Clear();
 }
 